@@ -7,6 +7,7 @@
 
 #include <headers/hw_ioc.h>
 #include <headers/hw_memmap.h>
+#include <headers/hw_rfcore_sfr.h>
 #include <headers/hw_ssi.h>
 #include <headers/hw_sys_ctrl.h>
 #include <headers/hw_types.h>
@@ -26,6 +27,7 @@
 #include "flash.h"
 #include "i2c.h"
 #include "sensors.h"
+#include "sleepmode.h"
 
 //=========================== variables =======================================
 
@@ -98,6 +100,67 @@ void board_sleep(void) {
     SysCtrlSleep();
 }
 
+/**
+ * Puts the board in PM1 (SLEEP_LIGHT) or PM2 (SLEEP_DEEP)
+ *
+ * Must be called with interrupts disabled, and returns with interrupts still
+ * disabled. Only the sleep timer (bsp_timer) and GPIOs wake the board up, the
+ * caller makes sure to have the sleep timer fire ahead of the radiotimer.
+ *
+ * The MAC timer (radiotimer) stops with the 32MHz clock. It is stopped and
+ * restarted in sync with the sleep timer, and caught up with the time spent
+ * asleep.
+ */
+void board_sleepAtLevel(sleep_level_t level) {
+    uint32_t pm;
+    uint32_t macTimerValue;
+    uint32_t macTimerPeriod;
+    uint32_t before;
+
+    switch (level) {
+        case SLEEP_LIGHT:
+            pm = SYS_CTRL_PM_1;
+            break;
+        case SLEEP_DEEP:
+            pm = SYS_CTRL_PM_2;
+            break;
+        default:
+            board_sleep();
+            return;
+    }
+
+    // stop the MAC timer, at the next 32kHz edge
+    HWREG(RFCORE_SFR_MTCTRL) &= ~RFCORE_SFR_MTCTRL_RUN;
+    while (HWREG(RFCORE_SFR_MTCTRL) & RFCORE_SFR_MTCTRL_STATE);
+    macTimerValue  = radiotimer_getValue();
+    macTimerPeriod = radiotimer_getPeriod();
+    before         = SleepModeTimerCountGet();
+
+    // sleep
+    SysCtrlPowerModeSet(pm);
+    SysCtrlDeepSleep();
+
+    // wait for the 32MHz XOSC to be the system clock again
+    while (HWREG(SYS_CTRL_CLOCK_STA) & SYS_CTRL_CLOCK_STA_OSC);
+
+    // catch the MAC timer up with the time spent asleep
+    macTimerValue += SleepModeTimerCountGet()-before;
+    if (macTimerValue>=macTimerPeriod) {
+        // overflow as soon as possible
+        macTimerValue = macTimerPeriod-1;
+    }
+    HWREG(RFCORE_SFR_MTMSEL) = (0x00 << RFCORE_SFR_MTMSEL_MTMOVFSEL_S) & RFCORE_SFR_MTMSEL_MTMOVFSEL_M;
+    HWREG(RFCORE_SFR_MTMOVF0) = (macTimerValue << RFCORE_SFR_MTMOVF0_MTMOVF0_S) & RFCORE_SFR_MTMOVF0_MTMOVF0_M;
+    HWREG(RFCORE_SFR_MTMOVF1) = ((macTimerValue >> 8) << RFCORE_SFR_MTMOVF1_MTMOVF1_S) & RFCORE_SFR_MTMOVF1_MTMOVF1_M;
+    HWREG(RFCORE_SFR_MTMOVF2) = ((macTimerValue >> 16) << RFCORE_SFR_MTMOVF2_MTMOVF2_S) & RFCORE_SFR_MTMOVF2_MTMOVF2_M;
+
+    // restart the MAC timer, at the next 32kHz edge
+    HWREG(RFCORE_SFR_MTCTRL) |= RFCORE_SFR_MTCTRL_RUN;
+    while (!(HWREG(RFCORE_SFR_MTCTRL) & RFCORE_SFR_MTCTRL_STATE));
+
+    SysCtrlPowerModeSet(SYS_CTRL_PM_NOACTION);
+}
+
 /**
  * Timer runs at 32 MHz and is 32-bit wide
  * The timer is divided by 32, whichs gives a 1 microsecond ticks
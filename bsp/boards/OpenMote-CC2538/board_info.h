@@ -57,6 +57,14 @@
 #define PORT_PIN_RADIO_RESET_HIGH()    // nothing
 #define PORT_PIN_RADIO_RESET_LOW()     // nothing
 
+//===== sleep
+
+// minimum time to the next event for PM1/PM2 to be used, see powermanager.h
+#define PORT_SLEEP_LIGHT_MIN_TICKS          10    //  305us
+#define PORT_SLEEP_DEEP_MIN_TICKS           33    // 1007us
+// wake up that early before the next radiotimer event (XOSC start-up)
+#define PORT_SLEEP_GUARD_TICKS              5     //  152us
+
 //===== IEEE802154E timing
 
 // time-slot related
@@ -150,6 +150,28 @@ PORT_RADIOTIMER_WIDTH radiotimer_getPeriod() {
     return period;
 }
 
+/**
+\brief Time during which the radiotimer doesn't need the board.
+
+\returns The number of ticks until the next overflow, or 0 if a compare is
+   armed (i.e. in the middle of a slot, possibly with the radio on).
+*/
+PORT_RADIOTIMER_WIDTH radiotimer_getIdleTime() {
+	PORT_RADIOTIMER_WIDTH value;
+	PORT_RADIOTIMER_WIDTH period;
+
+	if (HWREG(RFCORE_SFR_MTIRQM) & RFCORE_SFR_MTIRQM_MACTIMER_OVF_COMPARE1M) {
+		return 0;
+	}
+
+	value  = radiotimer_getValue();
+	period = radiotimer_getPeriod();
+	if (value>=period) {
+		return 0;
+	}
+	return period-value;
+}
+
 //===== compare
 
 void radiotimer_schedule(PORT_RADIOTIMER_WIDTH offset) {
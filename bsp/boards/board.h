@@ -22,6 +22,14 @@ typedef enum {
    KICK_SCHEDULER,
 } kick_scheduler_t;
 
+/// sleep levels, from the lightest to the deepest
+typedef enum {
+   SLEEP_IDLE                = 0, ///< CPU halted, all clocks running (board_sleep())
+   SLEEP_LIGHT               = 1, ///< high-speed clock stopped, 32kHz timers running
+   SLEEP_DEEP                = 2, ///< as SLEEP_LIGHT, with more of the chip powered down
+   SLEEP_LEVEL_MAX           = 3,
+} sleep_level_t;
+
 //=========================== typedef =========================================
 
 //=========================== variables =======================================
@@ -30,7 +38,11 @@ typedef enum {
 
 void board_init(void);
 void board_sleep(void);
+void board_sleepAtLevel(sleep_level_t level);
 void board_reset(void);
+#ifdef OPENSIM
+uint16_t board_getRandomSeed(void);
+#endif
 
 /**
 \}
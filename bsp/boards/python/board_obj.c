@@ -14,6 +14,7 @@
 #include "radio_obj.h"
 #include "radiotimer_obj.h"
 #include "eui64_obj.h"
+#include "simengine_obj.h"
 
 //=========================== variables =======================================
 
@@ -36,6 +37,10 @@ void board_init(OpenMote* self) {
    radio_init(self);
    radiotimer_init(self);
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_board_init],NULL);
    if (result == NULL) {
@@ -56,6 +61,11 @@ void board_sleep(OpenMote* self) {
    printf("C@0x%x: board_sleep()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_board_sleep(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_board_sleep],NULL);
    if (result == NULL) {
@@ -69,6 +79,11 @@ void board_sleep(OpenMote* self) {
 #endif
 }
 
+void board_sleepAtLevel(OpenMote* self, sleep_level_t level) {
+   // the Python BSP only knows about one sleep level
+   board_sleep(self);
+}
+
 void board_reset(OpenMote* self) {
    PyObject*   result;
    
@@ -76,6 +91,11 @@ void board_reset(OpenMote* self) {
    printf("C@0x%x: board_reset()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_board_reset(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_board_reset],NULL);
    if (result == NULL) {
@@ -89,4 +109,16 @@ void board_reset(OpenMote* self) {
 #endif
 }
 
+/**
+\brief Seed mixed into the one openrandom derives from the address.
+
+Only motes attached to a SimEngine can have one.
+*/
+uint16_t board_getRandomSeed(OpenMote* self) {
+   if (self->sim!=NULL) {
+      return self->sim->randomSeed;
+   }
+   return 0;
+}
+
 //=========================== private =========================================
@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include "bsp_timer_obj.h"
+#include "simengine_obj.h"
 
 //=========================== defines =========================================
 
@@ -28,6 +29,10 @@ void bsp_timer_init(OpenMote* self) {
    printf("C@0x%x: bsp_timer_init()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_bsp_timer_init],NULL);
    if (result == NULL) {
@@ -48,6 +53,11 @@ void bsp_timer_reset(OpenMote* self) {
    printf("C@0x%x: bsp_timer_reset()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_bsp_timer_reset(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_bsp_timer_reset],NULL);
    if (result == NULL) {
@@ -69,6 +79,11 @@ void bsp_timer_scheduleIn(OpenMote* self, PORT_TIMER_WIDTH delayTicks) {
    printf("C@0x%x: bsp_timer_scheduleIn(delayTicks=%d)... \n",self,delayTicks);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_bsp_timer_scheduleIn(self,delayTicks);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",delayTicks);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_bsp_timer_scheduleIn],arglist);
@@ -91,6 +106,11 @@ void bsp_timer_cancel_schedule(OpenMote* self) {
    printf("C@0x%x: bsp_timer_cancel_schedule()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_bsp_timer_cancel_schedule(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_bsp_timer_cancel_schedule],NULL);
    if (result == NULL) {
@@ -112,6 +132,10 @@ PORT_TIMER_WIDTH bsp_timer_get_currentValue(OpenMote* self) {
    printf("C@0x%x: bsp_timer_get_currentValue()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_bsp_timer_get_currentValue(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_bsp_timer_get_currentValue],NULL);
    if (result == NULL) {
@@ -21,6 +21,10 @@ void debugpins_init(OpenMote* self) {
    printf("C@0x%x: debugpins_init()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_init],NULL);
    if (result == NULL) {
@@ -41,6 +45,10 @@ void debugpins_frame_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_frame_toggle()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_frame_toggle],NULL);
    if (result == NULL) {
@@ -60,6 +68,10 @@ void debugpins_frame_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_frame_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_frame_clr],NULL);
    if (result == NULL) {
@@ -79,6 +91,10 @@ void debugpins_frame_set(OpenMote* self) {
    printf("C@0x%x: debugpins_frame_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_frame_set],NULL);
    if (result == NULL) {
@@ -99,6 +115,10 @@ void debugpins_slot_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_slot_toggle()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_slot_toggle],NULL);
    if (result == NULL) {
@@ -118,6 +138,10 @@ void debugpins_slot_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_slot_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_slot_clr],NULL);
    if (result == NULL) {
@@ -137,6 +161,10 @@ void debugpins_slot_set(OpenMote* self) {
    printf("C@0x%x: debugpins_slot_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_slot_set],NULL);
    if (result == NULL) {
@@ -157,6 +185,10 @@ void debugpins_fsm_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_fsm_toggle()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_fsm_toggle],NULL);
    if (result == NULL) {
@@ -176,6 +208,10 @@ void debugpins_fsm_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_fsm_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_fsm_clr],NULL);
    if (result == NULL) {
@@ -195,6 +231,10 @@ void debugpins_fsm_set(OpenMote* self) {
    printf("C@0x%x: debugpins_fsm_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_fsm_set],NULL);
    if (result == NULL) {
@@ -215,6 +255,10 @@ void debugpins_task_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_task_toggle(... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_task_toggle],NULL);
    if (result == NULL) {
@@ -234,6 +278,10 @@ void debugpins_task_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_task_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_task_clr],NULL);
    if (result == NULL) {
@@ -253,6 +301,10 @@ void debugpins_task_set(OpenMote* self) {
    printf("C@0x%x: debugpins_task_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_task_set],NULL);
    if (result == NULL) {
@@ -273,6 +325,10 @@ void debugpins_isr_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_isr_toggle()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_isr_toggle],NULL);
    if (result == NULL) {
@@ -292,6 +348,10 @@ void debugpins_isr_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_isr_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_isr_clr],NULL);
    if (result == NULL) {
@@ -311,6 +371,10 @@ void debugpins_isr_set(OpenMote* self) {
    printf("C@0x%x: debugpins_isr_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_isr_set],NULL);
    if (result == NULL) {
@@ -331,6 +395,10 @@ void debugpins_radio_toggle(OpenMote* self) {
    printf("C@0x%x: debugpins_radio_toggle()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_radio_toggle],NULL);
    if (result == NULL) {
@@ -350,6 +418,10 @@ void debugpins_radio_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_radio_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_radio_clr],NULL);
    if (result == NULL) {
@@ -369,6 +441,10 @@ void debugpins_radio_set(OpenMote* self) {
    printf("C@0x%x: debugpins_radio_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_radio_set],NULL);
    if (result == NULL) {
@@ -389,6 +465,10 @@ void debugpins_ka_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_ka_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_ka_clr],NULL);
    if (result == NULL) {
@@ -408,6 +488,10 @@ void debugpins_ka_set(OpenMote* self) {
    printf("C@0x%x: debugpins_ka_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_ka_set],NULL);
    if (result == NULL) {
@@ -428,6 +512,10 @@ void debugpins_syncPacket_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_syncPacket_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_syncPacket_clr],NULL);
    if (result == NULL) {
@@ -447,6 +535,10 @@ void debugpins_syncPacket_set(OpenMote* self) {
    printf("C@0x%x: debugpins_syncPacket_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_syncPacket_set],NULL);
    if (result == NULL) {
@@ -467,6 +559,10 @@ void debugpins_syncAck_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_syncAck_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_syncAck_clr],NULL);
    if (result == NULL) {
@@ -486,6 +582,10 @@ void debugpins_syncAck_set(OpenMote* self) {
    printf("C@0x%x: debugpins_syncAck_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_syncAck_set],NULL);
    if (result == NULL) {
@@ -506,6 +606,10 @@ void debugpins_debug_clr(OpenMote* self) {
    printf("C@0x%x: debugpins_debug_clr()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_debug_clr],NULL);
    if (result == NULL) {
@@ -525,6 +629,10 @@ void debugpins_debug_set(OpenMote* self) {
    printf("C@0x%x: debugpins_debug_set()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_debugpins_debug_set],NULL);
    if (result == NULL) {
@@ -5,6 +5,7 @@
 */
 
 #include "eui64_obj.h"
+#include "simengine_obj.h"
 
 //=========================== defines =========================================
 
@@ -23,6 +24,11 @@ void eui64_get(OpenMote* self, uint8_t* addressToWrite) {
    printf("C@0x%x: eui64_get()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_eui64_get(self,addressToWrite);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_eui64_get],NULL);
    if (result == NULL) {
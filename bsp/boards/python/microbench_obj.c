@@ -0,0 +1,378 @@
+/**
+\brief Microbenchmarks of the stack's hot paths, run on the host.
+
+The OpenMote is used bare: only the modules under test are initialized, and
+the MAC is marked as synchronized so the queue hands out buffers, as it does
+on a mote which has joined.
+*/
+
+#include "microbench_obj.h"
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "openhdlc_obj.h"
+#include "packetfunctions_obj.h"
+
+//=========================== defines =========================================
+
+typedef void (*microbench_case_t)(OpenMote* self, uint32_t iterations);
+
+//=========================== variables =======================================
+
+/// results the compiler has to compute
+static volatile uint32_t microbench_sink;
+
+//=========================== prototypes ======================================
+
+// not in IEEE802154E.h, called by the MAC's slot handlers only
+uint8_t  calculateFrequency(OpenMote* self, uint8_t channelOffset);
+void     incrementAsnOffset(OpenMote* self);
+
+static uint64_t microbench_now(void);
+static void     microbench_prepare(OpenMote* self);
+// openqueue
+static void     microbench_openqueue_getFree(OpenMote* self, uint32_t iterations);
+static void     microbench_openqueue_getDataDest(OpenMote* self, uint32_t iterations);
+static void     microbench_openqueue_getEB(OpenMote* self, uint32_t iterations);
+// schedule
+static void     microbench_schedule_slot(OpenMote* self, uint32_t iterations);
+static void     microbench_schedule_sync(OpenMote* self, uint32_t iterations);
+static void     microbench_schedule_indicateTx(OpenMote* self, uint32_t iterations);
+// neighbors
+static void     microbench_neighbors_indicateRx(OpenMote* self, uint32_t iterations);
+static void     microbench_neighbors_indicateTx(OpenMote* self, uint32_t iterations);
+static void     microbench_neighbors_isStable(OpenMote* self, uint32_t iterations);
+static void     microbench_neighbors_getParent(OpenMote* self, uint32_t iterations);
+static void     microbench_neighbors_updateRank(OpenMote* self, uint32_t iterations);
+// IEEE802154E
+static void     microbench_ieee154e_frequency(OpenMote* self, uint32_t iterations);
+static void     microbench_ieee154e_asn(OpenMote* self, uint32_t iterations);
+// openhdlc
+static void     microbench_openhdlc_crc(OpenMote* self, uint32_t iterations);
+// packetfunctions
+static void     microbench_packetfunctions_header(OpenMote* self, uint32_t iterations);
+static void     microbench_packetfunctions_duplicate(OpenMote* self, uint32_t iterations);
+static void     microbench_packetfunctions_sameAddress(OpenMote* self, uint32_t iterations);
+
+static const struct {
+   const char*          name;
+   microbench_case_t    run;
+} microbench_cases[] = {
+   // name                                                   function
+   {  "openqueue_getFreePacketBuffer+freePacketBuffer",      microbench_openqueue_getFree},
+   {  "openqueue_macGetDataPacketDestination",               microbench_openqueue_getDataDest},
+   {  "openqueue_macGetEBPacket",                            microbench_openqueue_getEB},
+   {  "schedule_advanceSlot+getters",                        microbench_schedule_slot},
+   {  "schedule_syncSlotOffset",                             microbench_schedule_sync},
+   {  "schedule_indicateTx",                                 microbench_schedule_indicateTx},
+   {  "neighbors_indicateRx",                                microbench_neighbors_indicateRx},
+   {  "neighbors_indicateTx",                                microbench_neighbors_indicateTx},
+   {  "neighbors_isStableNeighbor",                          microbench_neighbors_isStable},
+   {  "neighbors_getPreferredParent",                        microbench_neighbors_getParent},
+   {  "neighbors_updateMyDAGrankAndNeighborPreference",      microbench_neighbors_updateRank},
+   {  "calculateFrequency",                                  microbench_ieee154e_frequency},
+   {  "incrementAsnOffset",                                  microbench_ieee154e_asn},
+   {  "crcIteration x127",                                   microbench_openhdlc_crc},
+   {  "packetfunctions_reserveHeaderSize+tossHeader",        microbench_packetfunctions_header},
+   {  "packetfunctions_duplicatePacket",                     microbench_packetfunctions_duplicate},
+   {  "packetfunctions_sameAddress",                         microbench_packetfunctions_sameAddress},
+};
+
+//=========================== public ==========================================
+
+/**
+\returns The number of results microbench_run() writes.
+*/
+uint8_t microbench_numCases(void) {
+   return sizeof(microbench_cases)/sizeof(microbench_cases[0]);
+}
+
+/**
+\brief Time every case on a mote which doesn't belong to a SimEngine.
+
+\param[in] self       The mote, overwritten.
+\param[in] iterations Operations per run of a case.
+\param[out] results   microbench_numCases() results, in ns per operation.
+*/
+void microbench_run(OpenMote* self, uint32_t iterations, microbench_result_t* results) {
+   uint8_t  c;
+   uint8_t  r;
+   uint64_t start;
+   uint64_t best;
+   uint64_t elapsed;
+
+   for (c=0;c<microbench_numCases();c++) {
+      best = 0;
+      for (r=0;r<MICROBENCH_NUM_RUNS;r++) {
+         microbench_prepare(self);
+         start   = microbench_now();
+         microbench_cases[c].run(self, iterations);
+         elapsed = microbench_now()-start;
+         if (r==0 || elapsed<best) {
+            best = elapsed;
+         }
+      }
+      results[c].name    = microbench_cases[c].name;
+      results[c].nsPerOp = (double)best/iterations;
+   }
+}
+
+//=========================== private =========================================
+
+static uint64_t microbench_now(void) {
+#ifdef _WIN32
+   LARGE_INTEGER count;
+   LARGE_INTEGER frequency;
+
+   QueryPerformanceCounter(&count);
+   QueryPerformanceFrequency(&frequency);
+   return (uint64_t)(count.QuadPart*(1000000000.0/frequency.QuadPart));
+#else
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec*1000000000ULL+(uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+\brief Fill the tables under test, as on a mote deep in a busy network.
+
+All neighbors are known, every buffer of the queue but the last holds a data
+packet to a different destination, and the schedule is at slot 0.
+*/
+static void microbench_prepare(OpenMote* self) {
+   OpenQueueEntry_t* pkt;
+   asn_t             asn;
+   uint8_t           i;
+
+   memset(&asn,0,sizeof(asn_t));
+
+   self->ieee154e_vars.isSync         = TRUE;
+   self->ieee154e_vars.singleChannel  = 0;
+   self->ieee154e_vars.slotOffset     = 0;
+
+   schedule_init(self);
+   schedule_syncSlotOffset(self, 0);
+
+   neighbors_init(self);
+   for (i=0;i<MAXNUMNEIGHBORS;i++) {
+      neighbors_indicateRx(self, i+1, -60, &asn);
+      self->neighbors_vars.neighbors[i].DAGrank = MINHOPRANKINCREASE*(2+i);
+   }
+   neighbors_updateMyDAGrankAndNeighborPreference(self);
+
+   openqueue_init(self);
+   for (i=0;i<QUEUELENGTH-1;i++) {
+      pkt = openqueue_getFreePacketBuffer(self, COMPONENT_UINJECT);
+      packetfunctions_reserveHeaderSize(self, pkt, sizeof(l2_ht));
+      ((l2_ht*)pkt->payload)->dst = 1+i;
+      openqueue_transferOwnership(self, pkt, COMPONENT_SIXTOP_TO_IEEE802154E);
+   }
+}
+
+//=== openqueue
+
+static void microbench_openqueue_getFree(OpenMote* self, uint32_t iterations) {
+   OpenQueueEntry_t* pkt;
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      pkt = openqueue_getFreePacketBuffer(self, COMPONENT_UINJECT);
+      openqueue_freePacketBuffer(self, pkt);
+   }
+}
+
+static void microbench_openqueue_getDataDest(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   // the last packet in the queue
+   for (i=0;i<iterations;i++) {
+      microbench_sink += (uint32_t)(size_t)openqueue_macGetDataPacketDestination(self, QUEUELENGTH-1);
+   }
+}
+
+static void microbench_openqueue_getEB(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   // there is none, as in most EB slots of a mote which isn't due to send one
+   for (i=0;i<iterations;i++) {
+      microbench_sink += (uint32_t)(size_t)openqueue_macGetEBPacket(self);
+   }
+}
+
+//=== schedule
+
+static void microbench_schedule_slot(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   // what the MAC asks at every active slot
+   for (i=0;i<iterations;i++) {
+      schedule_advanceSlot(self);
+      microbench_sink += schedule_getNextActiveSlotOffset(self);
+      microbench_sink += schedule_getType(self);
+      microbench_sink += schedule_getNeighbor(self);
+      microbench_sink += schedule_getChannelOffset(self);
+   }
+}
+
+static void microbench_schedule_sync(OpenMote* self, uint32_t iterations) {
+   slotOffset_t      lastSlotOffset;
+   uint32_t          i;
+
+   // the last active slot, reached after the others
+   while (schedule_getNextActiveSlotOffset(self)!=0) {
+      schedule_advanceSlot(self);
+   }
+   lastSlotOffset = self->schedule_vars.currentScheduleEntry->slotOffset;
+
+   // back and forth, a whole slotframe every two operations
+   for (i=0;i<iterations;i++) {
+      schedule_syncSlotOffset(self, (i&1) ? 0 : lastSlotOffset);
+   }
+}
+
+static void microbench_schedule_indicateTx(OpenMote* self, uint32_t iterations) {
+   asn_t             asn;
+   uint32_t          i;
+
+   memset(&asn,0,sizeof(asn_t));
+   for (i=0;i<iterations;i++) {
+      asn.bytes0and1 = (uint16_t)i;
+      schedule_indicateTx(self, &asn, TRUE);
+   }
+}
+
+//=== neighbors
+
+static void microbench_neighbors_indicateRx(OpenMote* self, uint32_t iterations) {
+   asn_t             asn;
+   uint32_t          i;
+
+   memset(&asn,0,sizeof(asn_t));
+   for (i=0;i<iterations;i++) {
+      asn.bytes0and1 = (uint16_t)i;
+      neighbors_indicateRx(self, MAXNUMNEIGHBORS, -60, &asn);
+   }
+}
+
+static void microbench_neighbors_indicateTx(OpenMote* self, uint32_t iterations) {
+   asn_t             asn;
+   uint32_t          i;
+
+   memset(&asn,0,sizeof(asn_t));
+   for (i=0;i<iterations;i++) {
+      asn.bytes0and1 = (uint16_t)i;
+      neighbors_indicateTx(self, MAXNUMNEIGHBORS, 1, TRUE, &asn);
+   }
+}
+
+static void microbench_neighbors_isStable(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      microbench_sink += neighbors_isStableNeighbor(self, MAXNUMNEIGHBORS);
+   }
+}
+
+static void microbench_neighbors_getParent(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      microbench_sink += neighbors_getPreferredParent(self);
+   }
+}
+
+static void microbench_neighbors_updateRank(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      neighbors_updateMyDAGrankAndNeighborPreference(self);
+   }
+}
+
+//=== IEEE802154E
+
+static void microbench_ieee154e_frequency(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      microbench_sink += calculateFrequency(self, (uint8_t)(i&0x0f));
+   }
+}
+
+static void microbench_ieee154e_asn(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      incrementAsnOffset(self);
+   }
+}
+
+//=== openhdlc
+
+static void microbench_openhdlc_crc(OpenMote* self, uint32_t iterations) {
+   uint8_t           frame[127];
+   uint16_t          crc;
+   uint32_t          i;
+   uint8_t           b;
+
+   for (b=0;b<sizeof(frame);b++) {
+      frame[b] = b;
+   }
+
+   // a whole frame per operation
+   for (i=0;i<iterations;i++) {
+      crc = HDLC_CRCINIT;
+      for (b=0;b<sizeof(frame);b++) {
+         crc = crcIteration(crc,frame[b]);
+      }
+      microbench_sink += crc;
+   }
+}
+
+//=== packetfunctions
+
+static void microbench_packetfunctions_header(OpenMote* self, uint32_t iterations) {
+   OpenQueueEntry_t* pkt;
+   uint32_t          i;
+
+   pkt = &self->openqueue_vars.queue[0];
+   for (i=0;i<iterations;i++) {
+      packetfunctions_reserveHeaderSize(self, pkt, 8);
+      packetfunctions_tossHeader(self, pkt, 8);
+   }
+}
+
+static void microbench_packetfunctions_duplicate(OpenMote* self, uint32_t iterations) {
+   uint32_t          i;
+
+   for (i=0;i<iterations;i++) {
+      packetfunctions_duplicatePacket(
+         self,
+         &self->openqueue_vars.queue[QUEUELENGTH-1],
+         &self->openqueue_vars.queue[i%(QUEUELENGTH-1)]
+      );
+   }
+}
+
+static void microbench_packetfunctions_sameAddress(OpenMote* self, uint32_t iterations) {
+   open_addr_t       address_1;
+   open_addr_t       address_2;
+   uint32_t          i;
+
+   // equal, so the whole address is compared
+   memset(&address_1,0,sizeof(open_addr_t));
+   address_1.type = ADDR_64B;
+   for (i=0;i<8;i++) {
+      address_1.addr_64b[i] = (uint8_t)(0x14+i);
+   }
+   memcpy(&address_2,&address_1,sizeof(open_addr_t));
+
+   for (i=0;i<iterations;i++) {
+      microbench_sink += packetfunctions_sameAddress(self, &address_1, &address_2);
+   }
+}
@@ -0,0 +1,36 @@
+/**
+\brief Microbenchmarks of the stack's hot paths, run on the host.
+
+The MAC, queue and schedule code runs unchanged on the OpenMote of the Python
+board, without a SimEngine: its BSP only stores state, so a benchmark times
+the stack and nothing else. The tables are filled to their compiled size
+(QUEUELENGTH, MAXNUMNEIGHBORS, MAXACTIVESLOTS), and lookups hit their last
+entry, which is the slowest an interrupt handler will see.
+
+Each case is timed over a number of iterations, several times, and the
+fastest run is kept.
+*/
+
+#ifndef __MICROBENCH_H
+#define __MICROBENCH_H
+
+#include "openwsnmodule_obj.h"
+
+//=========================== define ==========================================
+
+/// runs of each case, the fastest is kept
+#define MICROBENCH_NUM_RUNS           5
+
+//=========================== typedef =========================================
+
+typedef struct {
+   const char*          name;
+   double               nsPerOp;
+} microbench_result_t;
+
+//=========================== prototypes ======================================
+
+uint8_t           microbench_numCases(void);
+void              microbench_run(OpenMote* self, uint32_t iterations, microbench_result_t* results);
+
+#endif
@@ -8,6 +8,8 @@
 #include "openwsnmodule.h"
 
 #include "bsp_timer.h"
+#include "simengine_obj.h"
+#include "microbench_obj.h"
 
 //=========================== OpenMote Class ==================================
 
@@ -399,15 +401,802 @@ static PyTypeObject openwsn_OpenMoteType = {
    0,                                  // tp_new (populated at module initialization)
 };
 
+//=========================== SimEngine Class =================================
+
+/**
+\brief Python wrapper of a native simulation engine.
+
+Keeps a reference to the motes it runs.
+*/
+typedef struct {
+   PyObject_HEAD
+   simengine_t*    engine;
+   PyObject*       motes;
+} SimEngine;
+
+//===== members
+
+//===== methods
+
+static PyObject* SimEngine_new(PyTypeObject* type, PyObject* args, PyObject* kwds) {
+   SimEngine*          self;
+   unsigned long long  seed;
+   
+   // parse arguments
+   seed = 0;
+   if (!PyArg_ParseTuple(args, "|K:SimEngine", &seed)) {
+      return NULL;
+   }
+   
+   self = (SimEngine*)type->tp_alloc(type, 0);
+   if (self==NULL) {
+      return NULL;
+   }
+   self->engine = simengine_new((uint64_t)seed);
+   self->motes  = PyList_New(0);
+   if (self->engine==NULL || self->motes==NULL) {
+      Py_DECREF(self);
+      return PyErr_NoMemory();
+   }
+   
+   return (PyObject*)self;
+}
+
+static void SimEngine_dealloc(SimEngine* self) {
+   if (self->engine!=NULL) {
+      simengine_free(self->engine);
+   }
+   Py_XDECREF(self->motes);
+   self->ob_type->tp_free((PyObject*)self);
+}
+
+static int SimEngine_checkMoteIdx(SimEngine* self, int moteIdx) {
+   if (moteIdx<0 || moteIdx>=self->engine->numMotes) {
+      PyErr_SetString(PyExc_IndexError, "wrong mote index");
+      return -1;
+   }
+   return 0;
+}
+
+static PyObject* SimEngine_addMote(SimEngine* self, PyObject* args) {
+   PyObject* mote;
+   PyObject* eui64List;
+   PyObject* item;
+   uint8_t   eui64[8];
+   int       randomSeed;
+   int       moteIdx;
+   uint8_t   i;
+   
+   // parse arguments
+   randomSeed = 0;
+   if (!PyArg_ParseTuple(args, "O!O|i:addMote", &openwsn_OpenMoteType, &mote, &eui64List, &randomSeed)) {
+      return NULL;
+   }
+   if (!PySequence_Check(eui64List) || PySequence_Size(eui64List)!=8) {
+      PyErr_SetString(PyExc_TypeError, "eui64 must be a sequence of 8 bytes");
+      return NULL;
+   }
+   if (((OpenMote*)mote)->sim!=NULL) {
+      PyErr_SetString(PyExc_ValueError, "mote already attached to an engine");
+      return NULL;
+   }
+   for (i=0;i<8;i++) {
+      item     = PySequence_GetItem(eui64List, i);
+      eui64[i] = (uint8_t)PyInt_AsLong(item);
+      Py_XDECREF(item);
+   }
+   if (PyErr_Occurred()) {
+      return NULL;
+   }
+   
+   // attach the mote
+   moteIdx = simengine_addMote(self->engine, (OpenMote*)mote, eui64, (uint16_t)randomSeed);
+   if (moteIdx<0) {
+      return PyErr_NoMemory();
+   }
+   PyList_Append(self->motes, mote);
+   
+   return PyInt_FromLong(moteIdx);
+}
+
+static PyObject* SimEngine_addRemoteMote(SimEngine* self) {
+   int moteIdx;
+   
+   moteIdx = simengine_addRemoteMote(self->engine);
+   if (moteIdx<0) {
+      return PyErr_NoMemory();
+   }
+   // no OpenMote in this process
+   PyList_Append(self->motes, Py_None);
+   
+   return PyInt_FromLong(moteIdx);
+}
+
+/**
+\brief Share the radio medium with the other processes of the network.
+
+The medium is created by createSharedMedium(), this process being one of
+the numProcs it was created for.
+*/
+static PyObject* SimEngine_attachSharedMedium(SimEngine* self, PyObject* args) {
+   const char* path;
+   int         proc;
+   int         result;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "si:attachSharedMedium", &path, &proc)) {
+      return NULL;
+   }
+   if (proc<0 || proc>=SIMMEDIUM_MAX_PROCS) {
+      PyErr_SetString(PyExc_ValueError, "wrong process index");
+      return NULL;
+   }
+   
+   result = simengine_attachShared(self->engine, path, (uint16_t)proc);
+   if (result==-1) {
+      return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+   }
+   if (result<0) {
+      PyErr_SetString(PyExc_ValueError, "not a medium for this process, or already attached to one");
+      return NULL;
+   }
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_setLink(SimEngine* self, PyObject* args) {
+   int    src;
+   int    dst;
+   float  pdr;
+   int    rssi;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "iifi:setLink", &src, &dst, &pdr, &rssi)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, src)<0 || SimEngine_checkMoteIdx(self, dst)<0) {
+      return NULL;
+   }
+   
+   simengine_setLink(self->engine, (uint16_t)src, (uint16_t)dst, pdr, (int8_t)rssi);
+   
+   Py_RETURN_NONE;
+}
+
+/**
+\brief Switch to, or tune, the SINR medium.
+
+Parameters not given keep their current value. Links set through setPosition()
+afterwards use them.
+*/
+static PyObject* SimEngine_setMedium(SimEngine* self, PyObject* args, PyObject* kwds) {
+   static char*        kwlist[] = {
+      "sinr","txPower","pathLoss1m","pathLossExponent","shadowing",
+      "fading","coherence","noiseFloor","sensitivity",NULL
+   };
+   simengine_medium_t  medium;
+   int                 sinr;
+   double              coherence;
+   
+   // parse arguments, starting from the current values
+   memcpy(&medium,&self->engine->medium,sizeof(simengine_medium_t));
+   sinr      = medium.sinr;
+   coherence = (double)medium.coherence/32768/(1<<SIMENGINE_SUBTICK_SHIFT);
+   if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ifffffdff:setMedium", kwlist,
+         &sinr,
+         &medium.txPower,
+         &medium.pathLoss1m,
+         &medium.pathLossExponent,
+         &medium.shadowing,
+         &medium.fading,
+         &coherence,
+         &medium.noiseFloor,
+         &medium.sensitivity
+      )) {
+      return NULL;
+   }
+   if (coherence<0) {
+      PyErr_SetString(PyExc_ValueError, "coherence must be positive");
+      return NULL;
+   }
+   medium.sinr      = sinr ? TRUE : FALSE;
+   medium.coherence = (uint64_t)(coherence*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   
+   simengine_setMedium(self->engine, &medium);
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_setPosition(SimEngine* self, PyObject* args) {
+   int    moteIdx;
+   float  x;
+   float  y;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "iff:setPosition", &moteIdx, &x, &y)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   if (self->engine->medium.sinr==FALSE) {
+      PyErr_SetString(PyExc_ValueError, "positions need the SINR medium, call setMedium() first");
+      return NULL;
+   }
+   
+   simengine_setPosition(self->engine, (uint16_t)moteIdx, x, y);
+   
+   Py_RETURN_NONE;
+}
+
+/**
+\brief Add a source of interference on some channels.
+
+Placed at (x,y), its power is that it transmits at. Otherwise, that at which
+every mote hears it.
+*/
+static PyObject* SimEngine_addInterferer(SimEngine* self, PyObject* args, PyObject* kwds) {
+   static char*            kwlist[] = {
+      "channelMask","power","period","onTime","phase","x","y",NULL
+   };
+   simengine_interferer_t  interferer;
+   unsigned int            channelMask;
+   double                  period;
+   double                  onTime;
+   double                  phase;
+   PyObject*               x;
+   PyObject*               y;
+   int                     idx;
+   
+   // parse arguments
+   period = 0;
+   onTime = 0;
+   phase  = 0;
+   x      = Py_None;
+   y      = Py_None;
+   memset(&interferer,0,sizeof(simengine_interferer_t));
+   if (!PyArg_ParseTupleAndKeywords(args, kwds, "If|dddOO:addInterferer", kwlist,
+         &channelMask,
+         &interferer.power,
+         &period,
+         &onTime,
+         &phase,
+         &x,
+         &y
+      )) {
+      return NULL;
+   }
+   if (period<0 || onTime<0 || phase<0 || onTime>period) {
+      PyErr_SetString(PyExc_ValueError, "wrong period, onTime or phase");
+      return NULL;
+   }
+   if ((x==Py_None)!=(y==Py_None)) {
+      PyErr_SetString(PyExc_ValueError, "give both x and y, or neither");
+      return NULL;
+   }
+   interferer.channelMask = (uint16_t)channelMask;
+   interferer.period      = (uint64_t)(period*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   interferer.onTime      = (uint64_t)(onTime*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   interferer.phase       = (uint64_t)(phase*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   if (x!=Py_None) {
+      interferer.hasPosition = TRUE;
+      interferer.x           = (float)PyFloat_AsDouble(x);
+      interferer.y           = (float)PyFloat_AsDouble(y);
+      if (PyErr_Occurred()) {
+         return NULL;
+      }
+   }
+   
+   idx = simengine_addInterferer(self->engine, &interferer);
+   if (idx<0) {
+      return PyErr_NoMemory();
+   }
+   
+   return PyInt_FromLong(idx);
+}
+
+/**
+\brief Change the model of the crystals, durations in seconds.
+
+Parameters not given keep their current value. The drift of every mote is
+drawn again.
+*/
+static PyObject* SimEngine_setClock(SimEngine* self, PyObject* args, PyObject* kwds) {
+   static char*        kwlist[] = {
+      "drift","walk","walkMax","walkPeriod","jitter",NULL
+   };
+   simengine_clock_t   clock;
+   double              walkPeriod;
+   double              jitter;
+   
+   // parse arguments, starting from the current values
+   memcpy(&clock,&self->engine->clock,sizeof(simengine_clock_t));
+   walkPeriod = (double)clock.walkPeriod/32768/(1<<SIMENGINE_SUBTICK_SHIFT);
+   jitter     = (double)clock.jitter/32768/(1<<SIMENGINE_SUBTICK_SHIFT);
+   if (!PyArg_ParseTupleAndKeywords(args, kwds, "|fffdd:setClock", kwlist,
+         &clock.drift,
+         &clock.walk,
+         &clock.walkMax,
+         &walkPeriod,
+         &jitter
+      )) {
+      return NULL;
+   }
+   if (clock.drift<0 || clock.walk<0 || clock.walkMax<0 || walkPeriod<=0 || jitter<0) {
+      PyErr_SetString(PyExc_ValueError, "wrong clock parameters");
+      return NULL;
+   }
+   clock.walkPeriod = (uint64_t)(walkPeriod*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   clock.jitter     = (uint64_t)(jitter*32768*(1<<SIMENGINE_SUBTICK_SHIFT));
+   if (clock.walkPeriod==0) {
+      PyErr_SetString(PyExc_ValueError, "walkPeriod too short");
+      return NULL;
+   }
+   
+   simengine_setClock(self->engine, &clock);
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_setDrift(SimEngine* self, PyObject* args) {
+   int    moteIdx;
+   float  drift;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "if:setDrift", &moteIdx, &drift)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   
+   simengine_setDrift(self->engine, (uint16_t)moteIdx, drift);
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_serialInput(SimEngine* self, PyObject* args) {
+   int        moteIdx;
+   const char* buf;
+   int        len;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "is#:serialInput", &moteIdx, &buf, &len)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   if (self->engine->motes[moteIdx]->remote==TRUE) {
+      PyErr_SetString(PyExc_ValueError, "mote runs in another process");
+      return NULL;
+   }
+   
+   simengine_serialInput(self->engine, (uint16_t)moteIdx, (uint8_t*)buf, (uint32_t)len);
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_getSerialOutput(SimEngine* self, PyObject* args) {
+   int        moteIdx;
+   uint8_t*   buf;
+   uint32_t   len;
+   PyObject*  returnVal;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "i:getSerialOutput", &moteIdx)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   
+   len       = simengine_serialOutput(self->engine, (uint16_t)moteIdx, &buf);
+   returnVal = PyString_FromStringAndSize((const char*)buf, len);
+   free(buf);
+   
+   return returnVal;
+}
+
+static PyObject* SimEngine_run(SimEngine* self, PyObject* args) {
+   double duration;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "d:run", &duration)) {
+      return NULL;
+   }
+   if (duration<0) {
+      PyErr_SetString(PyExc_ValueError, "duration must be positive");
+      return NULL;
+   }
+   
+   // from seconds to subticks
+   if (simengine_run(self->engine, (uint64_t)(duration*32768*(1<<SIMENGINE_SUBTICK_SHIFT)))<0) {
+      PyErr_SetString(PyExc_RuntimeError, "shared medium aborted by another process");
+      return NULL;
+   }
+   
+   Py_RETURN_NONE;
+}
+
+static PyObject* SimEngine_getTime(SimEngine* self) {
+   return PyFloat_FromDouble((double)self->engine->now/32768/(1<<SIMENGINE_SUBTICK_SHIFT));
+}
+
+static PyObject* SimEngine_getStats(SimEngine* self) {
+   return Py_BuildValue(
+      "{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K}",
+      "numEvents",      (unsigned long long)self->engine->stats.numEvents,
+      "numStaleEvents", (unsigned long long)self->engine->stats.numStaleEvents,
+      "numSwitches",    (unsigned long long)self->engine->stats.numSwitches,
+      "numWindows",     (unsigned long long)self->engine->stats.numWindows,
+      "numFramesOut",   (unsigned long long)self->engine->stats.numFramesOut,
+      "numFramesIn",    (unsigned long long)self->engine->stats.numFramesIn,
+      "numFramesLate",  (unsigned long long)self->engine->stats.numFramesLate,
+      "numFramesLost",  (unsigned long long)self->engine->stats.numFramesLost
+   );
+}
+
+static PyObject* SimEngine_getMoteStats(SimEngine* self, PyObject* args) {
+   int                    moteIdx;
+   simengine_moteStats_t  stats;
+   OpenMote*              mote;
+   PyObject*              numRxPerChannel;
+   PyObject*              numRxCrcErrorPerChannel;
+   uint8_t                i;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "i:getMoteStats", &moteIdx)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   
+   simengine_getMoteStats(self->engine, (uint16_t)moteIdx, &stats);
+   mote = self->engine->motes[moteIdx]->mote;
+   
+   // indexed by channel-11
+   numRxPerChannel         = PyList_New(SIMENGINE_NUM_CHANNELS);
+   numRxCrcErrorPerChannel = PyList_New(SIMENGINE_NUM_CHANNELS);
+   if (numRxPerChannel==NULL || numRxCrcErrorPerChannel==NULL) {
+      Py_XDECREF(numRxPerChannel);
+      Py_XDECREF(numRxCrcErrorPerChannel);
+      return NULL;
+   }
+   for (i=0;i<SIMENGINE_NUM_CHANNELS;i++) {
+      PyList_SET_ITEM(numRxPerChannel,         i, PyInt_FromLong(stats.numRxPerChannel[i]));
+      PyList_SET_ITEM(numRxCrcErrorPerChannel, i, PyInt_FromLong(stats.numRxCrcErrorPerChannel[i]));
+   }
+   
+   return Py_BuildValue(
+      "{s:I,s:I,s:I,s:I,s:K,s:I,s:I,s:I,s:N,s:N,s:f,s:I,s:i,s:i,s:I,s:I,s:i,s:O,s:i,s:I,s:I,s:i}",
+      "numTx",          stats.numTx,
+      "numRx",          stats.numRx,
+      "numRxCrcError",  stats.numRxCrcError,
+      "numCollisions",  stats.numCollisions,
+      "radioOnTicks",   (unsigned long long)stats.radioOnTicks,
+      "numWakeups",     stats.numWakeups,
+      "numResets",      stats.numResets,
+      "numUartDropped", stats.numUartDropped,
+      "numRxPerChannel",         numRxPerChannel,
+      "numRxCrcErrorPerChannel", numRxCrcErrorPerChannel,
+      "clockDrift",              self->engine->motes[moteIdx]->drift+self->engine->motes[moteIdx]->wander,
+      "numTimeCorrections",      stats.numTimeCorrections,
+      "minTimeCorrection",       (int)stats.minTimeCorrection,
+      "maxTimeCorrection",       (int)stats.maxTimeCorrection,
+      "sumAbsTimeCorrection",    stats.sumAbsTimeCorrection,
+      "numLargeTimeCorrections", stats.numLargeTimeCorrections,
+      "numDeSync",               mote!=NULL ? (int)mote->ieee154e_stats.numDeSync : 0,
+      // as the stack sees itself
+      "isSync",                  (mote!=NULL && mote->ieee154e_vars.isSync) ? Py_True : Py_False,
+      "myDAGrank",               mote!=NULL ? (int)mote->neighbors_vars.myDAGrank : MAXDAGRANK,
+      "numTicsOn",               mote!=NULL ? mote->ieee154e_stats.numTicsOn : 0,
+      "numTicsTotal",            mote!=NULL ? mote->ieee154e_stats.numTicsTotal : 0,
+      "numQueueDropped",         mote!=NULL ? (int)mote->openqueue_vars.numDropped : 0
+   );
+}
+
+static PyObject* SimEngine_getMote(SimEngine* self, PyObject* args) {
+   int        moteIdx;
+   PyObject*  mote;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "i:getMote", &moteIdx)) {
+      return NULL;
+   }
+   if (SimEngine_checkMoteIdx(self, moteIdx)<0) {
+      return NULL;
+   }
+   
+   mote = PyList_GetItem(self->motes, moteIdx);
+   Py_INCREF(mote);
+   
+   return mote;
+}
+
+static PyObject* SimEngine_snapshot(SimEngine* self, PyObject* args) {
+   const char* filename;
+   FILE*       f;
+   int         result;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "s:snapshot", &filename)) {
+      return NULL;
+   }
+   if (self->engine->shared!=NULL || self->engine->numRemoteMotes>0) {
+      PyErr_SetString(PyExc_ValueError, "no snapshot of part of a network");
+      return NULL;
+   }
+   
+   f = fopen(filename, "wb");
+   if (f==NULL) {
+      return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)filename);
+   }
+   result = simengine_snapshot(self->engine, f);
+   if (fclose(f)!=0) {
+      result = -1;
+   }
+   if (result<0) {
+      PyErr_SetString(PyExc_IOError, "could not write the snapshot");
+      return NULL;
+   }
+   
+   Py_RETURN_NONE;
+}
+
+/**
+\brief Restore a snapshot, into an engine without motes.
+
+The motes of the snapshot are created, use getMote() to reach them.
+*/
+static PyObject* SimEngine_restore(SimEngine* self, PyObject* args) {
+   const char*                 filename;
+   FILE*                       f;
+   simengine_snapshotHeader_t  header;
+   simengine_t*                engine;
+   PyObject*                   motes;
+   OpenMote**                  moteArray;
+   uint16_t                    i;
+   int                         result;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "s:restore", &filename)) {
+      return NULL;
+   }
+   if (self->engine->numMotes!=0) {
+      PyErr_SetString(PyExc_ValueError, "restore into an engine without motes");
+      return NULL;
+   }
+   
+   f = fopen(filename, "rb");
+   if (f==NULL) {
+      return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)filename);
+   }
+   if (simengine_readSnapshotHeader(f, &header)<0) {
+      fclose(f);
+      PyErr_SetString(PyExc_ValueError, "not a snapshot of this build");
+      return NULL;
+   }
+   
+   // fresh motes, into a fresh engine in case the file is truncated
+   engine    = simengine_new(0);
+   motes     = PyList_New(header.numMotes);
+   moteArray = (OpenMote**)malloc((header.numMotes+1)*sizeof(OpenMote*));
+   if (engine==NULL || motes==NULL || moteArray==NULL) {
+      goto nomemory;
+   }
+   for (i=0;i<header.numMotes;i++) {
+      moteArray[i] = (OpenMote*)PyObject_CallObject((PyObject*)&openwsn_OpenMoteType, NULL);
+      if (moteArray[i]==NULL) {
+         goto nomemory;
+      }
+      PyList_SET_ITEM(motes, i, (PyObject*)moteArray[i]);
+   }
+   result = simengine_restore(engine, f, &header, moteArray);
+   fclose(f);
+   free(moteArray);
+   if (result<0) {
+      simengine_free(engine);
+      Py_DECREF(motes);
+      PyErr_SetString(PyExc_ValueError, "truncated snapshot, or out of memory");
+      return NULL;
+   }
+   
+   simengine_free(self->engine);
+   Py_DECREF(self->motes);
+   self->engine = engine;
+   self->motes  = motes;
+   
+   Py_RETURN_NONE;
+
+nomemory:
+   fclose(f);
+   if (engine!=NULL) {
+      simengine_free(engine);
+   }
+   Py_XDECREF(motes);
+   free(moteArray);
+   return PyErr_NoMemory();
+}
+
+//===== admin
+
+/*
+\brief List of methods of the SimEngine class.
+*/
+static PyMethodDef SimEngine_methods[] = {
+   // name                        function                                          flags          doc
+   {  "addMote",                  (PyCFunction)SimEngine_addMote,                   METH_VARARGS,  "addMote(mote,eui64,randomSeed=0) -> index of the mote"},
+   {  "addRemoteMote",            (PyCFunction)SimEngine_addRemoteMote,             METH_NOARGS,   "addRemoteMote() -> index of a mote run by another process"},
+   {  "attachSharedMedium",       (PyCFunction)SimEngine_attachSharedMedium,        METH_VARARGS,  "attachSharedMedium(path,procIdx)"},
+   {  "setLink",                  (PyCFunction)SimEngine_setLink,                   METH_VARARGS,  "setLink(src,dst,pdr,rssi)"},
+   {  "setMedium",                (PyCFunction)SimEngine_setMedium,                 METH_VARARGS|METH_KEYWORDS, "setMedium(sinr,txPower,pathLoss1m,pathLossExponent,shadowing,fading,coherence,noiseFloor,sensitivity)"},
+   {  "setPosition",              (PyCFunction)SimEngine_setPosition,               METH_VARARGS,  "setPosition(moteIdx,x,y), in meters"},
+   {  "addInterferer",            (PyCFunction)SimEngine_addInterferer,             METH_VARARGS|METH_KEYWORDS, "addInterferer(channelMask,power,period=0,onTime=0,phase=0,x=None,y=None) -> index of the interferer"},
+   {  "setClock",                 (PyCFunction)SimEngine_setClock,                  METH_VARARGS|METH_KEYWORDS, "setClock(drift,walk,walkMax,walkPeriod,jitter), ppm and seconds"},
+   {  "setDrift",                 (PyCFunction)SimEngine_setDrift,                  METH_VARARGS,  "setDrift(moteIdx,ppm)"},
+   {  "serialInput",              (PyCFunction)SimEngine_serialInput,               METH_VARARGS,  "serialInput(moteIdx,bytes)"},
+   {  "getSerialOutput",          (PyCFunction)SimEngine_getSerialOutput,           METH_VARARGS,  "getSerialOutput(moteIdx) -> bytes written since the last call"},
+   {  "run",                      (PyCFunction)SimEngine_run,                       METH_VARARGS,  "run(seconds)"},
+   {  "getTime",                  (PyCFunction)SimEngine_getTime,                   METH_NOARGS,   "getTime() -> simulated seconds"},
+   {  "getStats",                 (PyCFunction)SimEngine_getStats,                  METH_NOARGS,   ""},
+   {  "getMoteStats",             (PyCFunction)SimEngine_getMoteStats,              METH_VARARGS,  ""},
+   {  "getMote",                  (PyCFunction)SimEngine_getMote,                   METH_VARARGS,  "getMote(moteIdx) -> OpenMote"},
+   {  "snapshot",                 (PyCFunction)SimEngine_snapshot,                  METH_VARARGS,  "snapshot(filename), the state of the engine and all its motes"},
+   {  "restore",                  (PyCFunction)SimEngine_restore,                   METH_VARARGS,  "restore(filename), into an engine without motes"},
+   {NULL} // sentinel
+};
+
+/*
+\brief Declaration of the SimEngine type.
+*/
+static PyTypeObject openwsn_SimEngineType = {
+   PyObject_HEAD_INIT(NULL)
+   0,                                  // ob_size
+   "REPLACE_BY_PROJ_NAME.SimEngine",   // tp_name
+   sizeof(SimEngine),                  // tp_basicsize
+   0,                                  // tp_itemsize
+   (destructor)SimEngine_dealloc,      // tp_dealloc
+   0,                                  // tp_print
+   0,                                  // tp_getattr
+   0,                                  // tp_setattr
+   0,                                  // tp_compare
+   0,                                  // tp_repr
+   0,                                  // tp_as_number
+   0,                                  // tp_as_sequence
+   0,                                  // tp_as_mapping
+   0,                                  // tp_hash
+   0,                                  // tp_call
+   0,                                  // tp_str
+   0,                                  // tp_getattro
+   0,                                  // tp_setattro
+   0,                                  // tp_as_buffer
+   Py_TPFLAGS_DEFAULT,                 // tp_flags
+   "Native discrete-event engine running emulated motes", // tp_doc
+   0,                                  // tp_traverse
+   0,                                  // tp_clear
+   0,                                  // tp_richcompare
+   0,                                  // tp_weaklistoffset
+   0,                                  // tp_iter
+   0,                                  // tp_iternext
+   SimEngine_methods,                  // tp_methods
+   0,                                  // tp_member
+   0,                                  // tp_getset
+   0,                                  // tp_base
+   0,                                  // tp_dict
+   0,                                  // tp_descr_get
+   0,                                  // tp_descr_set
+   0,                                  // tp_dictoffset
+   0,                                  // tp_init
+   0,                                  // tp_alloc
+   SimEngine_new,                      // tp_new
+};
+
 //=========================== openwsn module ==================================
 
 //===== members
 
 //===== methods
 
+/**
+\brief Create the radio medium shared by the SimEngines of numProcs processes.
+
+Lock-step by default, in real time if realtime is true.
+*/
+static PyObject* openwsn_createSharedMedium(PyObject* self, PyObject* args, PyObject* kwds) {
+   static char* kwlist[] = {"path","numProcs","realtime",NULL};
+   const char*  path;
+   int          numProcs;
+   PyObject*    realtime;
+   
+   // parse arguments
+   realtime = Py_False;
+   if (!PyArg_ParseTupleAndKeywords(args, kwds, "si|O:createSharedMedium", kwlist, &path, &numProcs, &realtime)) {
+      return NULL;
+   }
+   if (numProcs<1 || numProcs>SIMMEDIUM_MAX_PROCS) {
+      PyErr_SetString(PyExc_ValueError, "wrong number of processes");
+      return NULL;
+   }
+   
+   if (simmedium_create(
+         path,
+         (uint32_t)numProcs,
+         PyObject_IsTrue(realtime) ? SIMMEDIUM_MODE_REALTIME : SIMMEDIUM_MODE_LOCKSTEP
+      )<0) {
+      return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+   }
+   
+   Py_RETURN_NONE;
+}
+
+/**
+\brief Make the processes sharing a medium give up, when one of them failed.
+*/
+static PyObject* openwsn_abortSharedMedium(PyObject* self, PyObject* args) {
+   const char* path;
+   
+   // parse arguments
+   if (!PyArg_ParseTuple(args, "s:abortSharedMedium", &path)) {
+      return NULL;
+   }
+   
+   if (simmedium_abort(path)<0) {
+      return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char*)path);
+   }
+   
+   Py_RETURN_NONE;
+}
+
+/**
+\brief Time the stack's hot paths on a mote of its own.
+
+\returns A list of (name, ns per operation).
+*/
+static PyObject* openwsn_runMicrobenchmarks(PyObject* self, PyObject* args) {
+   int                  iterations;
+   OpenMote*            mote;
+   microbench_result_t* results;
+   PyObject*            returnVal;
+   uint8_t              i;
+   
+   // parse arguments
+   iterations = 1000000;
+   if (!PyArg_ParseTuple(args, "|i:runMicrobenchmarks", &iterations)) {
+      return NULL;
+   }
+   if (iterations<1) {
+      PyErr_SetString(PyExc_ValueError, "iterations must be positive");
+      return NULL;
+   }
+   
+   mote    = (OpenMote*)PyObject_CallObject((PyObject*)&openwsn_OpenMoteType, NULL);
+   results = (microbench_result_t*)malloc(microbench_numCases()*sizeof(microbench_result_t));
+   if (mote==NULL || results==NULL) {
+      Py_XDECREF(mote);
+      free(results);
+      return PyErr_NoMemory();
+   }
+   
+   microbench_run(mote, (uint32_t)iterations, results);
+   
+   returnVal = PyList_New(microbench_numCases());
+   for (i=0;returnVal!=NULL && i<microbench_numCases();i++) {
+      PyList_SET_ITEM(returnVal, i, Py_BuildValue("(sd)", results[i].name, results[i].nsPerOp));
+   }
+   Py_DECREF(mote);
+   free(results);
+   return returnVal;
+}
+
 //===== admin
 
 static PyMethodDef openwsn_methods[] = {
+   // name                        function                                          flags          doc
+   {  "createSharedMedium",       (PyCFunction)openwsn_createSharedMedium,          METH_VARARGS|METH_KEYWORDS, "createSharedMedium(path,numProcs,realtime=False)"},
+   {  "abortSharedMedium",        (PyCFunction)openwsn_abortSharedMedium,           METH_VARARGS,  "abortSharedMedium(path)"},
+   {  "runMicrobenchmarks",       (PyCFunction)openwsn_runMicrobenchmarks,          METH_VARARGS,  "runMicrobenchmarks(iterations=1000000) -> [(name,nsPerOp)]"},
    {NULL, NULL, 0, NULL} // sentinel
 };
 
@@ -423,12 +1212,15 @@ PyMODINIT_FUNC initREPLACE_BY_PROJ_NAME(void) {
    if (PyType_Ready(&openwsn_OpenMoteType) < 0) {
       return;
    }
+   if (PyType_Ready(&openwsn_SimEngineType) < 0) {
+      return;
+   }
    
    // initialize the openwsn module
    openwsn_module = Py_InitModule3(
       "REPLACE_BY_PROJ_NAME",
       openwsn_methods,
-      "Module which declares the OpenMote class."
+      "Module which declares the OpenMote and SimEngine classes."
    );
    
    // create OpenMote class
@@ -438,4 +1230,17 @@ PyMODINIT_FUNC initREPLACE_BY_PROJ_NAME(void) {
       "OpenMote",
       (PyObject*)&openwsn_OpenMoteType
    );
+   
+   // create SimEngine class
+   Py_INCREF(&openwsn_SimEngineType);
+   PyModule_AddObject(
+      openwsn_module,
+      "SimEngine",
+      (PyObject*)&openwsn_SimEngineType
+   );
+   
+   // channel masks of the usual Wi-Fi channels, for addInterferer()
+   PyModule_AddIntConstant(openwsn_module, "WIFI1_MASK",  SIMENGINE_WIFI1_MASK);
+   PyModule_AddIntConstant(openwsn_module, "WIFI6_MASK",  SIMENGINE_WIFI6_MASK);
+   PyModule_AddIntConstant(openwsn_module, "WIFI11_MASK", SIMENGINE_WIFI11_MASK);
 }
@@ -10,21 +10,24 @@
 // Python
 #include <Python.h>
 #include "structmember.h"
-// OpenWSN
+// OpenWSN, whose callback types take the mote
+typedef struct OpenMote OpenMote;
 #include "openserial_obj.h"
 #include "opentimers_obj.h"
+#include "openeventlog_obj.h"
+#include "opensensors_obj.h"
 #include "scheduler_obj.h"
+#include "powermanager_obj.h"
 #include "IEEE802154E_obj.h"
 #include "adaptive_sync_obj.h"
 #include "neighbors_obj.h"
-#include "processIE_obj.h"
 #include "sixtop_obj.h"
 #include "schedule_obj.h"
 #include "idmanager_obj.h"
 #include "openqueue_obj.h"
 #include "openrandom_obj.h"
 // applications
-#include "sixtop_light.h"
+#include "uinject_obj.h"
 
 //=========================== prototypes ======================================
 
@@ -39,7 +42,7 @@ void radiotimer_intr_overflow(OpenMote* self);
 // uart
 void uart_intr_tx(OpenMote* self);
 void uart_intr_rx(OpenMote* self);
-void uart_writeBufferByLen_FASTSIM(OpenMote* self, uint8_t* buffer, uint8_t len);
+void uart_writeBufferByLen_FASTSIM(OpenMote* self, uint8_t* buffer, uint16_t len);
 
 // supply
 void supply_on(OpenMote* self);
@@ -145,7 +148,6 @@ enum {
    MOTE_NOTIF_uart_clearRxInterrupts,
    MOTE_NOTIF_uart_clearTxInterrupts,
    MOTE_NOTIF_uart_writeByte,
-   MOTE_NOTIF_uart_writeCircularBuffer_FASTSIM,
    MOTE_NOTIF_uart_writeBufferByLen_FASTSIM,
    MOTE_NOTIF_uart_readByte,
    // last
@@ -196,6 +198,8 @@ struct OpenMote {
    bsp_timer_icb_t      bsp_timer_icb;
    radio_icb_t          radio_icb;
    radiotimer_icb_t     radiotimer_icb;
+   //===== native simulation engine (NULL when the BSP forwards to Python)
+   struct simengine_mote_t* sim;
    //===== openstack
    // l4
    // l3
@@ -213,13 +217,17 @@ struct OpenMote {
    openqueue_vars_t     openqueue_vars;
    // drivers
    opentimers_vars_t    opentimers_vars;
+   opentimers_dbg_t     opentimers_dbg;
    random_vars_t        random_vars;
    openserial_vars_t    openserial_vars;
+   openeventlog_vars_t  openeventlog_vars;
+   opensensors_vars_t   opensensors_vars;
    // kernel
    scheduler_vars_t     scheduler_vars;
    scheduler_dbg_t      scheduler_dbg;
+   powermanager_vars_t  powermanager_vars;
    //===== openapps
-   sixtop_light_vars_t  sixtop_light_vars;
+   uinject_vars_t       uinject_vars;
 
 };
 
@@ -5,6 +5,7 @@
 */
 
 #include "radio_obj.h"
+#include "simengine_obj.h"
 
 //=========================== defines =========================================
 
@@ -77,6 +78,11 @@ void radio_init(OpenMote* self) {
    printf("C@0x%x: radio_init()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_init(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_init],NULL);
    if (result == NULL) {
@@ -99,6 +105,11 @@ void radio_reset(OpenMote* self) {
    printf("C@0x%x: radio_reset()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_rfOff(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_reset],NULL);
    if (result == NULL) {
@@ -122,6 +133,11 @@ void radio_startTimer(OpenMote* self, PORT_TIMER_WIDTH period) {
    printf("C@0x%x: radio_startTimer(period=%d)... \n",self,period);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_start(self,period);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",period);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_startTimer],arglist);
@@ -145,6 +161,10 @@ PORT_TIMER_WIDTH radio_getTimerValue(OpenMote* self) {
    printf("C@0x%x: radio_getTimerValue()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_radiotimer_getValue(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_getTimerValue],NULL);
    if (result == NULL) {
@@ -175,6 +195,11 @@ void radio_setTimerPeriod(OpenMote* self, PORT_TIMER_WIDTH period) {
    printf("C@0x%x: radio_setTimerPeriod(period=%d)... \n",self,period);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_setPeriod(self,period);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",period);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_setTimerPeriod],arglist);
@@ -198,6 +223,10 @@ PORT_TIMER_WIDTH radio_getTimerPeriod(OpenMote* self) {
    printf("C@0x%x: radio_getTimerPeriod()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_radiotimer_getPeriod(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_getTimerPeriod],NULL);
    if (result == NULL) {
@@ -230,6 +259,11 @@ void radio_setFrequency(OpenMote* self, uint8_t frequency) {
    printf("C@0x%x: radio_setFrequency(frequency=%d)... \n",self,frequency);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_setFrequency(self,frequency);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",frequency);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_setFrequency],arglist);
@@ -252,6 +286,10 @@ void radio_rfOn(OpenMote* self) {
    printf("C@0x%x: radio_rfOn()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_rfOn],NULL);
    if (result == NULL) {
@@ -272,6 +310,11 @@ void radio_rfOff(OpenMote* self) {
    printf("C@0x%x: radio_rfOff()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_rfOff(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_rfOff],NULL);
    if (result == NULL) {
@@ -288,36 +331,31 @@ void radio_rfOff(OpenMote* self) {
 //===== TX
 
 void radio_loadPacket(OpenMote* self, uint8_t* packet, uint8_t len) {
-   PyObject*   pkt;
    PyObject*   arglist;
    PyObject*   result;
-   PyObject*   item;
-   int8_t      i;
-   int         res;
    
 #ifdef TRACE_ON
    printf("C@0x%x: radio_loadPacket(len=%d)... \n",self,len);
 #endif
    
-   // forward to Python
-   pkt        = PyList_New(len);
-   for (i=0;i<len;i++) {
-      item    = PyInt_FromLong(packet[i]);
-      res     = PyList_SetItem(pkt,i,item);
-      if (res!=0) {
-         printf("[CRITICAL] radio_loadPacket() failed setting list item\r\n");
-         return;
-      }
+   if (self->sim!=NULL) {
+      simengine_radio_loadPacket(self,packet,len);
+      return;
+   }
+   
+   // forward to Python, the frame as a str
+   arglist    = Py_BuildValue("(s#)",packet,(int)len);
+   if (arglist==NULL) {
+      printf("[CRITICAL] Py_BuildValue() failed in radio_loadPacket\r\n");
+      return;
    }
-   arglist    = Py_BuildValue("(O)",pkt);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_loadPacket],arglist);
+   Py_DECREF(arglist);
    if (result == NULL) {
       printf("[CRITICAL] radio_loadPacket() returned NULL\r\n");
       return;
    }
    Py_DECREF(result);
-   Py_DECREF(arglist);
-   Py_DECREF(pkt);
 }
 
 void radio_txEnable(OpenMote* self) {
@@ -327,6 +365,11 @@ void radio_txEnable(OpenMote* self) {
    printf("C@0x%x: radio_txEnable()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_txEnable(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_txEnable],NULL);
    if (result == NULL) {
@@ -347,6 +390,11 @@ void radio_txNow(OpenMote* self) {
    printf("C@0x%x: radio_txNow()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_txNow(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_txNow],NULL);
    if (result == NULL) {
@@ -369,6 +417,11 @@ void radio_rxEnable(OpenMote* self) {
    printf("C@0x%x: radio_rxEnable()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_rxEnable(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_rxEnable],NULL);
    if (result == NULL) {
@@ -389,6 +442,11 @@ void radio_rxNow(OpenMote* self) {
    printf("C@0x%x: radio_rxNow()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_rxNow(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_rxNow],NULL);
    if (result == NULL) {
@@ -412,13 +470,19 @@ void radio_getReceivedFrame(OpenMote* self,
    PyObject*  result;
    PyObject*  item;
    PyObject*  subitem;
-   int8_t     lenRead;
-   int8_t     i;
+   Py_buffer  view;
+   Py_ssize_t lenRead;
+   Py_ssize_t i;
    
 #ifdef TRACE_ON
    printf("C@0x%x: radio_getReceivedFrame()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radio_getReceivedFrame(self,pBufRead,pLenRead,maxBufLen,pRssi,pLqi,pCrc);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radio_getReceivedFrame],NULL);
    if (result == NULL) {
@@ -439,13 +503,28 @@ void radio_getReceivedFrame(OpenMote* self,
    //==== item 0: rxBuffer
    
    item       = PyTuple_GetItem(result,0);
-   lenRead    = PyList_Size(item);
-   *pLenRead  = lenRead;
-   // store retrieved information
-   for (i=0;i<lenRead;i++) {
-      subitem = PyList_GetItem(item, i);
-      pBufRead[i] = (uint8_t)PyInt_AsLong(subitem);
+   if (PyObject_CheckBuffer(item)) {
+      // str, bytearray, memoryview...: copied at once
+      if (PyObject_GetBuffer(item,&view,PyBUF_SIMPLE)!=0) {
+         printf("[CRITICAL] radio_getReceivedFrame() returned an unreadable buffer\r\n");
+         Py_DECREF(result);
+         return;
+      }
+      lenRead = view.len<maxBufLen ? view.len : maxBufLen;
+      memcpy(pBufRead,view.buf,lenRead);
+      PyBuffer_Release(&view);
+   } else {
+      // list of ints
+      lenRead = PyList_Size(item);
+      if (lenRead>maxBufLen) {
+         lenRead = maxBufLen;
+      }
+      for (i=0;i<lenRead;i++) {
+         subitem = PyList_GetItem(item, i);
+         pBufRead[i] = (uint8_t)PyInt_AsLong(subitem);
+      }
    }
+   *pLenRead  = (uint8_t)lenRead;
    
    //==== item 1: rssi
    
@@ -461,6 +540,9 @@ void radio_getReceivedFrame(OpenMote* self,
    
    item       = PyTuple_GetItem(result,3);
    *pCrc      = (uint8_t)PyInt_AsLong(item);
+   
+   // dispose of returned value
+   Py_DECREF(result);
 }
 
 //=========================== interrupts ======================================
@@ -5,6 +5,7 @@
 */
 
 #include "radiotimer_obj.h"
+#include "simengine_obj.h"
 
 //=========================== variables =======================================
 
@@ -49,6 +50,11 @@ void radiotimer_init(OpenMote* self) {
    printf("C@0x%x: radiotimer_init()... \n",self,self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_init(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_init],NULL);
    if (result == NULL) {
@@ -69,6 +75,11 @@ void radiotimer_start(OpenMote* self, PORT_RADIOTIMER_WIDTH period) {
    printf("C@0x%x: radiotimer_start(period=%d)... \n",self,period);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_start(self,period);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_start],NULL);
    if (result == NULL) {
@@ -92,6 +103,10 @@ PORT_RADIOTIMER_WIDTH radiotimer_getValue(OpenMote* self) {
    printf("C@0x%x: radiotimer_getValue()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_radiotimer_getValue(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_getValue],NULL);
    if (result == NULL) {
@@ -122,6 +137,11 @@ void radiotimer_setPeriod(OpenMote* self, PORT_RADIOTIMER_WIDTH period) {
    printf("C@0x%x: radiotimer_setPeriod(period=%d)... \n",self,period);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_setPeriod(self,period);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",period);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_setPeriod],arglist);
@@ -145,6 +165,10 @@ PORT_RADIOTIMER_WIDTH radiotimer_getPeriod(OpenMote* self) {
    printf("C@0x%x: radiotimer_getPeriod()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_radiotimer_getPeriod(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_getPeriod],NULL);
    if (result == NULL) {
@@ -167,6 +191,16 @@ PORT_RADIOTIMER_WIDTH radiotimer_getPeriod(OpenMote* self) {
    return returnVal;
 }
 
+/**
+\brief Time during which the radiotimer doesn't need the board.
+
+The Python BSP does not model sleep levels, so this stand-in never lets the
+board go below SLEEP_IDLE, and saves a round trip to Python.
+*/
+PORT_RADIOTIMER_WIDTH radiotimer_getIdleTime(OpenMote* self) {
+   return 0;
+}
+
 //===== compare
 
 void radiotimer_schedule(OpenMote* self, PORT_RADIOTIMER_WIDTH offset) {
@@ -177,6 +211,11 @@ void radiotimer_schedule(OpenMote* self, PORT_RADIOTIMER_WIDTH offset) {
    printf("C@0x%x: radiotimer_schedule(offset=%d)... \n",self,offset);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_schedule(self,offset);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",offset);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_schedule],arglist);
@@ -199,6 +238,11 @@ void radiotimer_cancel(OpenMote* self) {
    printf("C@0x%x: radiotimer_cancel()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_radiotimer_cancel(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_cancel],NULL);
    if (result == NULL) {
@@ -222,6 +266,10 @@ PORT_RADIOTIMER_WIDTH radiotimer_getCapturedTime(OpenMote* self) {
    printf("C@0x%x: radiotimer_getCapturedTime()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_radiotimer_getValue(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_radiotimer_getCapturedTime],NULL);
    if (result == NULL) {
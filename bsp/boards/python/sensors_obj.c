@@ -0,0 +1,34 @@
+/**
+\brief Python-specific definition of the "sensors" bsp module.
+
+The emulated mote has no sensors.
+*/
+
+#include "opendefs_obj.h"
+#include "sensors.h"
+
+//=========================== defines =========================================
+
+//=========================== variables =======================================
+
+//=========================== prototypes ======================================
+
+//=========================== public ==========================================
+
+void sensors_init(void) {
+   // nothing to do
+}
+
+bool sensors_is_present(uint8_t sensorType) {
+   return FALSE;
+}
+
+callbackRead_cbt sensors_getCallbackRead(uint8_t sensorType) {
+   return NULL;
+}
+
+callbackConvert_cbt sensors_getCallbackConvert(uint8_t sensorType) {
+   return NULL;
+}
+
+//=========================== private =========================================
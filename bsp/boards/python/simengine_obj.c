@@ -0,0 +1,2101 @@
+/**
+\brief Native discrete-event simulation engine for the Python board.
+
+Time is kept in subticks (1/1024th of a 32kHz tick), so frame and serial byte
+durations don't accumulate rounding errors. The timers of a mote only see
+whole ticks.
+
+Cancelling an event doesn't remove it from the queue: each mote keeps a
+generation counter per type of event, incremented when events of that type
+are cancelled, and events carrying an older generation are skipped when due.
+
+With the SINR medium, a mote locks onto a frame it hears above the
+sensitivity, and stays locked on it whatever else starts. The frame is lost
+with the packet error rate of O-QPSK (IEEE802.15.4-2006, annex E) at the
+lowest SINR it went through, so a strong enough frame survives a collision.
+Shadowing and fading are drawn by hashing the seed with the link, channel
+and coherence period, rather than from the random generator, so the channels
+don't change with the order of events.
+
+A mote reads time from its own crystal, which runs 1+ppm/1e6 times as fast
+as the engine's. When the rate changes, the pending timer events of the mote
+are moved to match. A timer interrupt may be served up to the jitter late,
+but the counters it reads are not affected.
+
+A snapshot holds the memory of each mote as it is, from the interrupt
+callbacks to the end of the OpenMote. Pointers in it are found by scanning for
+values within the old mote or the old image of the module, since most of the
+stack's structures are packed, and moved to the new ones when restored.
+Coroutines are not saved: between two runs all motes are asleep in
+scheduler_start(), where a restored mote starts again.
+
+A remote mote has neither coroutine nor OpenMote: the frames it sent in its
+own process are replayed here, to the local motes only.
+*/
+
+#include "simengine_obj.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <link.h>
+#endif
+#include "board_obj.h"
+#include "bsp_timer_obj.h"
+#include "radio_obj.h"
+#include "radiotimer_obj.h"
+#include "uart_obj.h"
+
+//=========================== defines =========================================
+
+/// rtNextOverflow while the overflow interrupt hasn't scheduled the next one
+#define SIMENGINE_TICK_NONE           0xffffffffffffffffULL
+
+/// start of the part of an OpenMote saved in snapshots
+#define SIMENGINE_MOTE_STATE          offsetof(OpenMote,uart_icb)
+
+/// least time between publishing a frame and its SFD, drift included
+#define SIMENGINE_LOOKAHEAD           ((uint64_t)(PORT_delayTx-2)<<SIMENGINE_SUBTICK_SHIFT)
+
+//=========================== variables =======================================
+
+// mote whose coroutine is being switched to (makecontext can't portably pass a pointer)
+static simengine_mote_t* simengine_entering;
+
+//=========================== prototypes ======================================
+
+extern int mote_main(OpenMote* self);
+
+// coroutines
+static simengine_mote_t* simengine_newMote(simengine_t* e, bool remote);
+static void     simengine_runUntil(simengine_t* e, uint64_t end);
+static int      simengine_runLockstep(simengine_t* e, uint64_t end);
+static int      simengine_runRealtime(simengine_t* e, uint64_t end);
+static void     simengine_publish(simengine_mote_t* m, uint64_t time);
+static void     simengine_publishCancel(simengine_mote_t* m);
+static void     simengine_receiveFrames(simengine_t* e);
+// coroutines
+static void     simengine_ctxCreate(simengine_mote_t* m);
+static void     simengine_ctxSwitchToMote(simengine_mote_t* m);
+static void     simengine_ctxSwitchToEngine(simengine_mote_t* m);
+static void     simengine_moteEntry(void);
+static void     simengine_boot(simengine_mote_t* m);
+static void     simengine_afterIsr(simengine_mote_t* m);
+// event queue
+static void     simengine_schedule(simengine_mote_t* m, uint8_t type, uint64_t time);
+static void     simengine_scheduleTimer(simengine_mote_t* m, uint8_t type, uint64_t time);
+static void     simengine_cancel(simengine_mote_t* m, uint8_t type);
+static bool     simengine_isEarlier(simengine_event_t* a, simengine_event_t* b);
+static void     simengine_pop(simengine_t* e, simengine_event_t* ev);
+static void     simengine_dispatch(simengine_t* e, simengine_event_t* ev);
+// time
+static uint64_t simengine_localTime(simengine_mote_t* m, uint64_t time);
+static uint64_t simengine_nowTick(simengine_mote_t* m);
+static uint64_t simengine_tickToTime(simengine_mote_t* m, uint64_t tick);
+static void     simengine_clockUpdate(simengine_mote_t* m);
+static void     simengine_clockWalk(simengine_mote_t* m);
+static void     simengine_checkSync(simengine_mote_t* m);
+// handlers
+static void     simengine_radiotimerOverflow(simengine_mote_t* m);
+static void     simengine_radioTxStart(simengine_mote_t* m);
+static void     simengine_radioTxEnd(simengine_mote_t* m);
+static void     simengine_uartRx(simengine_mote_t* m);
+// helpers
+static simengine_link_t* simengine_link(simengine_t* e, uint16_t src, uint16_t dst);
+static float    simengine_random(simengine_t* e);
+static float    simengine_randomNormal(simengine_t* e);
+static void     simengine_radioOff(simengine_mote_t* m);
+static void     simengine_uartOutput(simengine_mote_t* m, uint8_t byte);
+// medium
+static float    simengine_pathLoss(simengine_t* e, float dx, float dy);
+static float    simengine_normal(uint64_t seed, uint64_t a, uint64_t b, uint64_t c, uint64_t d);
+static float    simengine_rxPower(simengine_t* e, simengine_mote_t* src, simengine_mote_t* dst);
+static float    simengine_interference(simengine_mote_t* r);
+static float    simengine_externalInterference(simengine_mote_t* r, uint64_t start, uint64_t end);
+static double   simengine_per(float sinr, uint8_t len);
+// snapshot
+static bool     simengine_write(FILE* f, const void* buf, size_t len);
+static bool     simengine_read(FILE* f, void* buf, size_t len);
+static void     simengine_codeRange(uint64_t* start, uint64_t* end);
+static void     simengine_relocate(OpenMote* self, uint64_t oldSelf, simengine_snapshotHeader_t* header);
+static void     simengine_relocateEntry(OpenQueueEntry_t* entry, uintptr_t dataDelta);
+static void     simengine_move(void* field, uintptr_t delta);
+
+//=========================== public ==========================================
+
+//===== engine
+
+simengine_t* simengine_new(uint64_t seed) {
+   simengine_t* e;
+
+   e = (simengine_t*)calloc(1,sizeof(simengine_t));
+   if (e==NULL) {
+      return NULL;
+   }
+   e->seed = seed ? seed : 0x9e3779b97f4a7c15ULL;
+   e->rand = e->seed;
+   // indoor, CC2420-like
+   e->medium.sinr             = FALSE;
+   e->medium.txPower          = 0;
+   e->medium.pathLoss1m       = 40;
+   e->medium.pathLossExponent = 3;
+   e->medium.shadowing        = 4;
+   e->medium.fading           = 4;
+   e->medium.coherence        = 0;
+   e->medium.noiseFloor       = -100;
+   e->medium.sensitivity      = -95;
+   // perfect crystals
+   e->clock.walkPeriod        = (uint64_t)32768<<SIMENGINE_SUBTICK_SHIFT;
+#ifdef _WIN32
+   e->ctx  = ConvertThreadToFiber(NULL);
+   if (e->ctx==NULL) {
+      // the thread already is a fiber
+      e->ctx = GetCurrentFiber();
+   }
+#endif
+   return e;
+}
+
+void simengine_free(simengine_t* e) {
+   simengine_mote_t* m;
+   uint16_t          i;
+
+   for (i=0;i<e->numMotes;i++) {
+      m = e->motes[i];
+      if (m->mote!=NULL) {
+         m->mote->sim = NULL;
+      }
+#ifdef _WIN32
+      if (m->ctx!=NULL) {
+         DeleteFiber(m->ctx);
+      }
+#endif
+      free(m->stack);
+      free(m->uartOut);
+      free(m->uartIn);
+      free(m);
+   }
+   free(e->motes);
+   free(e->links);
+   free(e->interferers);
+   free(e->heap);
+   if (e->shared!=NULL) {
+      simmedium_detach(e->shared);
+   }
+   free(e);
+}
+
+/**
+\brief Attach a mote to the engine.
+
+The mote boots at the current time, the next time the engine runs. It must
+not have been switched on through supply_on().
+
+\param[in] randomSeed Mixed into the seed openrandom derives from the
+   address of the mote, 0 to keep it.
+
+\returns The index of the mote in the engine, -1 if out of memory.
+*/
+int simengine_addMote(simengine_t* e, OpenMote* mote, uint8_t* eui64, uint16_t randomSeed) {
+   simengine_mote_t* m;
+
+   m = simengine_newMote(e,FALSE);
+   if (m==NULL) {
+      return -1;
+   }
+   m->mote              = mote;
+   memcpy(m->eui64,eui64,sizeof(m->eui64));
+   m->randomSeed        = randomSeed;
+   mote->sim            = m;
+
+   simengine_schedule(m,SIMENGINE_EVT_BOOT,e->now);
+   if (e->clock.drift>0) {
+      simengine_setDrift(e,m->idx,e->clock.drift*simengine_randomNormal(e));
+   }
+   if (e->clock.walk>0) {
+      simengine_schedule(m,SIMENGINE_EVT_CLOCK,e->now+e->clock.walkPeriod);
+   }
+   return m->idx;
+}
+
+/**
+\brief Add a mote which runs in another process sharing the medium.
+
+Its links, or its position, are set as those of a local mote, so the local
+motes hear its frames.
+
+\returns The index of the mote in the engine, -1 if out of memory.
+*/
+int simengine_addRemoteMote(simengine_t* e) {
+   simengine_mote_t* m;
+
+   m = simengine_newMote(e,TRUE);
+   if (m==NULL) {
+      return -1;
+   }
+   e->numRemoteMotes++;
+   return m->idx;
+}
+
+/**
+\brief Share the medium created by simmedium_create() with other processes.
+
+All processes must add the same motes in the same order, each adding the
+ones the others run as remote motes.
+
+\returns 0 on success, -1 with errno set if the medium can't be opened, -2 if
+   it is not a medium, proc is out of range, or a medium is already attached.
+*/
+int simengine_attachShared(simengine_t* e, const char* path, uint16_t proc) {
+   if (e->shared!=NULL) {
+      return -2;
+   }
+   return simmedium_attach(path,proc,&e->shared);
+}
+
+void simengine_setLink(simengine_t* e, uint16_t src, uint16_t dst, float pdr, int8_t rssi) {
+   simengine_link_t* link;
+
+   link       = simengine_link(e,src,dst);
+   link->pdr  = pdr;
+   link->rssi = rssi;
+}
+
+/**
+\brief Change the parameters of the medium.
+
+Only applies to the links set afterwards.
+*/
+void simengine_setMedium(simengine_t* e, simengine_medium_t* medium) {
+   memcpy(&e->medium,medium,sizeof(simengine_medium_t));
+}
+
+/**
+\brief Place a mote, in meters.
+
+Sets the links between the mote and those already placed, from the
+log-distance path loss and a shadowing proper to each pair of motes.
+*/
+void simengine_setPosition(simengine_t* e, uint16_t moteIdx, float x, float y) {
+   simengine_mote_t* m;
+   simengine_mote_t* o;
+   float             rssi;
+   uint16_t          i;
+
+   m              = e->motes[moteIdx];
+   m->hasPosition = TRUE;
+   m->x           = x;
+   m->y           = y;
+   for (i=0;i<e->numMotes;i++) {
+      o = e->motes[i];
+      if (o==m || o->hasPosition==FALSE) {
+         continue;
+      }
+      rssi  = e->medium.txPower-simengine_pathLoss(e,o->x-x,o->y-y);
+      rssi += e->medium.shadowing*simengine_normal(
+         e->seed,
+         0,
+         i<moteIdx ? i : moteIdx,
+         i<moteIdx ? moteIdx : i,
+         0
+      );
+      if (rssi<-128) {
+         // not even interference
+         simengine_setLink(e,moteIdx,i,0,0);
+         simengine_setLink(e,i,moteIdx,0,0);
+      } else {
+         rssi = rssi>127 ? 127 : rssi;
+         simengine_setLink(e,moteIdx,i,1,(int8_t)floorf(rssi+0.5f));
+         simengine_setLink(e,i,moteIdx,1,(int8_t)floorf(rssi+0.5f));
+      }
+   }
+}
+
+/**
+\returns The index of the interferer, -1 if out of memory.
+*/
+int simengine_addInterferer(simengine_t* e, simengine_interferer_t* interferer) {
+   simengine_interferer_t* interferers;
+
+   interferers = (simengine_interferer_t*)realloc(
+      e->interferers,
+      (e->numInterferers+1)*sizeof(simengine_interferer_t)
+   );
+   if (interferers==NULL) {
+      return -1;
+   }
+   e->interferers = interferers;
+   memcpy(&e->interferers[e->numInterferers],interferer,sizeof(simengine_interferer_t));
+   return e->numInterferers++;
+}
+
+/**
+\brief Change the model of the crystals.
+
+Draws the drift of every mote again, and restarts their random walk.
+*/
+void simengine_setClock(simengine_t* e, simengine_clock_t* clock) {
+   simengine_mote_t* m;
+   uint16_t          i;
+
+   memcpy(&e->clock,clock,sizeof(simengine_clock_t));
+   for (i=0;i<e->numMotes;i++) {
+      m         = e->motes[i];
+      if (m->remote==TRUE) {
+         continue;
+      }
+      m->wander = 0;
+      simengine_setDrift(e,i,e->clock.drift*simengine_randomNormal(e));
+      simengine_cancel(m,SIMENGINE_EVT_CLOCK);
+      if (e->clock.walk>0) {
+         simengine_schedule(m,SIMENGINE_EVT_CLOCK,e->now+e->clock.walkPeriod);
+      }
+   }
+}
+
+/**
+\brief Set the fixed part of the drift of a mote, in ppm.
+*/
+void simengine_setDrift(simengine_t* e, uint16_t moteIdx, float drift) {
+   e->motes[moteIdx]->drift = drift;
+   simengine_clockUpdate(e->motes[moteIdx]);
+}
+
+/**
+\brief Queue bytes for the serial port of a mote.
+
+They are delivered while the mote listens on serial, as a host would do when
+it sees a request frame.
+*/
+void simengine_serialInput(simengine_t* e, uint16_t moteIdx, uint8_t* buf, uint32_t len) {
+   simengine_mote_t* m;
+   uint8_t*          in;
+
+   m  = e->motes[moteIdx];
+   in = (uint8_t*)realloc(m->uartIn,m->uartInLen-m->uartInIdx+len);
+   if (in==NULL) {
+      return;
+   }
+   memmove(in,&in[m->uartInIdx],m->uartInLen-m->uartInIdx);
+   memcpy(&in[m->uartInLen-m->uartInIdx],buf,len);
+   m->uartIn     = in;
+   m->uartInLen  = m->uartInLen-m->uartInIdx+len;
+   m->uartInIdx  = 0;
+   if (m->uartIntEnabled==TRUE && m->uartRxArmed==FALSE) {
+      m->uartRxArmed = TRUE;
+      simengine_schedule(m,SIMENGINE_EVT_UART_RX,e->now+SIMENGINE_UART_BYTE_SUBTICKS);
+   }
+}
+
+/**
+\brief Take the bytes a mote wrote to its serial port since the last call.
+
+\param[out] buf Where to write the address of the bytes, to be freed by the
+   caller.
+
+\returns The number of bytes.
+*/
+uint32_t simengine_serialOutput(simengine_t* e, uint16_t moteIdx, uint8_t** buf) {
+   simengine_mote_t* m;
+   uint32_t          len;
+
+   m              = e->motes[moteIdx];
+   *buf           = m->uartOut;
+   len            = m->uartOutLen;
+   m->uartOut     = NULL;
+   m->uartOutLen  = 0;
+   m->uartOutSize = 0;
+   return len;
+}
+
+/**
+\brief Execute the events due in the next duration subticks.
+
+With a shared medium, all processes must run for the same durations.
+
+\returns 0 on success, -1 if another process aborted the shared medium.
+*/
+int simengine_run(simengine_t* e, uint64_t duration) {
+   uint64_t end;
+
+   end = e->now+duration;
+   if (e->shared==NULL) {
+      simengine_runUntil(e,end);
+      return 0;
+   }
+   if (e->shared->shm->mode==SIMMEDIUM_MODE_REALTIME) {
+      return simengine_runRealtime(e,end);
+   }
+   return simengine_runLockstep(e,end);
+}
+
+
+void simengine_getMoteStats(simengine_t* e, uint16_t moteIdx, simengine_moteStats_t* stats) {
+   simengine_mote_t* m;
+
+   m = e->motes[moteIdx];
+   memcpy(stats,&m->stats,sizeof(simengine_moteStats_t));
+   if (m->radioOn==TRUE) {
+      stats->radioOnTicks += simengine_nowTick(m)-m->radioOnSince;
+   }
+}
+
+//===== snapshot
+
+/**
+\brief Write the state of the engine and its motes to a file.
+
+Only the same build of the module can restore it. Must not be called while
+the engine runs.
+
+\returns 0 on success, -1 if the file could not be written.
+*/
+int simengine_snapshot(simengine_t* e, FILE* f) {
+   simengine_snapshotHeader_t header;
+   simengine_mote_t*          m;
+   uint64_t                   self;
+   uint16_t                   rxFrom;
+   uint16_t                   i;
+   bool                       ok;
+
+   if (e->current!=NULL || e->shared!=NULL || e->numRemoteMotes>0) {
+      return -1;
+   }
+
+   memset(&header,0,sizeof(header));
+   memcpy(header.magic,SIMENGINE_SNAPSHOT_MAGIC,sizeof(SIMENGINE_SNAPSHOT_MAGIC));
+   header.version        = SIMENGINE_SNAPSHOT_VERSION;
+   header.moteSize       = sizeof(OpenMote);
+   header.simMoteSize    = sizeof(simengine_mote_t);
+   header.numMotes       = e->numMotes;
+   header.numInterferers = e->numInterferers;
+   header.heapLen        = e->heapLen;
+   simengine_codeRange(&header.codeStart,&header.codeEnd);
+   ok  = simengine_write(f,&header,sizeof(header));
+
+   // engine
+   ok &= simengine_write(f,&e->now,sizeof(e->now));
+   ok &= simengine_write(f,&e->seq,sizeof(e->seq));
+   ok &= simengine_write(f,&e->seed,sizeof(e->seed));
+   ok &= simengine_write(f,&e->rand,sizeof(e->rand));
+   ok &= simengine_write(f,&e->medium,sizeof(e->medium));
+   ok &= simengine_write(f,&e->clock,sizeof(e->clock));
+   ok &= simengine_write(f,&e->stats,sizeof(e->stats));
+   ok &= simengine_write(f,e->interferers,e->numInterferers*sizeof(simengine_interferer_t));
+   for (i=0;i<e->numMotes;i++) {
+      ok &= simengine_write(f,simengine_link(e,i,0),e->numMotes*sizeof(simengine_link_t));
+   }
+   ok &= simengine_write(f,e->heap,e->heapLen*sizeof(simengine_event_t));
+
+   // motes
+   for (i=0;i<e->numMotes;i++) {
+      m      = e->motes[i];
+      self   = (uint64_t)(uintptr_t)m->mote;
+      rxFrom = m->rxFrom!=NULL ? m->rxFrom->idx : SIMENGINE_NO_MOTE;
+      ok &= simengine_write(f,&self,sizeof(self));
+      ok &= simengine_write(f,m,sizeof(simengine_mote_t));
+      ok &= simengine_write(f,&rxFrom,sizeof(rxFrom));
+      ok &= simengine_write(f,m->uartOut,m->uartOutLen);
+      ok &= simengine_write(f,m->uartIn,m->uartInLen);
+      ok &= simengine_write(f,(uint8_t*)m->mote+SIMENGINE_MOTE_STATE,sizeof(OpenMote)-SIMENGINE_MOTE_STATE);
+   }
+
+   return ok ? 0 : -1;
+}
+
+/**
+\brief Read the header of a snapshot, and check it was taken by this build.
+
+\returns 0 on success, -1 if the file is not such a snapshot.
+*/
+int simengine_readSnapshotHeader(FILE* f, simengine_snapshotHeader_t* header) {
+   if (
+         simengine_read(f,header,sizeof(simengine_snapshotHeader_t))==FALSE          ||
+         memcmp(header->magic,SIMENGINE_SNAPSHOT_MAGIC,sizeof(SIMENGINE_SNAPSHOT_MAGIC))!=0 ||
+         header->version!=SIMENGINE_SNAPSHOT_VERSION                                  ||
+         header->moteSize!=sizeof(OpenMote)                                           ||
+         header->simMoteSize!=sizeof(simengine_mote_t)
+      ) {
+      return -1;
+   }
+   return 0;
+}
+
+/**
+\brief Restore a snapshot into an engine without motes.
+
+\param[in] header As read by simengine_readSnapshotHeader().
+\param[in] motes  header->numMotes motes which were never switched on, to
+   take the state of the motes of the snapshot.
+
+\returns 0 on success, -1 if the file is truncated or out of memory. The
+   engine must then be freed.
+*/
+int simengine_restore(simengine_t* e, FILE* f, simengine_snapshotHeader_t* header, OpenMote** motes) {
+   simengine_mote_t*  m;
+   simengine_mote_t   saved;
+   simengine_event_t* heap;
+   uint8_t*           state;
+   uint16_t*          rxFrom;
+   uint64_t           self;
+   uint16_t           i;
+   bool               ok;
+
+   if (e->numMotes!=0) {
+      return -1;
+   }
+
+   // attach the motes first, anything it sets is overwritten below
+   memset(&saved,0,sizeof(saved));
+   for (i=0;i<header->numMotes;i++) {
+      if (simengine_addMote(e,motes[i],saved.eui64,0)<0) {
+         return -1;
+      }
+   }
+
+   // engine
+   ok  = simengine_read(f,&e->now,sizeof(e->now));
+   ok &= simengine_read(f,&e->seq,sizeof(e->seq));
+   ok &= simengine_read(f,&e->seed,sizeof(e->seed));
+   ok &= simengine_read(f,&e->rand,sizeof(e->rand));
+   ok &= simengine_read(f,&e->medium,sizeof(e->medium));
+   ok &= simengine_read(f,&e->clock,sizeof(e->clock));
+   ok &= simengine_read(f,&e->stats,sizeof(e->stats));
+   if (ok==FALSE) {
+      return -1;
+   }
+   if (header->numInterferers>0) {
+      e->interferers = (simengine_interferer_t*)malloc(header->numInterferers*sizeof(simengine_interferer_t));
+      if (e->interferers==NULL) {
+         return -1;
+      }
+      e->numInterferers = header->numInterferers;
+      ok &= simengine_read(f,e->interferers,e->numInterferers*sizeof(simengine_interferer_t));
+   }
+   for (i=0;i<e->numMotes;i++) {
+      ok &= simengine_read(f,simengine_link(e,i,0),e->numMotes*sizeof(simengine_link_t));
+   }
+   if (header->heapLen>e->heapSize) {
+      heap = (simengine_event_t*)realloc(e->heap,header->heapLen*sizeof(simengine_event_t));
+      if (heap==NULL) {
+         return -1;
+      }
+      e->heap     = heap;
+      e->heapSize = header->heapLen;
+   }
+   e->heapLen = header->heapLen;
+   ok &= simengine_read(f,e->heap,e->heapLen*sizeof(simengine_event_t));
+
+   // motes
+   state  = (uint8_t*)malloc(sizeof(OpenMote)-SIMENGINE_MOTE_STATE);
+   rxFrom = (uint16_t*)malloc(e->numMotes*sizeof(uint16_t));
+   if (state==NULL || rxFrom==NULL) {
+      free(state);
+      free(rxFrom);
+      return -1;
+   }
+   for (i=0;i<e->numMotes && ok==TRUE;i++) {
+      m   = e->motes[i];
+      ok &= simengine_read(f,&self,sizeof(self));
+      ok &= simengine_read(f,&saved,sizeof(saved));
+      ok &= simengine_read(f,&rxFrom[i],sizeof(rxFrom[i]));
+      if (ok==FALSE) {
+         break;
+      }
+
+      // all but what points to this process
+      saved.mote        = m->mote;
+      saved.engine      = e;
+      saved.idx         = i;
+      saved.ctx         = m->ctx;
+      saved.stack       = m->stack;
+      saved.rxFrom      = NULL;
+      saved.uartOut     = saved.uartOutSize>0 ? (uint8_t*)malloc(saved.uartOutSize) : NULL;
+      saved.uartIn      = saved.uartInLen>0   ? (uint8_t*)malloc(saved.uartInLen)   : NULL;
+      memcpy(m,&saved,sizeof(simengine_mote_t));
+      if ((m->uartOutSize>0 && m->uartOut==NULL) || (m->uartInLen>0 && m->uartIn==NULL)) {
+         ok = FALSE;
+         break;
+      }
+      ok &= simengine_read(f,m->uartOut,m->uartOutLen);
+      ok &= simengine_read(f,m->uartIn,m->uartInLen);
+
+      // the stack's memory
+      ok &= simengine_read(f,state,sizeof(OpenMote)-SIMENGINE_MOTE_STATE);
+      memcpy((uint8_t*)m->mote+SIMENGINE_MOTE_STATE,state,sizeof(OpenMote)-SIMENGINE_MOTE_STATE);
+      simengine_relocate(m->mote,self,header);
+      m->mote->sim      = m;
+
+      if (m->booted==TRUE) {
+         m->resuming    = TRUE;
+         simengine_ctxCreate(m);
+      }
+   }
+   for (i=0;i<e->numMotes && ok==TRUE;i++) {
+      if (rxFrom[i]!=SIMENGINE_NO_MOTE) {
+         if (rxFrom[i]>=e->numMotes) {
+            ok = FALSE;
+            break;
+         }
+         e->motes[i]->rxFrom = e->motes[rxFrom[i]];
+      }
+   }
+   free(state);
+   free(rxFrom);
+
+   return ok ? 0 : -1;
+}
+
+//===== board
+
+void simengine_board_sleep(OpenMote* self) {
+   simengine_ctxSwitchToEngine(self->sim);
+}
+
+void simengine_board_reset(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m               = self->sim;
+   m->resetPending = TRUE;
+   if (m->engine->current==m) {
+      // called from a task, never returns
+      simengine_ctxSwitchToEngine(m);
+   }
+   // called from an interrupt, the engine reboots the mote once it returns
+}
+
+//===== bsp_timer
+
+void simengine_bsp_timer_reset(OpenMote* self) {
+   self->sim->btReset       = simengine_nowTick(self->sim);
+   self->sim->btLastCompare = self->sim->btReset;
+   self->sim->btArmed       = FALSE;
+   simengine_cancel(self->sim,SIMENGINE_EVT_BSP_TIMER);
+}
+
+/**
+\brief Schedule the bsp_timer interrupt delayTicks after the previous compare.
+
+As the hardware does, the compare values are chained, and the interrupt fires
+right away if the new one is already passed.
+*/
+void simengine_bsp_timer_scheduleIn(OpenMote* self, PORT_TIMER_WIDTH delayTicks) {
+   simengine_mote_t* m;
+
+   m                = self->sim;
+   m->btLastCompare = m->btLastCompare+delayTicks;
+   m->btArmed       = TRUE;
+   simengine_cancel(m,SIMENGINE_EVT_BSP_TIMER);
+   // right away if already passed
+   simengine_scheduleTimer(m,SIMENGINE_EVT_BSP_TIMER,simengine_tickToTime(m,m->btLastCompare));
+}
+
+void simengine_bsp_timer_cancel_schedule(OpenMote* self) {
+   self->sim->btArmed = FALSE;
+   simengine_cancel(self->sim,SIMENGINE_EVT_BSP_TIMER);
+}
+
+PORT_TIMER_WIDTH simengine_bsp_timer_get_currentValue(OpenMote* self) {
+   return (PORT_TIMER_WIDTH)(simengine_nowTick(self->sim)-self->sim->btReset);
+}
+
+//===== eui64
+
+void simengine_eui64_get(OpenMote* self, uint8_t* addressToWrite) {
+   memcpy(addressToWrite,self->sim->eui64,sizeof(self->sim->eui64));
+}
+
+//===== radiotimer
+
+void simengine_radiotimer_init(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m                 = self->sim;
+   m->rtPeriod       = 0;
+   m->rtRunning      = FALSE;
+   m->rtCompareArmed = FALSE;
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_OVERFLOW);
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+}
+
+void simengine_radiotimer_start(OpenMote* self, PORT_RADIOTIMER_WIDTH period) {
+   simengine_mote_t* m;
+
+   m                 = self->sim;
+   m->rtLastOverflow = simengine_nowTick(m);
+   m->rtNextOverflow = m->rtLastOverflow+period;
+   m->rtRunning      = TRUE;
+   m->rtPeriod       = period;
+   m->rtCompareArmed = FALSE;
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_OVERFLOW);
+   simengine_scheduleTimer(
+      m,
+      SIMENGINE_EVT_RADIOTIMER_OVERFLOW,
+      simengine_tickToTime(m,m->rtNextOverflow)
+   );
+}
+
+PORT_RADIOTIMER_WIDTH simengine_radiotimer_getValue(OpenMote* self) {
+   return (PORT_RADIOTIMER_WIDTH)(simengine_nowTick(self->sim)-self->sim->rtLastOverflow);
+}
+
+/**
+\brief Change the period of the radiotimer.
+
+The counter keeps running. If it already went past the new period, it
+overflows right away.
+*/
+void simengine_radiotimer_setPeriod(OpenMote* self, PORT_RADIOTIMER_WIDTH period) {
+   simengine_mote_t* m;
+
+   m                 = self->sim;
+   m->rtPeriod       = period;
+   m->rtRunning      = TRUE;
+   m->rtNextOverflow = m->rtLastOverflow+period;
+   if (m->rtNextOverflow<simengine_nowTick(m)) {
+      m->rtNextOverflow = simengine_nowTick(m);
+   }
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_OVERFLOW);
+   simengine_scheduleTimer(
+      m,
+      SIMENGINE_EVT_RADIOTIMER_OVERFLOW,
+      simengine_tickToTime(m,m->rtNextOverflow)
+   );
+}
+
+PORT_RADIOTIMER_WIDTH simengine_radiotimer_getPeriod(OpenMote* self) {
+   return self->sim->rtPeriod;
+}
+
+/**
+\brief Arm the compare interrupt, for when the counter reaches offset.
+
+If the counter already went past offset, that's in the next period.
+*/
+void simengine_radiotimer_schedule(OpenMote* self, PORT_RADIOTIMER_WIDTH offset) {
+   simengine_mote_t* m;
+
+   m                  = self->sim;
+   m->rtCompareArmed  = TRUE;
+   m->rtCompareOffset = offset;
+   simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+   if (offset>simengine_radiotimer_getValue(self) && offset<m->rtPeriod) {
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_RADIOTIMER_COMPARE,
+         simengine_tickToTime(m,m->rtLastOverflow+offset)
+      );
+   }
+   // otherwise, scheduled at the next overflow
+}
+
+void simengine_radiotimer_cancel(OpenMote* self) {
+   self->sim->rtCompareArmed = FALSE;
+   simengine_cancel(self->sim,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+}
+
+//===== radio
+
+void simengine_radio_init(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m             = self->sim;
+   simengine_radioOff(m);
+   m->radioState = RADIOSTATE_RFOFF;
+   m->frequency  = 0;
+}
+
+void simengine_radio_setFrequency(OpenMote* self, uint8_t frequency) {
+   self->sim->frequency = frequency;
+}
+
+void simengine_radio_rfOff(OpenMote* self) {
+   simengine_radioOff(self->sim);
+   self->sim->radioState = RADIOSTATE_RFOFF;
+}
+
+void simengine_radio_loadPacket(OpenMote* self, uint8_t* packet, uint8_t len) {
+   simengine_mote_t* m;
+
+   m = self->sim;
+   if (len>sizeof(m->txBuf)) {
+      len = sizeof(m->txBuf);
+   }
+   memcpy(m->txBuf,packet,len);
+   m->txLen = len;
+}
+
+void simengine_radio_txEnable(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m = self->sim;
+   if (m->radioOn==FALSE) {
+      m->radioOn      = TRUE;
+      m->radioOnSince = simengine_nowTick(m);
+   }
+   m->radioState = RADIOSTATE_TX_ENABLED;
+}
+
+/**
+\brief Start transmitting the loaded frame.
+
+Its SFD goes out delayTx after this call, which is when the start of frame
+interrupt fires at the transmitter and at the receivers. Other processes are
+told now, and told again if the radio is switched off before the end of it.
+*/
+void simengine_radio_txNow(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m             = self->sim;
+   m->radioState = RADIOSTATE_TRANSMITTING;
+   m->txTime     = simengine_tickToTime(m,simengine_nowTick(m)+PORT_delayTx);
+   simengine_schedule(m,SIMENGINE_EVT_RADIO_TXSTART,m->txTime);
+   if (m->engine->shared!=NULL) {
+      simengine_publish(m,m->txTime);
+   }
+}
+
+void simengine_radio_rxEnable(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m = self->sim;
+   if (m->radioOn==FALSE) {
+      m->radioOn      = TRUE;
+      m->radioOnSince = simengine_nowTick(m);
+   }
+   m->radioState = RADIOSTATE_ENABLING_RX;
+}
+
+void simengine_radio_rxNow(OpenMote* self) {
+   self->sim->radioState = RADIOSTATE_LISTENING;
+}
+
+void simengine_radio_getReceivedFrame(OpenMote* self,
+                             uint8_t* pBufRead,
+                             uint8_t* pLenRead,
+                             uint8_t  maxBufLen,
+                              int8_t* pRssi,
+                             uint8_t* pLqi,
+                                bool* pCrc) {
+   simengine_mote_t* m;
+
+   m          = self->sim;
+   *pLenRead  = m->rxLen<maxBufLen ? m->rxLen : maxBufLen;
+   memcpy(pBufRead,m->rxBuf,*pLenRead);
+   *pRssi     = m->rxRssi;
+   *pLqi      = m->rxCrc ? 0xff : 0;
+   *pCrc      = m->rxCrc;
+}
+
+//===== uart
+
+void simengine_uart_init(OpenMote* self) {
+   self->sim->uartIntEnabled = FALSE;
+}
+
+void simengine_uart_enableInterrupts(OpenMote* self) {
+   simengine_mote_t* m;
+
+   m                 = self->sim;
+   m->uartIntEnabled = TRUE;
+   if (m->uartInIdx<m->uartInLen && m->uartRxArmed==FALSE) {
+      m->uartRxArmed = TRUE;
+      simengine_schedule(m,SIMENGINE_EVT_UART_RX,m->engine->now+SIMENGINE_UART_BYTE_SUBTICKS);
+   }
+}
+
+void simengine_uart_disableInterrupts(OpenMote* self) {
+   self->sim->uartIntEnabled = FALSE;
+}
+
+void simengine_uart_writeByte(OpenMote* self, uint8_t byteToWrite) {
+   simengine_mote_t* m;
+
+   m = self->sim;
+   simengine_uartOutput(m,byteToWrite);
+   simengine_schedule(m,SIMENGINE_EVT_UART_TX,m->engine->now+SIMENGINE_UART_BYTE_SUBTICKS);
+}
+
+/**
+\brief Write bytes to the serial port at once, without tx interrupt.
+
+What FASTSIM builds of openserial expect.
+*/
+void simengine_uart_writeBuffer(OpenMote* self, uint8_t* buffer, uint16_t len) {
+   simengine_mote_t* m;
+   uint16_t          i;
+
+   m = self->sim;
+   for (i=0;i<len;i++) {
+      simengine_uartOutput(m,buffer[i]);
+   }
+}
+
+uint8_t simengine_uart_readByte(OpenMote* self) {
+   return self->sim->uartRxByte;
+}
+
+//=========================== private =========================================
+
+//===== engine
+
+/**
+\returns A mote appended to the engine, with a coroutine stack unless it is
+   remote, NULL if out of memory.
+*/
+static simengine_mote_t* simengine_newMote(simengine_t* e, bool remote) {
+   simengine_mote_t*  m;
+   simengine_mote_t** motes;
+   simengine_link_t*  links;
+   uint16_t           maxMotes;
+   uint16_t           i;
+
+   // make room, the link matrix grows with the number of motes
+   if (e->numMotes==e->maxMotes) {
+      maxMotes = e->maxMotes ? 2*e->maxMotes : 16;
+      motes    = (simengine_mote_t**)realloc(e->motes,maxMotes*sizeof(simengine_mote_t*));
+      links    = (simengine_link_t*)calloc((size_t)maxMotes*maxMotes,sizeof(simengine_link_t));
+      if (motes==NULL || links==NULL) {
+         free(links);
+         return NULL;
+      }
+      for (i=0;i<e->numMotes;i++) {
+         memcpy(&links[i*maxMotes],&e->links[i*e->maxMotes],e->numMotes*sizeof(simengine_link_t));
+      }
+      free(e->links);
+      e->motes    = motes;
+      e->links    = links;
+      e->maxMotes = maxMotes;
+   }
+
+   m = (simengine_mote_t*)calloc(1,sizeof(simengine_mote_t));
+   if (m==NULL) {
+      return NULL;
+   }
+   if (remote==FALSE) {
+      m->stack = (uint8_t*)malloc(SIMENGINE_STACK_SIZE);
+      if (m->stack==NULL) {
+         free(m);
+         return NULL;
+      }
+   }
+   m->engine            = e;
+   m->idx               = e->numMotes;
+   m->remote            = remote;
+   m->clkRate           = 1;
+   m->clkAnchorTime     = e->now;
+   m->clkAnchorLocal    = e->now;
+   e->motes[e->numMotes++] = m;
+   return m;
+}
+
+/**
+\brief Execute the events due up to end, included.
+*/
+static void simengine_runUntil(simengine_t* e, uint64_t end) {
+   simengine_event_t ev;
+
+   while (e->heapLen>0 && e->heap[0].time<=end) {
+      simengine_pop(e,&ev);
+      if (ev.gen!=e->motes[ev.moteIdx]->gen[ev.type]) {
+         e->stats.numStaleEvents++;
+         continue;
+      }
+      e->now = ev.time;
+      e->stats.numEvents++;
+      simengine_dispatch(e,&ev);
+   }
+   e->now = end;
+}
+
+/**
+\brief Run in windows, in step with the other processes sharing the medium.
+
+A window ends just before the earliest pending event of all processes plus
+the lookahead, so the frames published in it start in a later one. They are
+received once all processes are done with the window.
+*/
+static int simengine_runLockstep(simengine_t* e, uint64_t end) {
+   uint64_t earliest;
+   uint64_t horizon;
+
+   do {
+      if (simmedium_exchange(e->shared,e->heapLen>0 ? e->heap[0].time : SIMENGINE_TICK_NONE,&earliest)<0) {
+         return -1;
+      }
+      if (earliest>=end || end-earliest<=SIMENGINE_LOOKAHEAD) {
+         horizon = end;
+      } else {
+         horizon = earliest+SIMENGINE_LOOKAHEAD-1;
+      }
+      simengine_runUntil(e,horizon);
+      e->stats.numWindows++;
+      if (simmedium_barrier(e->shared)<0) {
+         return -1;
+      }
+      simengine_receiveFrames(e);
+   } while (horizon<end);
+   return 0;
+}
+
+/**
+\brief Run at the pace of the wall clock, receiving frames as they come.
+
+The processes agree on when the wall clock starts, at their first run. Each
+step is half the lookahead, so a frame published in a step of another
+process is usually received before it starts.
+*/
+static int simengine_runRealtime(simengine_t* e, uint64_t end) {
+   uint64_t horizon;
+
+   if (e->shared->wallStart==0 && simmedium_start(e->shared,e->now)<0) {
+      return -1;
+   }
+   while (e->now<end) {
+      if (simmedium_isAborted(e->shared)) {
+         return -1;
+      }
+      simengine_receiveFrames(e);
+      horizon = e->now+SIMENGINE_LOOKAHEAD/2;
+      if (horizon>end) {
+         horizon = end;
+      }
+      simengine_runUntil(e,horizon);
+      simmedium_sleepUntil(
+         e->shared->wallStart+
+         (uint64_t)((double)(horizon-e->shared->timeStart)*1e9/(32768<<SIMENGINE_SUBTICK_SHIFT))
+      );
+   }
+   return 0;
+}
+
+static void simengine_publish(simengine_mote_t* m, uint64_t time) {
+   simmedium_frame_t frame;
+
+   frame.time      = time;
+   frame.src       = m->idx;
+   frame.frequency = m->frequency;
+   frame.len       = m->txLen;
+   memcpy(frame.buf,m->txBuf,m->txLen);
+   simmedium_publish(m->engine->shared,&frame);
+   m->engine->stats.numFramesOut++;
+}
+
+/**
+\brief Tell the other processes the frame of m was cut short.
+
+Published as an empty frame with the start time of the one it cancels, after
+which it is sorted.
+*/
+static void simengine_publishCancel(simengine_mote_t* m) {
+   simmedium_frame_t frame;
+
+   frame.time      = m->txTime;
+   frame.src       = m->idx;
+   frame.frequency = m->frequency;
+   frame.len       = 0;
+   simmedium_publish(m->engine->shared,&frame);
+}
+
+/**
+\brief Replay the frames remote motes published, as their own transmissions.
+*/
+static void simengine_receiveFrames(simengine_t* e) {
+   simmedium_frame_t* frames;
+   simengine_mote_t*  m;
+   uint64_t           time;
+   uint32_t           numFrames;
+   uint32_t           numLost;
+   uint32_t           i;
+
+   numFrames = simmedium_receive(e->shared,&frames,&numLost);
+   e->stats.numFramesLost += numLost;
+   for (i=0;i<numFrames;i++) {
+      if (frames[i].src>=e->numMotes || e->motes[frames[i].src]->remote==FALSE) {
+         // the processes don't agree on who runs which mote
+         e->stats.numFramesLost++;
+         continue;
+      }
+      m         = e->motes[frames[i].src];
+      if (frames[i].len==0) {
+         // cancelled, the receivers lose it unless it already ended
+         if (m->radioState==RADIOSTATE_TRANSMITTING) {
+            simengine_radioOff(m);
+            m->radioState = RADIOSTATE_RFOFF;
+         } else {
+            e->stats.numFramesLate++;
+         }
+         continue;
+      }
+      m->radioState = RADIOSTATE_TRANSMITTING;
+      memcpy(m->txBuf,frames[i].buf,frames[i].len);
+      m->txLen     = frames[i].len;
+      m->frequency = frames[i].frequency;
+      time         = frames[i].time;
+      if (time<e->now) {
+         time = e->now;
+         e->stats.numFramesLate++;
+      }
+      simengine_schedule(m,SIMENGINE_EVT_RADIO_TXSTART,time);
+      e->stats.numFramesIn++;
+   }
+}
+
+//===== coroutines
+
+#ifdef _WIN32
+static void CALLBACK simengine_fiberEntry(LPVOID param) {
+   simengine_moteEntry();
+}
+#endif
+
+static void simengine_ctxCreate(simengine_mote_t* m) {
+#ifdef _WIN32
+   if (m->ctx!=NULL) {
+      DeleteFiber(m->ctx);
+   }
+   m->ctx = CreateFiber(SIMENGINE_STACK_SIZE,simengine_fiberEntry,NULL);
+#else
+   getcontext(&m->ctx);
+   m->ctx.uc_stack.ss_sp   = m->stack;
+   m->ctx.uc_stack.ss_size = SIMENGINE_STACK_SIZE;
+   m->ctx.uc_link          = &m->engine->ctx;
+   makecontext(&m->ctx,simengine_moteEntry,0);
+#endif
+}
+
+static void simengine_ctxSwitchToMote(simengine_mote_t* m) {
+   m->engine->current = m;
+   m->engine->stats.numSwitches++;
+   m->stats.numWakeups++;
+   simengine_entering = m;
+#ifdef _WIN32
+   SwitchToFiber(m->ctx);
+#else
+   swapcontext(&m->engine->ctx,&m->ctx);
+#endif
+   m->engine->current = NULL;
+}
+
+static void simengine_ctxSwitchToEngine(simengine_mote_t* m) {
+#ifdef _WIN32
+   SwitchToFiber(m->engine->ctx);
+#else
+   swapcontext(&m->ctx,&m->engine->ctx);
+#endif
+}
+
+static void simengine_moteEntry(void) {
+   simengine_mote_t* m;
+
+   m = simengine_entering;
+   if (m->resuming==TRUE) {
+      // restored from a snapshot, the stack is initialized and asleep
+      m->resuming = FALSE;
+      powermanager_wakeup(m->mote);
+      scheduler_start(m->mote);
+   } else {
+      mote_main(m->mote);
+   }
+   // neither ever returns
+   m->resetPending = TRUE;
+   simengine_ctxSwitchToEngine(m);
+}
+
+/**
+\brief (Re)start a mote from mote_main(), until it first goes to sleep.
+*/
+static void simengine_boot(simengine_mote_t* m) {
+   uint8_t type;
+
+   do {
+      // forget about the events of the previous run, the crystal goes on
+      for (type=0;type<SIMENGINE_EVT_MAX;type++) {
+         if (type!=SIMENGINE_EVT_CLOCK) {
+            simengine_cancel(m,type);
+         }
+      }
+      simengine_radioOff(m);
+      m->radioState     = RADIOSTATE_RFOFF;
+      m->uartIntEnabled = FALSE;
+      m->uartRxArmed    = FALSE;
+      if (m->booted==TRUE) {
+         m->stats.numResets++;
+      }
+      m->booted         = TRUE;
+      m->resetPending   = FALSE;
+
+      simengine_ctxCreate(m);
+      simengine_ctxSwitchToMote(m);
+   } while (m->resetPending==TRUE);
+}
+
+/**
+\brief Let the mote run the tasks an interrupt posted.
+*/
+static void simengine_afterIsr(simengine_mote_t* m) {
+   simengine_checkSync(m);
+   if (m->resetPending==TRUE) {
+      simengine_boot(m);
+   } else if (m->mote->scheduler_vars.readyMask!=0) {
+      simengine_ctxSwitchToMote(m);
+      if (m->resetPending==TRUE) {
+         simengine_boot(m);
+      }
+   }
+}
+
+//===== event queue
+
+static void simengine_schedule(simengine_mote_t* m, uint8_t type, uint64_t time) {
+   simengine_t*       e;
+   simengine_event_t* heap;
+   simengine_event_t  ev;
+   uint32_t           i;
+
+   e = m->engine;
+   if (e->heapLen==e->heapSize) {
+      heap = (simengine_event_t*)realloc(e->heap,(e->heapSize ? 2*e->heapSize : 256)*sizeof(simengine_event_t));
+      if (heap==NULL) {
+         fprintf(stderr,"[CRITICAL] simengine: out of memory for events\r\n");
+         return;
+      }
+      e->heap     = heap;
+      e->heapSize = e->heapSize ? 2*e->heapSize : 256;
+   }
+
+   ev.time    = time;
+   ev.seq     = e->seq++;
+   ev.gen     = m->gen[type];
+   ev.moteIdx = m->idx;
+   ev.type    = type;
+
+   // sift up
+   i = e->heapLen++;
+   while (i>0 && simengine_isEarlier(&ev,&e->heap[(i-1)/2])) {
+      e->heap[i] = e->heap[(i-1)/2];
+      i          = (i-1)/2;
+   }
+   e->heap[i] = ev;
+}
+
+/**
+\brief Schedule a timer interrupt, served up to the jitter late.
+*/
+static void simengine_scheduleTimer(simengine_mote_t* m, uint8_t type, uint64_t time) {
+   if (m->engine->clock.jitter>0) {
+      time += (uint64_t)(simengine_random(m->engine)*m->engine->clock.jitter);
+   }
+   simengine_schedule(m,type,time);
+}
+
+static void simengine_cancel(simengine_mote_t* m, uint8_t type) {
+   m->gen[type]++;
+}
+
+static bool simengine_isEarlier(simengine_event_t* a, simengine_event_t* b) {
+   if (a->time!=b->time) {
+      return a->time<b->time;
+   }
+   // sequence numbers wrap around, compare their distance
+   return (int32_t)(a->seq-b->seq)<0;
+}
+
+static void simengine_pop(simengine_t* e, simengine_event_t* ev) {
+   simengine_event_t last;
+   uint32_t          i;
+   uint32_t          child;
+
+   *ev  = e->heap[0];
+   last = e->heap[--e->heapLen];
+
+   // sift down
+   i = 0;
+   while ((child=2*i+1)<e->heapLen) {
+      if (child+1<e->heapLen && simengine_isEarlier(&e->heap[child+1],&e->heap[child])) {
+         child++;
+      }
+      if (!simengine_isEarlier(&e->heap[child],&last)) {
+         break;
+      }
+      e->heap[i] = e->heap[child];
+      i          = child;
+   }
+   e->heap[i] = last;
+}
+
+static void simengine_dispatch(simengine_t* e, simengine_event_t* ev) {
+   simengine_mote_t* m;
+
+   m = e->motes[ev->moteIdx];
+   switch (ev->type) {
+      case SIMENGINE_EVT_BOOT:
+         simengine_boot(m);
+         break;
+      case SIMENGINE_EVT_RADIOTIMER_OVERFLOW:
+         simengine_radiotimerOverflow(m);
+         break;
+      case SIMENGINE_EVT_RADIOTIMER_COMPARE:
+         m->rtCompareArmed = FALSE;
+         radiotimer_intr_compare(m->mote);
+         simengine_afterIsr(m);
+         break;
+      case SIMENGINE_EVT_BSP_TIMER:
+         m->btArmed = FALSE;
+         bsp_timer_isr(m->mote);
+         simengine_afterIsr(m);
+         break;
+      case SIMENGINE_EVT_RADIO_TXSTART:
+         simengine_radioTxStart(m);
+         break;
+      case SIMENGINE_EVT_RADIO_TXEND:
+         simengine_radioTxEnd(m);
+         break;
+      case SIMENGINE_EVT_UART_TX:
+         if (m->uartIntEnabled==TRUE) {
+            uart_intr_tx(m->mote);
+            simengine_afterIsr(m);
+         }
+         break;
+      case SIMENGINE_EVT_UART_RX:
+         simengine_uartRx(m);
+         break;
+      case SIMENGINE_EVT_CLOCK:
+         simengine_clockWalk(m);
+         break;
+      default:
+         break;
+   }
+}
+
+//===== time
+
+/**
+\returns What the crystal of m reads at time, in subticks.
+*/
+static uint64_t simengine_localTime(simengine_mote_t* m, uint64_t time) {
+   return m->clkAnchorLocal+(uint64_t)((double)(time-m->clkAnchorTime)*m->clkRate);
+}
+
+static uint64_t simengine_nowTick(simengine_mote_t* m) {
+   return simengine_localTime(m,m->engine->now)>>SIMENGINE_SUBTICK_SHIFT;
+}
+
+/**
+\returns The first time at which the crystal of m reads tick, now if it
+   already did.
+*/
+static uint64_t simengine_tickToTime(simengine_mote_t* m, uint64_t tick) {
+   uint64_t local;
+   uint64_t time;
+
+   local = tick<<SIMENGINE_SUBTICK_SHIFT;
+   if (local<=m->clkAnchorLocal) {
+      return m->engine->now;
+   }
+   if (m->clkRate==1) {
+      // perfect crystal
+      time = m->clkAnchorTime+(local-m->clkAnchorLocal);
+      return time<m->engine->now ? m->engine->now : time;
+   }
+   time = m->clkAnchorTime+(uint64_t)ceil((double)(local-m->clkAnchorLocal)/m->clkRate);
+   // make up for the rounding
+   while (simengine_localTime(m,time)<local) {
+      time++;
+   }
+   return time<m->engine->now ? m->engine->now : time;
+}
+
+/**
+\brief Apply the drift of m from now on, moving its pending timer events.
+*/
+static void simengine_clockUpdate(simengine_mote_t* m) {
+   simengine_t* e;
+
+   e                 = m->engine;
+   m->clkAnchorLocal = simengine_localTime(m,e->now);
+   m->clkAnchorTime  = e->now;
+   m->clkRate        = 1+(double)(m->drift+m->wander)/1e6;
+
+   if (m->rtRunning==TRUE) {
+      simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_OVERFLOW);
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_RADIOTIMER_OVERFLOW,
+         simengine_tickToTime(m,m->rtNextOverflow)
+      );
+   }
+   if (
+         m->rtCompareArmed==TRUE                                   &&
+         m->rtCompareOffset<m->rtPeriod                            &&
+         m->rtLastOverflow+m->rtCompareOffset>=simengine_nowTick(m)
+      ) {
+      simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_RADIOTIMER_COMPARE,
+         simengine_tickToTime(m,m->rtLastOverflow+m->rtCompareOffset)
+      );
+   }
+   if (m->btArmed==TRUE) {
+      simengine_cancel(m,SIMENGINE_EVT_BSP_TIMER);
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_BSP_TIMER,
+         simengine_tickToTime(m,m->btLastCompare)
+      );
+   }
+}
+
+/**
+\brief One step of the random walk of the drift of m, as temperature changes.
+*/
+static void simengine_clockWalk(simengine_mote_t* m) {
+   simengine_t* e;
+
+   e          = m->engine;
+   m->wander += e->clock.walk*simengine_randomNormal(e);
+   if (m->wander>e->clock.walkMax) {
+      m->wander = e->clock.walkMax;
+   } else if (m->wander<-e->clock.walkMax) {
+      m->wander = -e->clock.walkMax;
+   }
+   simengine_clockUpdate(m);
+   simengine_schedule(m,SIMENGINE_EVT_CLOCK,e->now+e->clock.walkPeriod);
+}
+
+/**
+\brief Record the time correction if the interrupt resynchronized the mote.
+
+synchronizePacket() applies it as the period of the current slot.
+*/
+static void simengine_checkSync(simengine_mote_t* m) {
+   int16_t correction;
+
+   if ((uint8_t)(m->mote->ieee154e_stats.numSyncPkt-m->numSyncPkt)==1) {
+      correction = (int16_t)((PORT_SIGNED_INT_WIDTH)m->rtPeriod-(PORT_SIGNED_INT_WIDTH)TsSlotDuration);
+      if (m->stats.numTimeCorrections==0 || correction<m->stats.minTimeCorrection) {
+         m->stats.minTimeCorrection = correction;
+      }
+      if (m->stats.numTimeCorrections==0 || correction>m->stats.maxTimeCorrection) {
+         m->stats.maxTimeCorrection = correction;
+      }
+      m->stats.numTimeCorrections++;
+      m->stats.sumAbsTimeCorrection += correction<0 ? -correction : correction;
+      if (correction<-LIMITLARGETIMECORRECTION || correction>LIMITLARGETIMECORRECTION) {
+         m->stats.numLargeTimeCorrections++;
+      }
+   }
+   // also follows the resets of the statistics
+   m->numSyncPkt = m->mote->ieee154e_stats.numSyncPkt;
+}
+
+//===== handlers
+
+static void simengine_radiotimerOverflow(simengine_mote_t* m) {
+
+   // the counter wrapped when due, even if the interrupt is served late
+   m->rtLastOverflow = m->rtNextOverflow;
+   // IEEE802154E sets the period at the start of every slot, which schedules
+   // the next overflow: doing it here as well would only leave a stale event
+   m->rtNextOverflow = SIMENGINE_TICK_NONE;
+
+   // a compare armed for a value the counter had already passed
+   if (m->rtCompareArmed==TRUE && m->rtCompareOffset<m->rtPeriod) {
+      simengine_cancel(m,SIMENGINE_EVT_RADIOTIMER_COMPARE);
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_RADIOTIMER_COMPARE,
+         simengine_tickToTime(m,m->rtLastOverflow+m->rtCompareOffset)
+      );
+   }
+
+   radiotimer_intr_overflow(m->mote);
+   if (m->rtRunning==TRUE && m->rtNextOverflow==SIMENGINE_TICK_NONE) {
+      m->rtNextOverflow = m->rtLastOverflow+m->rtPeriod;
+      simengine_scheduleTimer(
+         m,
+         SIMENGINE_EVT_RADIOTIMER_OVERFLOW,
+         simengine_tickToTime(m,m->rtNextOverflow)
+      );
+   }
+   simengine_afterIsr(m);
+}
+
+/**
+\brief The SFD of the frame of m goes out.
+
+Motes listening on the same frequency, in range, lock onto it. Those already
+receiving another frame in range see it corrupted, or interfered with when
+the medium is SINR-based.
+*/
+static void simengine_radioTxStart(simengine_mote_t* m) {
+   simengine_t*      e;
+   simengine_mote_t* r;
+   simengine_link_t* link;
+   float             power;
+   float             interference;
+   uint16_t          i;
+
+   e = m->engine;
+   m->stats.numTx++;
+   m->txOnAir = TRUE;
+   simengine_schedule(
+      m,
+      SIMENGINE_EVT_RADIO_TXEND,
+      e->now+(uint64_t)(1+m->txLen)*SIMENGINE_RADIO_BYTE_SUBTICKS
+   );
+
+   for (i=0;i<e->numMotes;i++) {
+      r    = e->motes[i];
+      link = simengine_link(e,m->idx,r->idx);
+      if (r==m || link->pdr<=0 || r->frequency!=m->frequency) {
+         continue;
+      }
+      if (e->medium.sinr==TRUE) {
+         power = simengine_rxPower(e,m,r);
+         if (r->radioState==RADIOSTATE_LISTENING && power>=e->medium.sensitivity) {
+            r->radioState     = RADIOSTATE_RECEIVING;
+            r->rxFrom         = m;
+            r->rxCollision    = FALSE;
+            r->rxStart        = e->now;
+            r->rxRssi         = (int8_t)floorf(power+0.5f);
+            r->rxInterference = simengine_interference(r);
+            radio_intr_startOfFrame(r->mote,simengine_radiotimer_getValue(r->mote));
+            simengine_afterIsr(r);
+         } else if (r->radioState==RADIOSTATE_RECEIVING) {
+            interference = simengine_interference(r);
+            if (interference>r->rxInterference) {
+               r->rxInterference = interference;
+            }
+            if (r->rxCollision==FALSE) {
+               r->rxCollision = TRUE;
+               r->stats.numCollisions++;
+            }
+         }
+      } else if (r->radioState==RADIOSTATE_LISTENING) {
+         r->radioState  = RADIOSTATE_RECEIVING;
+         r->rxFrom      = m;
+         r->rxCollision = FALSE;
+         radio_intr_startOfFrame(r->mote,simengine_radiotimer_getValue(r->mote));
+         simengine_afterIsr(r);
+      } else if (r->radioState==RADIOSTATE_RECEIVING && r->rxCollision==FALSE) {
+         r->rxCollision = TRUE;
+         r->stats.numCollisions++;
+      }
+   }
+
+   if (m->remote==FALSE) {
+      radio_intr_startOfFrame(m->mote,simengine_radiotimer_getValue(m->mote));
+      simengine_afterIsr(m);
+   }
+}
+
+/**
+\brief The last byte of the frame of m goes out.
+
+Each mote locked onto it receives it, with a bad CRC if it was corrupted, or
+with the probability 1-pdr of the link. With the SINR medium, it is corrupted
+with the packet error rate at the lowest SINR during the frame.
+*/
+static void simengine_radioTxEnd(simengine_mote_t* m) {
+   simengine_t*      e;
+   simengine_mote_t* r;
+   simengine_link_t* link;
+   float             noise;
+   float             sinr;
+   uint8_t           channel;
+   uint16_t          i;
+
+   e             = m->engine;
+   m->radioState = RADIOSTATE_TXRX_DONE;
+   m->txOnAir    = FALSE;
+
+   for (i=0;i<e->numMotes;i++) {
+      r = e->motes[i];
+      if (r->rxFrom!=m || r->radioState!=RADIOSTATE_RECEIVING) {
+         continue;
+      }
+      link           = simengine_link(e,m->idx,r->idx);
+      r->rxFrom      = NULL;
+      r->radioState  = RADIOSTATE_TXRX_DONE;
+      memcpy(r->rxBuf,m->txBuf,m->txLen);
+      r->rxLen       = m->txLen;
+      if (e->medium.sinr==TRUE) {
+         noise       = powf(10,e->medium.noiseFloor/10)+
+                       r->rxInterference+
+                       simengine_externalInterference(r,r->rxStart,e->now);
+         sinr        = powf(10,r->rxRssi/10.0f)/noise;
+         r->rxCrc    = simengine_random(e)>=simengine_per(sinr,m->txLen) &&
+                       simengine_random(e)<link->pdr;
+      } else {
+         r->rxRssi   = link->rssi;
+         r->rxCrc    = r->rxCollision==FALSE && simengine_random(e)<link->pdr;
+      }
+      channel        = (uint8_t)(r->frequency-11)%SIMENGINE_NUM_CHANNELS;
+      if (r->rxCrc==TRUE) {
+         r->stats.numRx++;
+         r->stats.numRxPerChannel[channel]++;
+      } else {
+         r->stats.numRxCrcError++;
+         r->stats.numRxCrcErrorPerChannel[channel]++;
+      }
+      radio_intr_endOfFrame(r->mote,simengine_radiotimer_getValue(r->mote));
+      simengine_afterIsr(r);
+   }
+
+   if (m->remote==FALSE) {
+      radio_intr_endOfFrame(m->mote,simengine_radiotimer_getValue(m->mote));
+      simengine_afterIsr(m);
+   }
+}
+
+/**
+\note Bytes are only delivered while openserial listens, they wait otherwise.
+*/
+static void simengine_uartRx(simengine_mote_t* m) {
+
+   m->uartRxArmed = FALSE;
+   if (
+         m->uartIntEnabled==FALSE ||
+         m->mote->openserial_vars.mode!=MODE_INPUT ||
+         m->uartInIdx==m->uartInLen
+      ) {
+      // re-armed the next time interrupts are enabled
+      return;
+   }
+
+   m->uartRxByte = m->uartIn[m->uartInIdx++];
+   if (m->uartInIdx<m->uartInLen) {
+      m->uartRxArmed = TRUE;
+      simengine_schedule(m,SIMENGINE_EVT_UART_RX,m->engine->now+SIMENGINE_UART_BYTE_SUBTICKS);
+   }
+
+   uart_intr_rx(m->mote);
+   simengine_afterIsr(m);
+}
+
+//===== helpers
+
+static simengine_link_t* simengine_link(simengine_t* e, uint16_t src, uint16_t dst) {
+   return &e->links[(size_t)src*e->maxMotes+dst];
+}
+
+/**
+\returns A number uniformly distributed in [0,1).
+*/
+static float simengine_random(simengine_t* e) {
+   // xorshift64*
+   e->rand ^= e->rand>>12;
+   e->rand ^= e->rand<<25;
+   e->rand ^= e->rand>>27;
+   return (float)((e->rand*0x2545f4914f6cdd1dULL)>>40)/(float)(1<<24);
+}
+
+/**
+\returns A number normally distributed.
+*/
+static float simengine_randomNormal(simengine_t* e) {
+   float u1;
+
+   // Box-Muller, u1 in (0,1]
+   u1 = 1-simengine_random(e);
+   return sqrtf(-2*logf(u1))*cosf(6.2831853f*simengine_random(e));
+}
+
+/**
+\brief Switch the radio off, aborting any frame being sent or received.
+*/
+static void simengine_radioOff(simengine_mote_t* m) {
+   simengine_t* e;
+   uint16_t     i;
+
+   e = m->engine;
+   if (m->radioOn==TRUE) {
+      m->stats.radioOnTicks += simengine_nowTick(m)-m->radioOnSince;
+      m->radioOn = FALSE;
+   }
+   if (m->radioState==RADIOSTATE_TRANSMITTING) {
+      if (e->shared!=NULL && m->remote==FALSE) {
+         simengine_publishCancel(m);
+      }
+      // the receivers lose the frame
+      for (i=0;i<e->numMotes;i++) {
+         if (e->motes[i]->rxFrom==m) {
+            e->motes[i]->rxFrom     = NULL;
+            e->motes[i]->radioState = RADIOSTATE_LISTENING;
+         }
+      }
+   }
+   simengine_cancel(m,SIMENGINE_EVT_RADIO_TXSTART);
+   simengine_cancel(m,SIMENGINE_EVT_RADIO_TXEND);
+   m->txOnAir = FALSE;
+   m->rxFrom  = NULL;
+}
+
+/**
+\brief Append a byte to the serial output of a mote, until Python reads it.
+*/
+static void simengine_uartOutput(simengine_mote_t* m, uint8_t byte) {
+   uint8_t*          out;
+   uint32_t          size;
+
+   if (m->uartOutLen==m->uartOutSize && m->uartOutSize<SIMENGINE_UART_MAX_OUTPUT) {
+      size = m->uartOutSize ? 2*m->uartOutSize : 256;
+      if (size>SIMENGINE_UART_MAX_OUTPUT) {
+         size = SIMENGINE_UART_MAX_OUTPUT;
+      }
+      out  = (uint8_t*)realloc(m->uartOut,size);
+      if (out!=NULL) {
+         m->uartOut     = out;
+         m->uartOutSize = size;
+      }
+   }
+   if (m->uartOutLen<m->uartOutSize) {
+      m->uartOut[m->uartOutLen++] = byte;
+   } else {
+      m->stats.numUartDropped++;
+   }
+}
+
+//===== snapshot
+
+static bool simengine_write(FILE* f, const void* buf, size_t len) {
+   return len==0 || fwrite(buf,len,1,f)==1;
+}
+
+static bool simengine_read(FILE* f, void* buf, size_t len) {
+   return len==0 || fread(buf,len,1,f)==1;
+}
+
+#ifndef _WIN32
+static int simengine_findImage(struct dl_phdr_info* info, size_t size, void* data) {
+   uint64_t* range;
+   uint64_t  start;
+   uint64_t  end;
+   uint64_t  segStart;
+   uint64_t  segEnd;
+   bool      found;
+   int       i;
+
+   // range[0] is an address in the image, [1] and [2] its start and end
+   range = (uint64_t*)data;
+   start = UINT64_MAX;
+   end   = 0;
+   found = FALSE;
+   for (i=0;i<info->dlpi_phnum;i++) {
+      if (info->dlpi_phdr[i].p_type!=PT_LOAD) {
+         continue;
+      }
+      segStart = info->dlpi_addr+info->dlpi_phdr[i].p_vaddr;
+      segEnd   = segStart+info->dlpi_phdr[i].p_memsz;
+      if (range[0]>=segStart && range[0]<segEnd) {
+         found = TRUE;
+      }
+      start = segStart<start ? segStart : start;
+      end   = segEnd>end     ? segEnd   : end;
+   }
+   if (found==FALSE) {
+      return 0;
+   }
+   range[1] = start;
+   range[2] = end;
+   return 1;
+}
+#endif
+
+/**
+\brief Where the module, its code and its static data, is loaded.
+*/
+static void simengine_codeRange(uint64_t* start, uint64_t* end) {
+#ifdef _WIN32
+   HMODULE            module;
+   IMAGE_DOS_HEADER*  dos;
+   IMAGE_NT_HEADERS*  nt;
+
+   *start = 0;
+   *end   = 0;
+   if (GetModuleHandleExA(
+         GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS|GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+         (LPCSTR)&mote_main,
+         &module
+      )) {
+      dos    = (IMAGE_DOS_HEADER*)module;
+      nt     = (IMAGE_NT_HEADERS*)((uint8_t*)module+dos->e_lfanew);
+      *start = (uint64_t)(uintptr_t)module;
+      *end   = *start+nt->OptionalHeader.SizeOfImage;
+   }
+#else
+   uint64_t range[3];
+
+   range[0] = (uint64_t)(uintptr_t)&mote_main;
+   range[1] = 0;
+   range[2] = 0;
+   dl_iterate_phdr(simengine_findImage,range);
+   *start   = range[1];
+   *end     = range[2];
+#endif
+}
+
+/**
+\brief Move the pointers of the restored state of a mote to this process.
+
+Only the fields listed here are pointers, any other value is left as is.
+Pointers into the mote move with it, pointers to functions with where the
+module is loaded. A pointer field added to the state of the stack must be
+added here.
+*/
+static void simengine_relocate(OpenMote* self, uint64_t oldSelf, simengine_snapshotHeader_t* header) {
+   uint64_t  codeStart;
+   uint64_t  codeEnd;
+   uintptr_t dataDelta;
+   uintptr_t codeDelta;
+   uint8_t   i;
+   uint8_t   j;
+
+   simengine_codeRange(&codeStart,&codeEnd);
+   dataDelta = (uintptr_t)self-(uintptr_t)oldSelf;
+   codeDelta = (uintptr_t)codeStart-(uintptr_t)header->codeStart;
+
+   // BSP
+   simengine_move(&self->uart_icb.txCb,codeDelta);
+   simengine_move(&self->uart_icb.rxCb,codeDelta);
+   simengine_move(&self->bsp_timer_icb.cb,codeDelta);
+   simengine_move(&self->radio_icb.startFrame_cb,codeDelta);
+   simengine_move(&self->radio_icb.endFrame_cb,codeDelta);
+   simengine_move(&self->radiotimer_icb.overflow_cb,codeDelta);
+   simengine_move(&self->radiotimer_icb.compare_cb,codeDelta);
+
+   // openstack
+   for (i=0;i<MAXACTIVESLOTS;i++) {
+      simengine_move(&self->schedule_vars.scheduleBuf[i].next,dataDelta);
+   }
+   simengine_move(&self->schedule_vars.currentScheduleEntry,dataDelta);
+   simengine_relocateEntry(&self->ieee154e_vars.localCopyForTransmission,dataDelta);
+   simengine_move(&self->ieee154e_vars.dataToSend,dataDelta);
+   simengine_move(&self->ieee154e_vars.dataReceived,dataDelta);
+   simengine_move(&self->ieee154e_vars.ackToSend,dataDelta);
+   simengine_move(&self->ieee154e_vars.ackReceived,dataDelta);
+   simengine_move(&self->ieee154e_vars.ackTxBuf.payload,dataDelta);
+   simengine_move(&self->ieee154e_vars.ackRxBuf.payload,dataDelta);
+   for (i=0;i<QUEUELENGTH;i++) {
+      simengine_relocateEntry(&self->openqueue_vars.queue[i],dataDelta);
+   }
+
+   // drivers
+   for (i=0;i<MAX_NUM_TIMERS;i++) {
+      simengine_move(&self->opentimers_vars.timersBuf[i].callback,codeDelta);
+   }
+   for (i=0;i<COMMAND_MAX;i++) {
+      simengine_move(&self->openserial_vars.commandCb[i],codeDelta);
+   }
+   for (i=0;i<NUMSENSORS;i++) {
+      simengine_move(&self->opensensors_vars.opensensors_resource[i].callbackRead,codeDelta);
+      simengine_move(&self->opensensors_vars.opensensors_resource[i].callbackConvert,codeDelta);
+   }
+
+   // kernel
+   for (i=0;i<TASKPRIO_MAX;i++) {
+      for (j=0;j<TASK_FIFO_DEPTH;j++) {
+         simengine_move(&self->scheduler_vars.fifo[i].cb[j],codeDelta);
+      }
+   }
+#ifdef TASK_PROFILING
+   for (i=0;i<TASK_PROFILE_NUM_CB;i++) {
+      simengine_move(&self->scheduler_vars.profile[i].cb,codeDelta);
+   }
+#endif
+   simengine_move(&self->scheduler_dbg.firstDroppedCb,codeDelta);
+   simengine_move(&self->powermanager_vars.uartIdleCb,codeDelta);
+
+   // openapps
+   simengine_move(&self->uinject_vars.aggPkt,dataDelta);
+}
+
+/**
+\brief Move the pointers of a packet buffer, into its own packet or another.
+*/
+static void simengine_relocateEntry(OpenQueueEntry_t* entry, uintptr_t dataDelta) {
+   simengine_move(&entry->payload,dataDelta);
+   simengine_move(&entry->l4_payload,dataDelta);
+   simengine_move(&entry->l2_payload,dataDelta);
+   simengine_move(&entry->l2_scheduleIE_cellObjects,dataDelta);
+   simengine_move(&entry->l2_ASNpayload,dataDelta);
+}
+
+/**
+\brief Move the pointer at field by delta, unless it is NULL.
+*/
+static void simengine_move(void* field, uintptr_t delta) {
+   uintptr_t p;
+
+   memcpy(&p,field,sizeof(uintptr_t));
+   if (p!=0) {
+      p += delta;
+      memcpy(field,&p,sizeof(uintptr_t));
+   }
+}
+
+//===== medium
+
+/**
+\returns The log-distance path loss over (dx,dy) meters, in dB.
+*/
+static float simengine_pathLoss(simengine_t* e, float dx, float dy) {
+   float d;
+
+   d = sqrtf(dx*dx+dy*dy);
+   if (d<1) {
+      // not modeled in the near field
+      d = 1;
+   }
+   return e->medium.pathLoss1m+10*e->medium.pathLossExponent*log10f(d);
+}
+
+/**
+\returns A number normally distributed, always the same for the same inputs.
+*/
+static float simengine_normal(uint64_t seed, uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
+   uint64_t h;
+   uint64_t inputs[4];
+   float    u1;
+   float    u2;
+   uint8_t  i;
+
+   // splitmix64 over the inputs
+   inputs[0] = a;
+   inputs[1] = b;
+   inputs[2] = c;
+   inputs[3] = d;
+   h         = seed;
+   for (i=0;i<4;i++) {
+      h ^= inputs[i];
+      h += 0x9e3779b97f4a7c15ULL;
+      h  = (h^(h>>30))*0xbf58476d1ce4e5b9ULL;
+      h  = (h^(h>>27))*0x94d049bb133111ebULL;
+      h ^= h>>31;
+   }
+
+   // Box-Muller, u1 in (0,1]
+   u1 = ((float)(h>>40)+1)/(float)(1<<24);
+   u2 = (float)((h>>16)&0xffffff)/(float)(1<<24);
+   return sqrtf(-2*logf(u1))*cosf(6.2831853f*u2);
+}
+
+/**
+\returns The power at which dst hears src on the frequency of dst, in dBm.
+*/
+static float simengine_rxPower(simengine_t* e, simengine_mote_t* src, simengine_mote_t* dst) {
+   float power;
+
+   power = simengine_link(e,src->idx,dst->idx)->rssi;
+   if (e->medium.fading>0) {
+      // reciprocal, and the same until the coherence period is over
+      power += e->medium.fading*simengine_normal(
+         e->seed,
+         1,
+         src->idx<dst->idx ? src->idx : dst->idx,
+         (uint64_t)(src->idx<dst->idx ? dst->idx : src->idx)<<8|dst->frequency,
+         e->medium.coherence ? e->now/e->medium.coherence : 0
+      );
+   }
+   return power;
+}
+
+/**
+\returns The power of the motes transmitting on the frequency of r, except
+   the one r is locked onto, in mW.
+*/
+static float simengine_interference(simengine_mote_t* r) {
+   simengine_t*      e;
+   simengine_mote_t* t;
+   float             interference;
+   uint16_t          i;
+
+   e            = r->engine;
+   interference = 0;
+   for (i=0;i<e->numMotes;i++) {
+      t = e->motes[i];
+      if (
+            t==r                                    ||
+            t==r->rxFrom                            ||
+            t->txOnAir==FALSE                       ||
+            t->frequency!=r->frequency              ||
+            simengine_link(e,t->idx,r->idx)->pdr<=0
+         ) {
+         continue;
+      }
+      interference += powf(10,simengine_rxPower(e,t,r)/10);
+   }
+   return interference;
+}
+
+/**
+\returns The power of the interferers on the frequency of r which are on at
+   some point between start and end, in mW.
+*/
+static float simengine_externalInterference(simengine_mote_t* r, uint64_t start, uint64_t end) {
+   simengine_t*            e;
+   simengine_interferer_t* in;
+   float                   interference;
+   float                   power;
+   uint64_t                elapsed;
+   uint16_t                i;
+
+   e            = r->engine;
+   interference = 0;
+   for (i=0;i<e->numInterferers;i++) {
+      in = &e->interferers[i];
+      if ((in->channelMask&(1<<((uint8_t)(r->frequency-11)%SIMENGINE_NUM_CHANNELS)))==0) {
+         continue;
+      }
+      if (in->period!=0) {
+         if (end<in->phase) {
+            continue;
+         }
+         if (start>=in->phase) {
+            // where in its period the interferer is at start
+            elapsed = (start-in->phase)%in->period;
+            if (elapsed>=in->onTime && start+(in->period-elapsed)>end) {
+               // off all along
+               continue;
+            }
+         }
+      }
+      power = in->power;
+      if (in->hasPosition==TRUE && r->hasPosition==TRUE) {
+         power -= simengine_pathLoss(e,in->x-r->x,in->y-r->y);
+      }
+      interference += powf(10,power/10);
+   }
+   return interference;
+}
+
+/**
+\brief Packet error rate of O-QPSK at 2.4GHz.
+
+\param[in] sinr Linear, not in dB.
+\param[in] len  Length of the PSDU, the length byte is counted on top.
+*/
+static double simengine_per(float sinr, uint8_t len) {
+   static const double binomial16[17] = {
+      1,16,120,560,1820,4368,8008,11440,12870,11440,8008,4368,1820,560,120,16,1
+   };
+   double ber;
+   uint8_t k;
+
+   ber = 0;
+   for (k=2;k<=16;k++) {
+      ber += ((k&1) ? -1 : 1)*binomial16[k]*exp(20*(double)sinr*(1.0/k-1));
+   }
+   ber *= 8.0/15/16;
+   if (ber<0) {
+      ber = 0;
+   } else if (ber>0.5) {
+      ber = 0.5;
+   }
+   return 1-pow(1-ber,8*(1+len));
+}
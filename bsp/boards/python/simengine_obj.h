@@ -0,0 +1,343 @@
+/**
+\brief Native discrete-event simulation engine for the Python board.
+
+By default, every BSP call of an emulated mote is forwarded to Python, which
+keeps the timeline and the radio medium. Motes attached to a SimEngine have
+their board, bsp_timer, radiotimer, radio, uart and eui64 emulated in C
+instead: the engine holds a single event queue for all of them, and Python is
+only used to set up the network and collect results.
+
+Links either have a fixed PDR, any overlapping frames colliding, or are
+derived from a SINR medium: path loss between positioned motes, fading per
+link and per channel, and external interferers such as Wi-Fi.
+
+The crystal of each mote can drift, by a fixed amount plus a random walk,
+and its timer interrupts can be served late, which is what the
+synchronization of the stack has to make up for.
+
+The state of the engine and of all its motes can be written to a file, and
+restored in a fresh engine of the same build, in this process or another.
+
+A network can also be split across processes: each runs some of the motes,
+the others being remote motes whose frames come through a medium in shared
+memory.
+
+Each mote runs mote_main() in its own coroutine, which it leaves whenever it
+goes to sleep. Interrupts are served from the engine's stack while the mote is
+asleep, after which the mote is resumed if the interrupt posted a task. Time
+does not advance while a mote executes.
+*/
+
+#ifndef __SIMENGINE_H
+#define __SIMENGINE_H
+
+#include "radio_obj.h"
+#include "simmedium_obj.h"
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <ucontext.h>
+#endif
+
+//=========================== define ==========================================
+
+/// time unit of the engine: 1/1024th of a 32kHz tick
+#define SIMENGINE_SUBTICK_SHIFT       10
+
+/// stack of the coroutine running a mote
+#ifndef SIMENGINE_STACK_SIZE
+#define SIMENGINE_STACK_SIZE          (64*1024)
+#endif
+
+/// serial output kept per mote until Python reads it, in bytes
+#ifndef SIMENGINE_UART_MAX_OUTPUT
+#define SIMENGINE_UART_MAX_OUTPUT     (1024*1024)
+#endif
+
+/// duration of a byte over the air (32us at 250kbps), in subticks
+#define SIMENGINE_RADIO_BYTE_SUBTICKS 1074
+
+/// number of IEEE802.15.4 channels at 2.4GHz, 11 to 26
+#define SIMENGINE_NUM_CHANNELS        16
+
+/// channels overlapping Wi-Fi channels 1, 6 and 11 (bit 0 is channel 11)
+#define SIMENGINE_WIFI1_MASK          0x000f
+#define SIMENGINE_WIFI6_MASK          0x01e0
+#define SIMENGINE_WIFI11_MASK         0x3c00
+
+/// duration of a byte over serial (10 bits at 115200 baud), in subticks
+#define SIMENGINE_UART_BYTE_SUBTICKS  2913
+
+/// format of the snapshot files
+#define SIMENGINE_SNAPSHOT_MAGIC      "OWSNSIM"
+#define SIMENGINE_SNAPSHOT_VERSION    1
+
+/// index of no mote
+#define SIMENGINE_NO_MOTE             0xffff
+
+typedef enum {
+   SIMENGINE_EVT_BOOT = 0,
+   SIMENGINE_EVT_RADIOTIMER_OVERFLOW,
+   SIMENGINE_EVT_RADIOTIMER_COMPARE,
+   SIMENGINE_EVT_BSP_TIMER,
+   SIMENGINE_EVT_RADIO_TXSTART,
+   SIMENGINE_EVT_RADIO_TXEND,
+   SIMENGINE_EVT_UART_TX,
+   SIMENGINE_EVT_UART_RX,
+   SIMENGINE_EVT_CLOCK,
+   SIMENGINE_EVT_MAX
+} simengine_event_type_t;
+
+//=========================== typedef =========================================
+
+#include "openwsnmodule_obj.h"
+typedef struct OpenMote OpenMote;
+
+#ifdef _WIN32
+typedef LPVOID     simengine_ctx_t;
+#else
+typedef ucontext_t simengine_ctx_t;
+#endif
+
+typedef struct {
+   uint64_t             time;                // when, in subticks
+   uint32_t             seq;                 // order of events with the same time
+   uint32_t             gen;                 // stale if the mote's generation moved on
+   uint16_t             moteIdx;
+   uint8_t              type;                // simengine_event_type_t
+} simengine_event_t;
+
+typedef struct {
+   float                pdr;                 // 0 when out of range
+   int8_t               rssi;                // dBm, before fading
+} simengine_link_t;
+
+typedef struct {
+   bool                 sinr;                // FALSE: overlapping frames collide
+   float                txPower;             // dBm
+   float                pathLoss1m;          // dB, at 1m
+   float                pathLossExponent;
+   float                shadowing;           // std deviation per link, dB
+   float                fading;              // std deviation per link and channel, dB
+   uint64_t             coherence;           // subticks the fading lasts, 0 for ever
+   float                noiseFloor;          // dBm
+   float                sensitivity;         // dBm
+} simengine_medium_t;
+
+typedef struct {
+   float                drift;               // std deviation of the drift of each mote, ppm
+   float                walk;                // std deviation of each step of the random walk, ppm
+   float                walkMax;             // bound of the random walk, ppm
+   uint64_t             walkPeriod;          // subticks between steps of the random walk
+   uint64_t             jitter;              // most a timer interrupt is late, subticks
+} simengine_clock_t;
+
+typedef struct {
+   uint16_t             channelMask;         // bit 0 is channel 11
+   float                power;               // dBm, at the source if positioned, at the motes otherwise
+   uint64_t             period;              // subticks, 0 for always on
+   uint64_t             onTime;              // subticks on, at the start of each period
+   uint64_t             phase;               // subticks, start of the first period
+   bool                 hasPosition;
+   float                x;                   // m
+   float                y;                   // m
+} simengine_interferer_t;
+
+typedef struct {
+   uint32_t             numTx;               // frames sent
+   uint32_t             numRx;               // frames received with a good CRC
+   uint32_t             numRxCrcError;       // frames received with a bad CRC
+   uint32_t             numCollisions;       // frames corrupted by another one
+   uint64_t             radioOnTicks;        // time the radio was on
+   uint32_t             numWakeups;          // times the mote was resumed
+   uint32_t             numResets;
+   uint32_t             numUartDropped;      // serial bytes Python didn't read in time
+   uint32_t             numTimeCorrections;  // slot period corrected by the stack
+   int16_t              minTimeCorrection;   // ticks
+   int16_t              maxTimeCorrection;   // ticks
+   uint32_t             sumAbsTimeCorrection;// ticks
+   uint32_t             numLargeTimeCorrections; // beyond LIMITLARGETIMECORRECTION
+   uint32_t             numRxPerChannel[SIMENGINE_NUM_CHANNELS];
+   uint32_t             numRxCrcErrorPerChannel[SIMENGINE_NUM_CHANNELS];
+} simengine_moteStats_t;
+
+typedef struct simengine_t simengine_t;
+
+typedef struct simengine_mote_t {
+   OpenMote*            mote;
+   simengine_t*         engine;
+   uint16_t             idx;                 // position in the engine
+   uint8_t              eui64[8];
+   uint16_t             randomSeed;          // mixed into the seed of openrandom
+   bool                 remote;              // runs in another process, only its frames are seen
+   bool                 hasPosition;
+   float                x;                   // m
+   float                y;                   // m
+   //===== coroutine
+   simengine_ctx_t      ctx;
+   uint8_t*             stack;
+   bool                 booted;
+   bool                 resetPending;
+   bool                 resuming;            // restored, resumes in the scheduler
+   uint32_t             gen[SIMENGINE_EVT_MAX];
+   //===== clock
+   float                drift;               // ppm, fixed
+   float                wander;              // ppm, random walk on top
+   double               clkRate;             // mote subticks per engine subtick
+   uint64_t             clkAnchorTime;       // engine subticks at the last rate change
+   uint64_t             clkAnchorLocal;      // mote subticks at the same time
+   uint8_t              numSyncPkt;          // last seen in the stats of IEEE802154E
+   //===== radiotimer
+   uint64_t             rtLastOverflow;      // tick at which the counter was 0
+   uint64_t             rtNextOverflow;      // tick at which it will be
+   bool                 rtRunning;
+   PORT_RADIOTIMER_WIDTH rtPeriod;
+   bool                 rtCompareArmed;
+   PORT_RADIOTIMER_WIDTH rtCompareOffset;
+   //===== bsp_timer
+   uint64_t             btReset;             // tick at which the counter was 0
+   uint64_t             btLastCompare;       // tick of the last compare value
+   bool                 btArmed;
+   //===== radio
+   radio_state_t        radioState;
+   uint8_t              frequency;
+   bool                 radioOn;
+   uint64_t             radioOnSince;
+   uint8_t              txBuf[128];
+   uint8_t              txLen;
+   uint64_t             txTime;              // subticks, start of the frame being sent
+   bool                 txOnAir;             // between start and end of frame
+   struct simengine_mote_t* rxFrom;          // mote whose frame is being received
+   bool                 rxCollision;
+   uint64_t             rxStart;             // subticks, SINR medium only
+   float                rxInterference;      // highest during the frame, mW, SINR medium only
+   uint8_t              rxBuf[128];
+   uint8_t              rxLen;
+   int8_t               rxRssi;
+   bool                 rxCrc;
+   //===== uart
+   bool                 uartIntEnabled;
+   bool                 uartRxArmed;
+   uint8_t              uartRxByte;
+   uint8_t*             uartOut;
+   uint32_t             uartOutLen;
+   uint32_t             uartOutSize;
+   uint8_t*             uartIn;
+   uint32_t             uartInLen;
+   uint32_t             uartInIdx;
+   //===== statistics
+   simengine_moteStats_t stats;
+} simengine_mote_t;
+
+typedef struct {
+   uint64_t             numEvents;           // events executed
+   uint64_t             numStaleEvents;      // events cancelled before they were due
+   uint64_t             numSwitches;         // switches into a mote's coroutine
+   uint64_t             numWindows;          // lock-step windows run with a shared medium
+   uint64_t             numFramesOut;        // frames published to the shared medium
+   uint64_t             numFramesIn;         // frames of remote motes received from it
+   uint64_t             numFramesLate;       // received after they should have started, or ended if cancelled
+   uint64_t             numFramesLost;       // overwritten before they were received
+} simengine_stats_t;
+
+typedef struct {
+   char                 magic[8];            // SIMENGINE_SNAPSHOT_MAGIC
+   uint32_t             version;             // SIMENGINE_SNAPSHOT_VERSION
+   uint32_t             moteSize;            // sizeof(OpenMote) of the build
+   uint32_t             simMoteSize;         // sizeof(simengine_mote_t) of the build
+   uint16_t             numMotes;
+   uint16_t             numInterferers;
+   uint32_t             heapLen;
+   uint64_t             codeStart;           // where the module was loaded
+   uint64_t             codeEnd;
+} simengine_snapshotHeader_t;
+
+struct simengine_t {
+   uint64_t             now;                 // in subticks
+   simengine_mote_t**   motes;
+   uint16_t             numMotes;
+   uint16_t             maxMotes;
+   uint16_t             numRemoteMotes;
+   simengine_link_t*    links;               // maxMotes x maxMotes, [src][dst]
+   simengine_event_t*   heap;                // min-heap on (time,seq)
+   uint32_t             heapLen;
+   uint32_t             heapSize;
+   uint32_t             seq;
+   uint64_t             seed;
+   uint64_t             rand;                // state of the xorshift generator
+   simengine_medium_t   medium;
+   simengine_clock_t    clock;
+   simengine_interferer_t* interferers;
+   uint16_t             numInterferers;
+   simengine_ctx_t      ctx;                 // the engine's own context
+   simengine_mote_t*    current;             // mote whose coroutine runs, if any
+   simmedium_t*         shared;              // medium shared with other processes, if any
+   simengine_stats_t    stats;
+};
+
+//=========================== prototypes ======================================
+
+// engine
+simengine_t*      simengine_new(uint64_t seed);
+void              simengine_free(simengine_t* engine);
+int               simengine_addMote(simengine_t* engine, OpenMote* mote, uint8_t* eui64, uint16_t randomSeed);
+int               simengine_addRemoteMote(simengine_t* engine);
+int               simengine_attachShared(simengine_t* engine, const char* path, uint16_t proc);
+void              simengine_setLink(simengine_t* engine, uint16_t src, uint16_t dst, float pdr, int8_t rssi);
+void              simengine_setMedium(simengine_t* engine, simengine_medium_t* medium);
+void              simengine_setPosition(simengine_t* engine, uint16_t moteIdx, float x, float y);
+int               simengine_addInterferer(simengine_t* engine, simengine_interferer_t* interferer);
+void              simengine_setClock(simengine_t* engine, simengine_clock_t* clock);
+void              simengine_setDrift(simengine_t* engine, uint16_t moteIdx, float drift);
+void              simengine_serialInput(simengine_t* engine, uint16_t moteIdx, uint8_t* buf, uint32_t len);
+uint32_t          simengine_serialOutput(simengine_t* engine, uint16_t moteIdx, uint8_t** buf);
+int               simengine_run(simengine_t* engine, uint64_t duration);
+void              simengine_getMoteStats(simengine_t* engine, uint16_t moteIdx, simengine_moteStats_t* stats);
+int               simengine_snapshot(simengine_t* engine, FILE* f);
+int               simengine_readSnapshotHeader(FILE* f, simengine_snapshotHeader_t* header);
+int               simengine_restore(simengine_t* engine, FILE* f, simengine_snapshotHeader_t* header, OpenMote** motes);
+
+// board
+void              simengine_board_sleep(OpenMote* self);
+void              simengine_board_reset(OpenMote* self);
+// bsp_timer
+void              simengine_bsp_timer_reset(OpenMote* self);
+void              simengine_bsp_timer_scheduleIn(OpenMote* self, PORT_TIMER_WIDTH delayTicks);
+void              simengine_bsp_timer_cancel_schedule(OpenMote* self);
+PORT_TIMER_WIDTH  simengine_bsp_timer_get_currentValue(OpenMote* self);
+// eui64
+void              simengine_eui64_get(OpenMote* self, uint8_t* addressToWrite);
+// radiotimer
+void              simengine_radiotimer_init(OpenMote* self);
+void              simengine_radiotimer_start(OpenMote* self, PORT_RADIOTIMER_WIDTH period);
+PORT_RADIOTIMER_WIDTH simengine_radiotimer_getValue(OpenMote* self);
+void              simengine_radiotimer_setPeriod(OpenMote* self, PORT_RADIOTIMER_WIDTH period);
+PORT_RADIOTIMER_WIDTH simengine_radiotimer_getPeriod(OpenMote* self);
+void              simengine_radiotimer_schedule(OpenMote* self, PORT_RADIOTIMER_WIDTH offset);
+void              simengine_radiotimer_cancel(OpenMote* self);
+// radio
+void              simengine_radio_init(OpenMote* self);
+void              simengine_radio_setFrequency(OpenMote* self, uint8_t frequency);
+void              simengine_radio_rfOff(OpenMote* self);
+void              simengine_radio_loadPacket(OpenMote* self, uint8_t* packet, uint8_t len);
+void              simengine_radio_txEnable(OpenMote* self);
+void              simengine_radio_txNow(OpenMote* self);
+void              simengine_radio_rxEnable(OpenMote* self);
+void              simengine_radio_rxNow(OpenMote* self);
+void              simengine_radio_getReceivedFrame(OpenMote* self,
+                                uint8_t* pBufRead,
+                                uint8_t* pLenRead,
+                                uint8_t  maxBufLen,
+                                 int8_t* pRssi,
+                                uint8_t* pLqi,
+                                   bool* pCrc);
+// uart
+void              simengine_uart_init(OpenMote* self);
+void              simengine_uart_enableInterrupts(OpenMote* self);
+void              simengine_uart_disableInterrupts(OpenMote* self);
+void              simengine_uart_writeByte(OpenMote* self, uint8_t byteToWrite);
+void              simengine_uart_writeBuffer(OpenMote* self, uint8_t* buffer, uint16_t len);
+uint8_t           simengine_uart_readByte(OpenMote* self);
+
+#endif
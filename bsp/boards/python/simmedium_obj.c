@@ -0,0 +1,443 @@
+/**
+\brief Radio medium shared by SimEngines running in different processes.
+
+The ring is written without locks: a process reserves the next slot by
+incrementing the head, writes the frame, then its sequence number. A reader
+knows a slot is not written yet when its sequence number is behind, and that
+it was overwritten when it is ahead, which only happens when a process lags
+a whole ring behind in real-time mode. In lock-step mode, frames are only
+published while all processes run a window, and only received while none
+does, so neither can happen.
+
+Processes waiting at the barrier spin, then yield the CPU, so more processes
+than cores can share a medium.
+*/
+
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+#include "simmedium_obj.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//=========================== defines =========================================
+
+/// times a process checks the barrier before yielding the CPU
+#define SIMMEDIUM_SPINS               1000
+
+//=========================== variables =======================================
+
+//=========================== prototypes ======================================
+
+static size_t   simmedium_size(uint32_t ringSize);
+static int      simmedium_map(const char* path, simmedium_shm_t** shm, size_t* size);
+static int      simmedium_wait(simmedium_t* m, int start);
+static int      simmedium_compare(const void* a, const void* b);
+
+//=========================== public ==========================================
+
+#ifndef _WIN32
+
+/**
+\brief Create the file holding a medium, replacing any previous one.
+
+\returns 0 on success, -1 with errno set otherwise.
+*/
+int simmedium_create(const char* path, uint32_t numProcs, uint32_t mode) {
+   simmedium_shm_t* shm;
+   size_t           size;
+   int              fd;
+
+   if (numProcs==0 || numProcs>SIMMEDIUM_MAX_PROCS) {
+      errno = EINVAL;
+      return -1;
+   }
+   size = simmedium_size(SIMMEDIUM_RING_SIZE);
+   fd   = open(path,O_RDWR|O_CREAT|O_TRUNC,0600);
+   if (fd<0) {
+      return -1;
+   }
+   if (ftruncate(fd,(off_t)size)<0) {
+      close(fd);
+      return -1;
+   }
+   shm = (simmedium_shm_t*)mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+   close(fd);
+   if (shm==MAP_FAILED) {
+      return -1;
+   }
+   // the file is zeroed, the magic goes last
+   shm->numProcs = numProcs;
+   shm->mode     = mode;
+   shm->ringSize = SIMMEDIUM_RING_SIZE;
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   memcpy(shm->magic,SIMMEDIUM_MAGIC,sizeof(shm->magic));
+   munmap(shm,size);
+   return 0;
+}
+
+/**
+\brief Release the processes waiting on a medium, for good.
+
+Used when one of the processes failed, so the others don't wait for it.
+
+\returns 0 on success, -1 with errno set otherwise.
+*/
+int simmedium_abort(const char* path) {
+   simmedium_shm_t* shm;
+   size_t           size;
+
+   if (simmedium_map(path,&shm,&size)<0) {
+      return -1;
+   }
+   __atomic_store_n(&shm->aborted,1,__ATOMIC_RELEASE);
+   munmap(shm,size);
+   return 0;
+}
+
+/**
+\brief Map a medium created by simmedium_create(), as process proc.
+
+\returns 0 on success, -1 with errno set if the file can't be mapped, -2 if
+   it is not a medium or proc is out of range.
+*/
+int simmedium_attach(const char* path, uint16_t proc, simmedium_t** medium) {
+   simmedium_t*     m;
+   simmedium_shm_t* shm;
+   size_t           size;
+
+   if (simmedium_map(path,&shm,&size)<0) {
+      return errno==EINVAL ? -2 : -1;
+   }
+   if (proc>=shm->numProcs) {
+      munmap(shm,size);
+      return -2;
+   }
+   m = (simmedium_t*)calloc(1,sizeof(simmedium_t));
+   if (m==NULL) {
+      munmap(shm,size);
+      errno = ENOMEM;
+      return -1;
+   }
+   m->shm    = shm;
+   m->size   = size;
+   m->proc   = proc;
+   m->cursor = __atomic_load_n(&shm->head,__ATOMIC_ACQUIRE);
+   *medium   = m;
+   return 0;
+}
+
+void simmedium_detach(simmedium_t* m) {
+   munmap(m->shm,m->size);
+   free(m->inbox);
+   free(m);
+}
+
+/**
+\brief Make a frame available to all processes.
+*/
+void simmedium_publish(simmedium_t* m, simmedium_frame_t* frame) {
+   simmedium_frame_t* slot;
+   uint64_t           idx;
+
+   idx  = __atomic_fetch_add(&m->shm->head,1,__ATOMIC_ACQ_REL);
+   slot = &m->shm->ring[idx%m->shm->ringSize];
+   // readers of the frame this one replaces see it change under them
+   __atomic_store_n(&slot->seq,0,__ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   slot->time      = frame->time;
+   slot->src       = frame->src;
+   slot->proc      = m->proc;
+   slot->frequency = frame->frequency;
+   slot->len       = frame->len;
+   memcpy(slot->buf,frame->buf,frame->len);
+   __atomic_store_n(&slot->seq,idx+1,__ATOMIC_RELEASE);
+}
+
+/**
+\brief Take the frames other processes published since the last call.
+
+In lock-step mode, they are sorted by time, then transmitter, a cancellation
+after the frame it cancels.
+
+\param[out] frames Where to write the address of the frames, valid until the
+   next call.
+\param[out] numLost Frames overwritten before they were read.
+
+\returns The number of frames.
+*/
+uint32_t simmedium_receive(simmedium_t* m, simmedium_frame_t** frames, uint32_t* numLost) {
+   simmedium_frame_t* slot;
+   simmedium_frame_t* inbox;
+   uint64_t           head;
+   uint64_t           seq;
+   uint32_t           num;
+   uint32_t           size;
+
+   num      = 0;
+   *numLost = 0;
+   head     = __atomic_load_n(&m->shm->head,__ATOMIC_ACQUIRE);
+   for (;m->cursor<head;m->cursor++) {
+      slot = &m->shm->ring[m->cursor%m->shm->ringSize];
+      seq  = __atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE);
+      if (seq<m->cursor+1) {
+         // still being written, next time
+         break;
+      }
+      if (seq>m->cursor+1) {
+         (*numLost)++;
+         continue;
+      }
+      if (slot->proc==m->proc) {
+         continue;
+      }
+      if (num==m->inboxSize) {
+         size  = m->inboxSize ? 2*m->inboxSize : 64;
+         inbox = (simmedium_frame_t*)realloc(m->inbox,size*sizeof(simmedium_frame_t));
+         if (inbox==NULL) {
+            (*numLost)++;
+            continue;
+         }
+         m->inbox     = inbox;
+         m->inboxSize = size;
+      }
+      memcpy(&m->inbox[num],slot,sizeof(simmedium_frame_t));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->seq,__ATOMIC_RELAXED)!=seq) {
+         // overwritten while copied
+         (*numLost)++;
+         continue;
+      }
+      num++;
+   }
+   if (m->shm->mode==SIMMEDIUM_MODE_LOCKSTEP) {
+      qsort(m->inbox,num,sizeof(simmedium_frame_t),simmedium_compare);
+   }
+   *frames = m->inbox;
+   return num;
+}
+
+/**
+\brief Wait for all processes sharing the medium.
+
+\returns 0 once they all called it, -1 if the medium was aborted.
+*/
+int simmedium_barrier(simmedium_t* m) {
+   return simmedium_wait(m,0);
+}
+
+/**
+\brief Wait for all processes, and start the wall clock they run at.
+
+\param[in] time Engine time the wall clock starts at, the same in all
+   processes.
+
+\returns 0 once they all called it, -1 if the medium was aborted.
+*/
+int simmedium_start(simmedium_t* m, uint64_t time) {
+   if (simmedium_wait(m,1)<0) {
+      return -1;
+   }
+   m->wallStart = m->shm->wallStart;
+   m->timeStart = time;
+   return 0;
+}
+
+/**
+\brief Tell the other processes when the next event of this one is due.
+
+\param[out] earliest The earliest next event of all processes.
+
+\returns 0 on success, -1 if the medium was aborted.
+*/
+int simmedium_exchange(simmedium_t* m, uint64_t next, uint64_t* earliest) {
+   uint32_t i;
+
+   m->shm->next[m->proc] = next;
+   if (simmedium_barrier(m)<0) {
+      return -1;
+   }
+   *earliest = m->shm->next[0];
+   for (i=1;i<m->shm->numProcs;i++) {
+      if (m->shm->next[i]<*earliest) {
+         *earliest = m->shm->next[i];
+      }
+   }
+   return 0;
+}
+
+int simmedium_isAborted(simmedium_t* m) {
+   return __atomic_load_n(&m->shm->aborted,__ATOMIC_ACQUIRE)!=0;
+}
+
+/**
+\returns A monotonic wall clock, in nanoseconds.
+*/
+uint64_t simmedium_wallTime(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec*1000000000ULL+(uint64_t)ts.tv_nsec;
+}
+
+void simmedium_sleepUntil(uint64_t wallTime) {
+   struct timespec ts;
+
+   ts.tv_sec  = (time_t)(wallTime/1000000000ULL);
+   ts.tv_nsec = (long)(wallTime%1000000000ULL);
+   while (clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL)==EINTR);
+}
+
+#else
+
+// no shared memory on Windows
+
+int simmedium_create(const char* path, uint32_t numProcs, uint32_t mode) {
+   errno = ENOSYS;
+   return -1;
+}
+
+int simmedium_abort(const char* path) {
+   errno = ENOSYS;
+   return -1;
+}
+
+int simmedium_attach(const char* path, uint16_t proc, simmedium_t** medium) {
+   errno = ENOSYS;
+   return -1;
+}
+
+void simmedium_detach(simmedium_t* m) {
+}
+
+void simmedium_publish(simmedium_t* m, simmedium_frame_t* frame) {
+}
+
+uint32_t simmedium_receive(simmedium_t* m, simmedium_frame_t** frames, uint32_t* numLost) {
+   *numLost = 0;
+   return 0;
+}
+
+int simmedium_barrier(simmedium_t* m) {
+   return -1;
+}
+
+int simmedium_start(simmedium_t* m, uint64_t time) {
+   return -1;
+}
+
+int simmedium_exchange(simmedium_t* m, uint64_t next, uint64_t* earliest) {
+   return -1;
+}
+
+int simmedium_isAborted(simmedium_t* m) {
+   return 1;
+}
+
+uint64_t simmedium_wallTime(void) {
+   return 0;
+}
+
+void simmedium_sleepUntil(uint64_t wallTime) {
+}
+
+#endif
+
+//=========================== private =========================================
+
+static size_t simmedium_size(uint32_t ringSize) {
+   return offsetof(simmedium_shm_t,ring)+(size_t)ringSize*sizeof(simmedium_frame_t);
+}
+
+#ifndef _WIN32
+/**
+\param[in] start Whether the last process in reads the wall clock for all.
+*/
+static int simmedium_wait(simmedium_t* m, int start) {
+   simmedium_shm_t* shm;
+   uint32_t         gen;
+   uint32_t         spins;
+
+   shm = m->shm;
+   gen = __atomic_load_n(&shm->barrierGen,__ATOMIC_ACQUIRE);
+   if (__atomic_add_fetch(&shm->barrierCount,1,__ATOMIC_ACQ_REL)==shm->numProcs) {
+      // last one in, release the others
+      if (start) {
+         shm->wallStart = simmedium_wallTime();
+      }
+      __atomic_store_n(&shm->barrierCount,0,__ATOMIC_RELAXED);
+      __atomic_store_n(&shm->barrierGen,gen+1,__ATOMIC_RELEASE);
+      return simmedium_isAborted(m) ? -1 : 0;
+   }
+   spins = 0;
+   while (__atomic_load_n(&shm->barrierGen,__ATOMIC_ACQUIRE)==gen) {
+      if (simmedium_isAborted(m)) {
+         return -1;
+      }
+      if (++spins>=SIMMEDIUM_SPINS) {
+         sched_yield();
+      }
+   }
+   return 0;
+}
+
+/**
+\returns 0 on success, -1 with errno set otherwise, to EINVAL if the file is
+   not a medium.
+*/
+static int simmedium_map(const char* path, simmedium_shm_t** shm, size_t* size) {
+   struct stat st;
+   int         fd;
+
+   fd = open(path,O_RDWR);
+   if (fd<0) {
+      return -1;
+   }
+   if (fstat(fd,&st)<0) {
+      close(fd);
+      return -1;
+   }
+   *size = (size_t)st.st_size;
+   if (*size<simmedium_size(1)) {
+      close(fd);
+      errno = EINVAL;
+      return -1;
+   }
+   *shm = (simmedium_shm_t*)mmap(NULL,*size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+   close(fd);
+   if (*shm==MAP_FAILED) {
+      return -1;
+   }
+   if (memcmp((*shm)->magic,SIMMEDIUM_MAGIC,sizeof((*shm)->magic))!=0 ||
+       *size<simmedium_size((*shm)->ringSize)) {
+      munmap(*shm,*size);
+      errno = EINVAL;
+      return -1;
+   }
+   return 0;
+}
+#endif
+
+static int simmedium_compare(const void* a, const void* b) {
+   const simmedium_frame_t* fa;
+   const simmedium_frame_t* fb;
+
+   fa = (const simmedium_frame_t*)a;
+   fb = (const simmedium_frame_t*)b;
+   if (fa->time!=fb->time) {
+      return fa->time<fb->time ? -1 : 1;
+   }
+   if (fa->src!=fb->src) {
+      return (int)fa->src-(int)fb->src;
+   }
+   return (fa->len==0)-(fb->len==0);
+}
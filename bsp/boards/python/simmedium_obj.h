@@ -0,0 +1,103 @@
+/**
+\brief Radio medium shared by SimEngines running in different processes.
+
+Each process runs some of the motes of the network, the others being remote:
+they are known to the engine, with their links or position, but run
+elsewhere. Every frame sent by a local mote is published in a ring in shared
+memory, with the time its SFD goes out and its channel, and every process
+delivers the frames of its remote motes to its local ones.
+
+A frame is published when the radio is told to send it, delayTx before it
+goes out, which is the lookahead the processes use to stay apart. If the radio
+is switched off before its end, a cancellation follows, a frame of length 0
+with the same time, and the receivers lose it:
+
+- in lock-step mode, the processes run in windows which end one lookahead
+  after the earliest pending event of any of them, so no frame can start in
+  the window it was published in. Between windows, all frames are received
+  and sorted, which makes a run independent of how the processes are
+  scheduled.
+- in real-time mode, each process runs at the pace of the wall clock, from
+  a start they agree on, and receives frames as they come. Frames which arrive after they should have
+  started are delivered late.
+
+The ring is a file mapped by all processes, /dev/shm on Linux. It is not
+available on Windows.
+*/
+
+#ifndef __SIMMEDIUM_H
+#define __SIMMEDIUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=========================== define ==========================================
+
+#define SIMMEDIUM_MAGIC               "OWSNMED"
+
+/// most processes sharing a medium
+#define SIMMEDIUM_MAX_PROCS           1024
+
+/// frames in the ring, the most published in a window in lock-step mode
+#ifndef SIMMEDIUM_RING_SIZE
+#define SIMMEDIUM_RING_SIZE           4096
+#endif
+
+typedef enum {
+   SIMMEDIUM_MODE_LOCKSTEP = 0,
+   SIMMEDIUM_MODE_REALTIME
+} simmedium_mode_t;
+
+//=========================== typedef =========================================
+
+typedef struct {
+   uint64_t             seq;                 // index in the ring+1, once written
+   uint64_t             time;                // of the SFD, engine subticks
+   uint16_t             src;                 // index of the transmitter in the engines
+   uint16_t             proc;                // process of the transmitter
+   uint8_t              frequency;
+   uint8_t              len;                 // 0 cancels the frame of src at time
+   uint8_t              buf[128];
+} simmedium_frame_t;
+
+typedef struct {
+   char                 magic[8];            // SIMMEDIUM_MAGIC
+   uint32_t             numProcs;
+   uint32_t             mode;                // simmedium_mode_t
+   uint32_t             ringSize;
+   uint32_t             aborted;             // a process failed, the others give up
+   uint32_t             barrierCount;        // processes waiting
+   uint32_t             barrierGen;          // incremented when they are released
+   uint64_t             head;                // frames ever published
+   uint64_t             wallStart;           // wall clock at the start, real-time mode
+   uint64_t             next[SIMMEDIUM_MAX_PROCS]; // next event of each process, lock-step mode
+   simmedium_frame_t    ring[1];             // ringSize
+} simmedium_shm_t;
+
+typedef struct {
+   simmedium_shm_t*     shm;
+   size_t               size;
+   uint16_t             proc;                // index of this process
+   uint64_t             cursor;              // next frame of the ring to read
+   uint64_t             wallStart;           // wall clock at timeStart, 0 before the start
+   uint64_t             timeStart;           // engine subticks
+   simmedium_frame_t*   inbox;               // frames received
+   uint32_t             inboxSize;
+} simmedium_t;
+
+//=========================== prototypes ======================================
+
+int               simmedium_create(const char* path, uint32_t numProcs, uint32_t mode);
+int               simmedium_abort(const char* path);
+int               simmedium_attach(const char* path, uint16_t proc, simmedium_t** medium);
+void              simmedium_detach(simmedium_t* medium);
+void              simmedium_publish(simmedium_t* medium, simmedium_frame_t* frame);
+uint32_t          simmedium_receive(simmedium_t* medium, simmedium_frame_t** frames, uint32_t* numLost);
+int               simmedium_barrier(simmedium_t* medium);
+int               simmedium_start(simmedium_t* medium, uint64_t time);
+int               simmedium_exchange(simmedium_t* medium, uint64_t next, uint64_t* earliest);
+int               simmedium_isAborted(simmedium_t* medium);
+uint64_t          simmedium_wallTime(void);
+void              simmedium_sleepUntil(uint64_t wallTime);
+
+#endif
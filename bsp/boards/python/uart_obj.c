@@ -5,6 +5,7 @@
 */
 
 #include "uart_obj.h"
+#include "simengine_obj.h"
 
 //=========================== defines =========================================
 
@@ -37,6 +38,11 @@ void uart_init(OpenMote* self) {
    printf("C@0x%x: uart_init()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_uart_init(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_init],NULL);
    if (result == NULL) {
@@ -57,6 +63,11 @@ void uart_enableInterrupts(OpenMote* self) {
    printf("C@0x%x: uart_enableInterrupts()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_uart_enableInterrupts(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_enableInterrupts],NULL);
    if (result == NULL) {
@@ -77,6 +88,11 @@ void uart_disableInterrupts(OpenMote* self) {
    printf("C@0x%x: uart_disableInterrupts()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_uart_disableInterrupts(self);
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_disableInterrupts],NULL);
    if (result == NULL) {
@@ -97,6 +113,10 @@ void uart_clearRxInterrupts(OpenMote* self) {
    printf("C@0x%x: uart_clearRxInterrupts()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_clearRxInterrupts],NULL);
    if (result == NULL) {
@@ -117,6 +137,10 @@ void uart_clearTxInterrupts(OpenMote* self) {
    printf("C@0x%x: uart_clearTxInterrupts()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return;
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_clearTxInterrupts],NULL);
    if (result == NULL) {
@@ -143,6 +167,11 @@ void uart_writeByte(OpenMote* self, uint8_t byteToWrite) {
    printf("C@0x%x: uart_writeByte()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      simengine_uart_writeByte(self,byteToWrite);
+      return;
+   }
+   
    // forward to Python
    arglist    = Py_BuildValue("(i)",byteToWrite);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_writeByte],arglist);
@@ -159,64 +188,14 @@ void uart_writeByte(OpenMote* self, uint8_t byteToWrite) {
 }
 #endif
 
-void uart_writeCircularBuffer_FASTSIM(OpenMote* self, uint8_t* buffer, uint8_t* outputBufIdxR, uint8_t* outputBufIdxW) {
-   PyObject*   frame;
-   PyObject*   arglist;
-   PyObject*   result;
-   PyObject*   item;
-   int         res;
-   uint8_t     len;
-   uint8_t     i;
-   
-#ifdef TRACE_ON
-   printf("C@0x%x: uart_writeCircularBuffer_FASTSIM(buffer=%x,outputBufIdxR=%x,outputBufIdxW=%x)... \n",
-      self,
-      buffer,
-      outputBufIdxR,
-      outputBufIdxW
-   );
-#endif
-   
-   // forward to Python
-   len        = (*outputBufIdxW)-(*outputBufIdxR);
-   frame      = PyList_New(len);
-   i = 0;
-   while (*outputBufIdxR!=*outputBufIdxW) {
-      
-      // get element at outputBufIdxR
-      item    = PyInt_FromLong(buffer[*outputBufIdxR]);
-      res     = PyList_SetItem(frame,i,item);
-      if (res!=0) {
-         printf("[CRITICAL] uart_writeCircularBuffer_FASTSIM() failed setting list item\r\n");
-         return;
-      }
-      
-      // increment index
-      (*outputBufIdxR)++;
-      i++;
-   }
-   arglist    = Py_BuildValue("(O)",frame);
-   result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_writeCircularBuffer_FASTSIM],arglist);
-   if (result == NULL) {
-      printf("[CRITICAL] uart_writeCircularBuffer_FASTSIM() returned NULL\r\n");
-      return;
-   }
-   Py_DECREF(result);
-   Py_DECREF(arglist);
-   Py_DECREF(frame);
-   
-#ifdef TRACE_ON
-   printf("C@0x%x: ...done.\n",self);
-#endif
-}
+/**
+\brief Write a chunk of the serial output at once.
 
-void uart_writeBufferByLen_FASTSIM(OpenMote* self, uint8_t* buffer, uint8_t len) {
-   PyObject*   frame;
+It is handed to Python as a single str, rather than as a list of ints.
+*/
+void uart_writeBufferByLen_FASTSIM(OpenMote* self, uint8_t* buffer, uint16_t len) {
    PyObject*   arglist;
    PyObject*   result;
-   PyObject*   item;
-   uint8_t     i;
-   int         res;
    
 #ifdef TRACE_ON
    printf("C@0x%x: uart_writeBufferByLen_FASTSIM(buffer=%x,len=%d)... \n",
@@ -226,29 +205,24 @@ void uart_writeBufferByLen_FASTSIM(OpenMote* self, uint8_t* buffer, uint8_t len)
    );
 #endif
    
-   // forward to Python
-   frame      = PyList_New(len);
-   if (frame==NULL) {
-      printf("[CRITICAL] PyList_New(%d) failed in uart_writeBufferByLen_FASTSIM\r\n",len);
+   if (self->sim!=NULL) {
+      simengine_uart_writeBuffer(self,buffer,len);
       return;
    }
-   for (i=0;i<len;i++) {
-      item    = PyInt_FromLong(buffer[i]);
-      res     = PyList_SetItem(frame,i,item);
-      if (res!=0) {
-         printf("[CRITICAL] uart_writeBufferByLen_FASTSIM() failed setting list item\r\n");
-         return;
-      }
+   
+   // forward to Python
+   arglist    = Py_BuildValue("(s#)",buffer,(int)len);
+   if (arglist==NULL) {
+      printf("[CRITICAL] Py_BuildValue() failed in uart_writeBufferByLen_FASTSIM\r\n");
+      return;
    }
-   arglist    = Py_BuildValue("(O)",frame);
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_writeBufferByLen_FASTSIM],arglist);
+   Py_DECREF(arglist);
    if (result == NULL) {
       printf("[CRITICAL] uart_writeBufferByLen_FASTSIM() returned NULL\r\n");
       return;
    }
    Py_DECREF(result);
-   Py_DECREF(arglist);
-   Py_DECREF(frame);
    
 #ifdef TRACE_ON
    printf("C@0x%x: ...done.\n",self);
@@ -263,6 +237,10 @@ uint8_t uart_readByte(OpenMote* self) {
    printf("C@0x%x: uart_readByte()... \n",self);
 #endif
    
+   if (self->sim!=NULL) {
+      return simengine_uart_readByte(self);
+   }
+   
    // forward to Python
    result     = PyObject_CallObject(self->callback[MOTE_NOTIF_uart_readByte],NULL);
    if (result == NULL) {
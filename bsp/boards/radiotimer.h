@@ -37,6 +37,7 @@ void     radiotimer_start(PORT_RADIOTIMER_WIDTH period);
 PORT_RADIOTIMER_WIDTH radiotimer_getValue(void);
 void     radiotimer_setPeriod(PORT_RADIOTIMER_WIDTH period);
 PORT_RADIOTIMER_WIDTH radiotimer_getPeriod(void);
+PORT_RADIOTIMER_WIDTH radiotimer_getIdleTime(void);
 // compare
 void     radiotimer_schedule(PORT_RADIOTIMER_WIDTH offset);
 void     radiotimer_cancel(void);
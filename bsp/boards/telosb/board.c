@@ -61,6 +61,11 @@ void board_sleep() {
    __bis_SR_register(GIE+LPM0_bits);             // need to leave clock running for serial
 }
 
+void board_sleepAtLevel(sleep_level_t level) {
+   // only LPM0 is used, see board_sleep()
+   board_sleep();
+}
+
 void board_reset() {
    WDTCTL = (WDTPW+0x1200) + WDTHOLD; // writing a wrong watchdog password to causes handler to reset
 }
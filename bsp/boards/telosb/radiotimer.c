@@ -83,6 +83,19 @@ PORT_RADIOTIMER_WIDTH radiotimer_getPeriod() {
    return TBCCR0;
 }
 
+/**
+\brief Time during which the radiotimer doesn't need the board.
+
+\returns The number of ticks until the next overflow, or 0 if a compare is
+   armed (i.e. in the middle of a slot, possibly with the radio on).
+*/
+PORT_RADIOTIMER_WIDTH radiotimer_getIdleTime() {
+   if (TBCCTL2 & CCIE) {
+      return 0;
+   }
+   return TBCCR0-TBR;
+}
+
 //===== compare
 
 void radiotimer_schedule(PORT_RADIOTIMER_WIDTH offset) {
@@ -0,0 +1,181 @@
+/**
+\brief Definition of the "openeventlog" driver.
+
+Events are stored as variable-length binary records, and sent over serial in
+a single SERFRAME_MOTE2PC_EVENTLOG frame per batch:
+
+   version (1B) | lost (2B) | base ASN (5B) | record | record | ...
+
+where lost is the number of records dropped since the previous frame. A record
+is:
+
+   code (1B) | [component (1B)] | ASN delta | arg1 | arg2
+
+- the component is only present, and EVENTLOG_FLAG_COMPONENT set in the code
+  byte, when it differs from the one of the previous record.
+- the ASN delta is the number of slots since the previous record (since the
+  base ASN for the first record).
+- the delta and arguments are unsigned LEB128 varints: 7 bits per byte, least
+  significant first, the MSB set in all bytes but the last.
+*/
+
+#include "opendefs.h"
+#include "openeventlog.h"
+#include "openserial.h"
+#include "IEEE802154E.h"
+
+//=========================== variables =======================================
+
+openeventlog_vars_t openeventlog_vars;
+
+//=========================== prototypes ======================================
+
+uint8_t openeventlog_writeVarint(uint8_t* buf, uint32_t value);
+
+//=========================== public ==========================================
+
+void openeventlog_init() {
+   memset(&openeventlog_vars,0,sizeof(openeventlog_vars_t));
+}
+
+/**
+\brief Log an event.
+
+Takes the place of openserial_printInfo() for frequent events: the record is
+a handful of bytes, and carries the ASN at which the event happened.
+
+\returns E_SUCCESS, or E_FAIL if the record was dropped.
+*/
+owerror_t openeventlog_log(
+      uint8_t          component,
+      uint8_t          code,
+      errorparameter_t arg1,
+      errorparameter_t arg2
+   ) {
+   asn_t    now;
+   uint32_t delta;
+   uint8_t* p;
+   INTERRUPT_DECLARATION();
+
+   // the host didn't ask for that one
+   if (openserial_eventSubscribed(code)==FALSE) {
+      return E_SUCCESS;
+   }
+
+   ieee154e_getAsnStruct(&now);
+
+   DISABLE_INTERRUPTS();
+
+   // send the batch first if the record may not fit, or time went backwards
+   // (e.g. when synchronizing), as deltas are unsigned
+   if (
+         openeventlog_vars.len>0 &&
+         (
+            openeventlog_vars.len+EVENTLOG_MAX_RECORD_LEN>EVENTLOG_BUFFER_SIZE ||
+            ieee154e_asnSince(&now,&openeventlog_vars.lastAsn)==0xffffffff
+         )
+      ) {
+      ENABLE_INTERRUPTS();
+      openeventlog_flush();
+      DISABLE_INTERRUPTS();
+   }
+   if (openeventlog_vars.len+EVENTLOG_MAX_RECORD_LEN>EVENTLOG_BUFFER_SIZE) {
+      // filled up from interrupt context in the meantime
+      openeventlog_vars.numDropped++;
+      ENABLE_INTERRUPTS();
+      return E_FAIL;
+   }
+
+   // start a new batch
+   if (openeventlog_vars.len==0) {
+      memcpy(&openeventlog_vars.baseAsn,&now,sizeof(asn_t));
+      memcpy(&openeventlog_vars.lastAsn,&now,sizeof(asn_t));
+      openeventlog_vars.lastComponent = COMPONENT_NULL;
+   }
+
+   // a record logged from interrupt context since the ASN was read is later
+   delta = ieee154e_asnSince(&now,&openeventlog_vars.lastAsn);
+   if (delta==0xffffffff) {
+      delta = 0;
+   } else {
+      memcpy(&openeventlog_vars.lastAsn,&now,sizeof(asn_t));
+   }
+
+   // append the record
+   p = &openeventlog_vars.buf[openeventlog_vars.len];
+   if (component!=openeventlog_vars.lastComponent) {
+      *p++ = code | EVENTLOG_FLAG_COMPONENT;
+      *p++ = component;
+      openeventlog_vars.lastComponent = component;
+   } else {
+      *p++ = code;
+   }
+   p += openeventlog_writeVarint(p,delta);
+   p += openeventlog_writeVarint(p,arg1);
+   p += openeventlog_writeVarint(p,arg2);
+   openeventlog_vars.len = p-openeventlog_vars.buf;
+   openeventlog_vars.numRecords++;
+
+   ENABLE_INTERRUPTS();
+
+   return E_SUCCESS;
+}
+
+/**
+\brief Send the current batch, if any.
+
+Called at every serial output, and when a batch is full.
+*/
+void openeventlog_flush() {
+   uint8_t frame[1+2+5+EVENTLOG_BUFFER_SIZE];
+   uint8_t len;
+   uint8_t numRecords;
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   if (openeventlog_vars.len==0) {
+      ENABLE_INTERRUPTS();
+      return;
+   }
+   frame[0]  = EVENTLOG_VERSION;
+   frame[1]  = (uint8_t)(openeventlog_vars.numDropped>>0);
+   frame[2]  = (uint8_t)(openeventlog_vars.numDropped>>8);
+   frame[3]  = (uint8_t)(openeventlog_vars.baseAsn.bytes0and1>>0);
+   frame[4]  = (uint8_t)(openeventlog_vars.baseAsn.bytes0and1>>8);
+   frame[5]  = (uint8_t)(openeventlog_vars.baseAsn.bytes2and3>>0);
+   frame[6]  = (uint8_t)(openeventlog_vars.baseAsn.bytes2and3>>8);
+   frame[7]  = openeventlog_vars.baseAsn.byte4;
+   memcpy(&frame[8],openeventlog_vars.buf,openeventlog_vars.len);
+   len       = 8+openeventlog_vars.len;
+   numRecords = openeventlog_vars.numRecords;
+   openeventlog_vars.len        = 0;
+   openeventlog_vars.numRecords = 0;
+   openeventlog_vars.numDropped = 0;
+   ENABLE_INTERRUPTS();
+
+   if (openserial_printEventLog(frame,len)==E_FAIL) {
+      // the records of the batch are lost, let the host know with the next one
+      DISABLE_INTERRUPTS();
+      openeventlog_vars.numDropped += numRecords;
+      ENABLE_INTERRUPTS();
+   }
+}
+
+//=========================== private =========================================
+
+/**
+\brief Write an unsigned LEB128 varint.
+
+\returns The number of bytes written, between 1 and 5.
+*/
+uint8_t openeventlog_writeVarint(uint8_t* buf, uint32_t value) {
+   uint8_t len;
+
+   len = 0;
+   while (value>=0x80) {
+      buf[len++] = (uint8_t)(value|0x80);
+      value    >>= 7;
+   }
+   buf[len++] = (uint8_t)value;
+   return len;
+}
@@ -0,0 +1,69 @@
+/**
+\brief Declaration of the "openeventlog" driver.
+
+Compact, ASN-stamped log of events, sent over serial in batches.
+*/
+
+#ifndef __OPENEVENTLOG_H
+#define __OPENEVENTLOG_H
+
+#include "opendefs.h"
+
+/**
+\addtogroup drivers
+\{
+\addtogroup OpenEventLog
+\{
+*/
+
+//=========================== define ==========================================
+
+/**
+\brief Number of bytes of records a batch holds.
+
+A batch is sent when the next record doesn't fit, and at every serial output.
+*/
+#ifndef EVENTLOG_BUFFER_SIZE
+#define EVENTLOG_BUFFER_SIZE      96
+#endif
+
+/// version of the layout of SERFRAME_MOTE2PC_EVENTLOG frames
+#define EVENTLOG_VERSION          1
+
+/// set in the code byte of a record when it is followed by the component
+#define EVENTLOG_FLAG_COMPONENT   0x80
+
+/// worst case size of a record: code, component, then 3 varints of 32 bits
+#define EVENTLOG_MAX_RECORD_LEN   (1+1+5+3+3)
+
+//=========================== typedef =========================================
+
+//=========================== module variables ================================
+
+typedef struct {
+   uint8_t    buf[EVENTLOG_BUFFER_SIZE]; // records of the current batch
+   uint8_t    len;                       // number of bytes in buf
+   uint8_t    numRecords;                // number of records in buf
+   asn_t      baseAsn;                   // ASN of the first record
+   asn_t      lastAsn;                   // ASN of the last record
+   uint8_t    lastComponent;             // component of the last record
+   uint16_t   numDropped;                // records lost as the batch couldn't be sent
+} openeventlog_vars_t;
+
+//=========================== prototypes ======================================
+
+void      openeventlog_init(void);
+owerror_t openeventlog_log(
+   uint8_t          component,
+   uint8_t          code,
+   errorparameter_t arg1,
+   errorparameter_t arg2
+);
+void      openeventlog_flush(void);
+
+/**
+\}
+\}
+*/
+
+#endif
@@ -13,10 +13,12 @@
 #include "openqueue.h"
 #include "leds.h"
 #include "schedule.h"
+#include "scheduler.h"
+#include "powermanager.h"
 #include "uart.h"
 #include "opentimers.h"
+#include "openeventlog.h"
 #include "openhdlc.h"
-#include "schedule.h"
 
 //=========================== variables =======================================
 
@@ -38,10 +40,33 @@ void openserial_board_reset_cb(
 
 void openserial_goldenImageCommands(void);
 
+// subscriptions
+void openserial_subscribe(void);
+
+// error aggregation
+bool openserial_errAggregate(
+   uint8_t          component,
+   uint8_t          code,
+   errorparameter_t arg1,
+   errorparameter_t arg2
+);
+
+// status batch
+bool openserial_debugPrint(uint8_t statusElement);
+void openserial_statusBatchOpen(void);
+void openserial_statusBatchClose(void);
+
 // HDLC output
-void outputHdlcOpen(void);
-void outputHdlcWrite(uint8_t b);
-void outputHdlcClose(void);
+owerror_t outputHdlcFrame(
+   uint8_t* head,
+   uint8_t  headLen,
+   uint8_t* body,
+   uint8_t  bodyLen,
+   uint8_t* tail,
+   uint8_t  tailLen
+);
+uint8_t  outputHdlcLen(uint8_t b);
+uint16_t outputHdlcWrite(uint16_t idx, uint8_t b);
 // HDLC input
 void inputHdlcOpen(void);
 void inputHdlcWrite(uint8_t b);
@@ -51,6 +76,7 @@ void inputHdlcClose(void);
 
 void openserial_init() {
    uint16_t crc;
+   uint8_t  i;
    
    // reset variable
    memset(&openserial_vars,0,sizeof(openserial_vars_t));
@@ -59,6 +85,14 @@ void openserial_init() {
    openserial_vars.mode                = MODE_OFF;
    openserial_vars.debugPrintCounter   = 0;
    
+   // keep the board from sleeping too deep while the UART is in use
+   powermanager_setUartIdleCb(openserial_isIdle);
+   
+   // subscriptions: all status elements, at every output, and all events
+   for (i=0;i<STATUS_MAX;i++) {
+      openserial_vars.statusPeriod[i]  = 1;
+   }
+   
    // input
    openserial_vars.reqFrame[0]         = HDLC_FLAG;
    openserial_vars.reqFrame[1]         = SERFRAME_MOTE2PC_REQUEST;
@@ -75,32 +109,48 @@ void openserial_init() {
    openserial_vars.inputBufFill        = 0;
    
    // ouput
-   openserial_vars.outputBufFilled     = FALSE;
    openserial_vars.outputBufIdxR       = 0;
    openserial_vars.outputBufIdxW       = 0;
+   openserial_vars.outputBufIdxReserved= 0;
+   openserial_vars.outputNumWriters    = 0;
    
    // set callbacks
    uart_setCallbacks(isr_openserial_tx,
                      isr_openserial_rx);
 }
 
+/**
+\brief Print a status element.
+
+While openserial_startOutput() builds a batched status frame, the element is
+appended to it as a TLV instead of being sent in a frame of its own.
+
+\returns E_FAIL if the element doesn't fit in the batched status frame.
+*/
 owerror_t openserial_printStatus(uint8_t statusElement,uint8_t* buffer, uint8_t length) {
-  uint8_t i;
-   INTERRUPT_DECLARATION();
+   uint8_t head[4];
    
-   DISABLE_INTERRUPTS();
-   openserial_vars.outputBufFilled  = TRUE;
-   outputHdlcOpen();
-   outputHdlcWrite(SERFRAME_MOTE2PC_STATUS);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[0]);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[1]);
-   outputHdlcWrite(statusElement);
-   for (i=0;i<length;i++){
-      outputHdlcWrite(buffer[i]);
-   }
-   outputHdlcClose();
-   ENABLE_INTERRUPTS();
-   return E_SUCCESS;
+   if (openserial_vars.statusBatching==TRUE) {
+      if (
+            openserial_vars.statusBatchFull==TRUE ||
+            openserial_vars.statusBatchLen+2+length>openserial_vars.statusBatchBudget
+         ) {
+         // no more elements in this frame, so they keep their rotation order
+         openserial_vars.statusBatchFull = TRUE;
+         return E_FAIL;
+      }
+      openserial_vars.statusBatchBuf[openserial_vars.statusBatchLen++] = statusElement;
+      openserial_vars.statusBatchBuf[openserial_vars.statusBatchLen++] = length;
+      memcpy(&openserial_vars.statusBatchBuf[openserial_vars.statusBatchLen],buffer,length);
+      openserial_vars.statusBatchLen += length;
+      return E_SUCCESS;
+   }
+   
+   head[0] = SERFRAME_MOTE2PC_STATUS;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   head[3] = statusElement;
+   return outputHdlcFrame(head,sizeof(head),buffer,length,NULL,0);
 }
 
 owerror_t openserial_printInfoErrorCritical(
@@ -110,70 +160,87 @@ owerror_t openserial_printInfoErrorCritical(
       errorparameter_t arg1,
       errorparameter_t arg2
    ) {
-   INTERRUPT_DECLARATION();
+   uint8_t head[9];
    
-   DISABLE_INTERRUPTS();
-   openserial_vars.outputBufFilled  = TRUE;
-   outputHdlcOpen();
-   outputHdlcWrite(severity);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[0]);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[1]);
-   outputHdlcWrite(calling_component);
-   outputHdlcWrite(error_code);
-   outputHdlcWrite((uint8_t)((arg1 & 0xff00)>>8));
-   outputHdlcWrite((uint8_t) (arg1 & 0x00ff));
-   outputHdlcWrite((uint8_t)((arg2 & 0xff00)>>8));
-   outputHdlcWrite((uint8_t) (arg2 & 0x00ff));
-   outputHdlcClose();
-   ENABLE_INTERRUPTS();
-   return E_SUCCESS;
+   // critical errors always make it to the host
+   if (
+         severity!=SERFRAME_MOTE2PC_CRITICAL &&
+         openserial_eventSubscribed(error_code)==FALSE
+      ) {
+      return E_SUCCESS;
+   }
+   
+   head[0] = severity;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   head[3] = calling_component;
+   head[4] = error_code;
+   head[5] = (uint8_t)((arg1 & 0xff00)>>8);
+   head[6] = (uint8_t) (arg1 & 0x00ff);
+   head[7] = (uint8_t)((arg2 & 0xff00)>>8);
+   head[8] = (uint8_t) (arg2 & 0x00ff);
+   return outputHdlcFrame(head,sizeof(head),NULL,0,NULL,0);
 }
 
 owerror_t openserial_printData(uint8_t* buffer, uint8_t length) {
-   uint8_t  i;
-   uint8_t  asn[5];
-   INTERRUPT_DECLARATION();
+   uint8_t  head[1+2+5];
+   
+   head[0] = SERFRAME_MOTE2PC_DATA;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
    
    // retrieve ASN
-   ieee154e_getAsn(asn);// byte01,byte23,byte4
+   ieee154e_getAsn(&head[3]);// byte01,byte23,byte4
    
-   DISABLE_INTERRUPTS();
-   openserial_vars.outputBufFilled  = TRUE;
-   outputHdlcOpen();
-   outputHdlcWrite(SERFRAME_MOTE2PC_DATA);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[1]);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[0]);
-   outputHdlcWrite(asn[0]);
-   outputHdlcWrite(asn[1]);
-   outputHdlcWrite(asn[2]);
-   outputHdlcWrite(asn[3]);
-   outputHdlcWrite(asn[4]);
-   for (i=0;i<length;i++){
-      outputHdlcWrite(buffer[i]);
-   }
-   outputHdlcClose();
-   ENABLE_INTERRUPTS();
-   return E_SUCCESS;
+   return outputHdlcFrame(head,sizeof(head),buffer,length,NULL,0);
 }
 
-owerror_t openserial_printPacket(uint8_t* buffer, uint8_t length, uint8_t channel) {
-   uint8_t  i;
-   INTERRUPT_DECLARATION();
+/**
+\brief Send a batch of event records, see openeventlog.
+*/
+owerror_t openserial_printEventLog(uint8_t* buffer, uint8_t length) {
+   uint8_t  head[3];
    
-   DISABLE_INTERRUPTS();
-   openserial_vars.outputBufFilled  = TRUE;
-   outputHdlcOpen();
-   outputHdlcWrite(SERFRAME_MOTE2PC_SNIFFED_PACKET);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[1]);
-   outputHdlcWrite(idmanager_getMyID(ADDR_16B)->addr_16b[0]);
-   for (i=0;i<length;i++){
-      outputHdlcWrite(buffer[i]);
-   }
-   outputHdlcWrite(channel);
-   outputHdlcClose();
+   head[0] = SERFRAME_MOTE2PC_EVENTLOG;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   return outputHdlcFrame(head,sizeof(head),buffer,length,NULL,0);
+}
+
+/**
+\brief Report a frame overheard in the current slot.
+
+\param[in] buffer  The frame, without its CRC.
+\param[in] length  Its length, in bytes.
+\param[in] channel The frequency channel it was received on, 11..26.
+\param[in] rssi    Its RSSI, in dBm.
+\param[in] lqi     Its LQI, as reported by the radio.
+\param[in] crc     Whether its CRC was valid.
+
+The frame is followed by SNIFFED_PACKET_TAIL_LEN bytes, the ASN in the same
+layout as in openeventlog frames. The channel stays the last byte.
+*/
+owerror_t openserial_printPacket(uint8_t* buffer, uint8_t length, uint8_t channel,
+                              int8_t rssi, uint8_t lqi, bool crc) {
+   uint8_t  head[3];
+   uint8_t  tail[SNIFFED_PACKET_TAIL_LEN];
+   asn_t    asn;
    
-   ENABLE_INTERRUPTS();
-   return E_SUCCESS;
+   ieee154e_getAsnStruct(&asn);
+   
+   head[0] = SERFRAME_MOTE2PC_SNIFFED_PACKET;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
+   tail[0] = (uint8_t)rssi;
+   tail[1] = lqi;
+   tail[2] = (uint8_t)crc;
+   tail[3] = (uint8_t)(asn.bytes0and1>>0);
+   tail[4] = (uint8_t)(asn.bytes0and1>>8);
+   tail[5] = (uint8_t)(asn.bytes2and3>>0);
+   tail[6] = (uint8_t)(asn.bytes2and3>>8);
+   tail[7] = asn.byte4;
+   tail[8] = channel;
+   return outputHdlcFrame(head,sizeof(head),buffer,length,tail,sizeof(tail));
 }
 
 owerror_t openserial_printInfo(uint8_t calling_component, uint8_t error_code,
@@ -188,9 +255,21 @@ owerror_t openserial_printInfo(uint8_t calling_component, uint8_t error_code,
    );
 }
 
+/**
+\brief Report an error.
+
+Errors which keep occurring, e.g. every slot, are reported at most once per
+OPENSERIAL_ERR_PERIOD_MS. Repeats in between are counted, and reported in
+a STATUS_ERRORS row.
+*/
 owerror_t openserial_printError(uint8_t calling_component, uint8_t error_code,
                               errorparameter_t arg1,
                               errorparameter_t arg2) {
+   // repeats of an error reported recently are only counted
+   if (openserial_errAggregate(calling_component,error_code,arg1,arg2)==TRUE) {
+      return E_SUCCESS;
+   }
+   
    // blink error LED, this is serious
    leds_error_toggle();
    
@@ -206,13 +285,18 @@ owerror_t openserial_printError(uint8_t calling_component, uint8_t error_code,
 owerror_t openserial_printCritical(uint8_t calling_component, uint8_t error_code,
                               errorparameter_t arg1,
                               errorparameter_t arg2) {
+   opentimer_id_t id;
+
    // blink error LED, this is serious
    leds_error_blink();
    
-   // schedule for the mote to reboot in 100ms
-   opentimers_start(100,
+   // schedule for the mote to reboot in 100ms (or a bit later)
+   id = opentimers_start(100,
                     TIMER_ONESHOT,TIME_MS,
                     openserial_board_reset_cb);
+   if (id!=TOO_MANY_TIMERS_ERROR) {
+      opentimers_setSlack(id,TIME_MS,OPENSERIAL_RESET_SLACK_MS);
+   }
    
    return openserial_printInfoErrorCritical(
       SERFRAME_MOTE2PC_CRITICAL,
@@ -280,53 +364,81 @@ void openserial_startInput() {
    openserial_vars.busyReceiving  = FALSE;
    openserial_vars.mode           = MODE_INPUT;
    openserial_vars.reqFrameIdx    = 0;
-
+#ifdef FASTSIM
+   uart_writeBufferByLen_FASTSIM(openserial_vars.reqFrame,sizeof(openserial_vars.reqFrame));
+   openserial_vars.reqFrameIdx    = sizeof(openserial_vars.reqFrame);
+#else
    uart_writeByte(openserial_vars.reqFrame[openserial_vars.reqFrameIdx]);
-
+#endif
    ENABLE_INTERRUPTS();
 }
 
 void openserial_startOutput() {
-   //schedule a task to get new status in the output buffer
-   uint8_t debugPrintCounter;
-   
+   uint8_t  debugPrintCounter;
+   uint8_t  i;
+   uint8_t  droppedPrio;
+   uint8_t  droppedRow;
+#ifdef FASTSIM
+   uint16_t idx;
+   uint16_t len;
+#endif
    INTERRUPT_DECLARATION();
+   
    DISABLE_INTERRUPTS();
-   openserial_vars.debugPrintCounter = (openserial_vars.debugPrintCounter+1)%STATUS_MAX;
    debugPrintCounter = openserial_vars.debugPrintCounter;
    ENABLE_INTERRUPTS();
    
-   // print debug information
-   switch (debugPrintCounter) {
-      case STATUS_ISSYNC:
-         if (debugPrint_isSync()==TRUE) {
-            break;
-         }
-      case STATUS_ID:
-         if (debugPrint_id()==TRUE) {
-            break;
-         }
-      case STATUS_DAGRANK:
-         if (debugPrint_myDAGrank()==TRUE) {
-            break;
-         }
-      case STATUS_ASN:
-         if (debugPrint_asn()==TRUE) {
-            break;
-         }
-      case STATUS_MACSTATS:
-         if (debugPrint_macStats()==TRUE) {
+   // events logged since the last output
+   openeventlog_flush();
+   
+   // the work of a dropped task is lost, tell the host about the first one
+   if (
+         openserial_vars.isTaskDropReported==FALSE &&
+         scheduler_getFirstDrop(&droppedPrio,&droppedRow)==TRUE
+      ) {
+      openserial_vars.isTaskDropReported = TRUE;
+      openserial_printError(COMPONENT_OPENWSN,ERR_TASK_DROPPED,
+                            (errorparameter_t)droppedPrio,
+                            (errorparameter_t)droppedRow);
+   }
+   
+   // one more output for the subscribed status elements
+   for (i=0;i<STATUS_MAX;i++) {
+      if (openserial_vars.statusCountdown[i]>0) {
+         openserial_vars.statusCountdown[i]--;
+      }
+   }
+   
+   // print as many due status elements as fit in one frame, resuming the
+   // rotation at the first one which didn't fit last time
+   openserial_statusBatchOpen();
+   for (i=0;i<STATUS_MAX;i++) {
+      if (
+            openserial_vars.statusPeriod[debugPrintCounter]!=0 &&
+            openserial_vars.statusCountdown[debugPrintCounter]==0
+         ) {
+         openserial_debugPrint(debugPrintCounter);
+         if (
+               openserial_vars.statusBatchFull==TRUE &&
+               openserial_vars.statusBatchLen!=0
+            ) {
+            // still due, goes first in the next frame
             break;
          }
-      case STATUS_NEIGHBORS:
-         if (debugPrint_neighbors()==TRUE) {
+         openserial_vars.statusCountdown[debugPrintCounter] = openserial_vars.statusPeriod[debugPrintCounter];
+         if (openserial_vars.statusBatchFull==TRUE) {
+            // doesn't fit on its own, skip it this time
+            debugPrintCounter = (debugPrintCounter+1)%STATUS_MAX;
             break;
          }
-      default:
-         DISABLE_INTERRUPTS();
-         openserial_vars.debugPrintCounter=0;
-         ENABLE_INTERRUPTS();
+      }
+      debugPrintCounter = (debugPrintCounter+1)%STATUS_MAX;
    }
+   openserial_statusBatchClose();
+   
+   DISABLE_INTERRUPTS();
+   openserial_vars.debugPrintCounter = debugPrintCounter;
+   ENABLE_INTERRUPTS();
    
    // flush buffer
    uart_clearTxInterrupts();
@@ -334,11 +446,25 @@ void openserial_startOutput() {
    uart_enableInterrupts();           // Enable USCI_A1 TX & RX interrupt
    DISABLE_INTERRUPTS();
    openserial_vars.mode=MODE_OUTPUT;
-   if (openserial_vars.outputBufFilled) {
-      uart_writeByte(openserial_vars.outputBuf[openserial_vars.outputBufIdxR++]);
+#ifdef FASTSIM
+   // hand the ring over in at most two chunks, split where it wraps around
+   while (openserial_vars.outputBufIdxR!=openserial_vars.outputBufIdxW) {
+      idx = openserial_vars.outputBufIdxR&SERIAL_OUTPUT_BUFFER_MASK;
+      len = (uint16_t)(openserial_vars.outputBufIdxW-openserial_vars.outputBufIdxR);
+      if (len>SERIAL_OUTPUT_BUFFER_SIZE-idx) {
+         len = SERIAL_OUTPUT_BUFFER_SIZE-idx;
+      }
+      uart_writeBufferByLen_FASTSIM(&openserial_vars.outputBuf[idx],len);
+      openserial_vars.outputBufIdxR += len;
+   }
+   openserial_stop();
+#else
+   if (openserial_vars.outputBufIdxR!=openserial_vars.outputBufIdxW) {
+      uart_writeByte(openserial_vars.outputBuf[(openserial_vars.outputBufIdxR++)&SERIAL_OUTPUT_BUFFER_MASK]);
    } else {
       openserial_stop();
    }
+#endif
    ENABLE_INTERRUPTS();
 }
 
@@ -380,6 +506,9 @@ void openserial_stop() {
              // golden image command
             openserial_goldenImageCommands();
             break;
+         case SERFRAME_PC2MOTE_SUBSCRIBE:
+            openserial_subscribe();
+            break;
          default:
             openserial_printError(COMPONENT_OPENSERIAL,ERR_UNSUPPORTED_COMMAND,
                                   (errorparameter_t)cmdByte,
@@ -398,6 +527,148 @@ void openserial_stop() {
    ENABLE_INTERRUPTS();
 }
 
+/**
+\brief Whether the UART is in use.
+
+\returns TRUE if neither input nor output is in progress, i.e. the UART (and
+   the clock it runs from) is not needed.
+*/
+bool openserial_isIdle() {
+   return openserial_vars.mode==MODE_OFF;
+}
+
+/**
+\brief Have a golden image command handled by another module.
+
+For commands of modules openserial doesn't depend on, e.g. applications. Their
+handler is called with the parameter bytes, little endian.
+*/
+void openserial_registerCommand(uint8_t commandId, openserial_command_cbt cb) {
+   if (commandId>=COMMAND_MAX) {
+      return;
+   }
+   openserial_vars.commandCb[commandId] = cb;
+}
+
+/**
+\brief Trigger this module to print status information, over serial.
+
+debugPrint_* functions are used by the openserial module to continuously print
+status information about several modules in the OpenWSN stack.
+
+\returns TRUE if this function printed something, FALSE otherwise.
+*/
+bool debugPrint_outBufferIndexes() {
+   debugOutBufferEntry_t temp;
+   INTERRUPT_DECLARATION();
+   
+   DISABLE_INTERRUPTS();
+   temp.readIdx          = openserial_vars.outputBufIdxR;
+   temp.writeIdx         = openserial_vars.outputBufIdxW;
+   temp.maxFill          = openserial_vars.outputMaxFill;
+   temp.numDroppedFrames = openserial_vars.outputNumDroppedFrames;
+   temp.numDroppedBytes  = openserial_vars.outputNumDroppedBytes;
+   ENABLE_INTERRUPTS();
+   
+   openserial_printStatus(STATUS_OUTBUFFER,(uint8_t*)&temp,sizeof(debugOutBufferEntry_t));
+   return TRUE;
+}
+
+/**
+\brief Print the statistics of the scheduler.
+
+\returns TRUE if this function printed something, FALSE otherwise.
+*/
+bool debugPrint_tasks() {
+   debugTaskProfileEntry_t temp;
+   
+   scheduler_getStats(&temp);
+   
+   openserial_printStatus(STATUS_TASKS,(uint8_t*)&temp,sizeof(debugTaskProfileEntry_t));
+   return TRUE;
+}
+
+/**
+\brief Print the time the board spent at each sleep level.
+
+\returns TRUE if this function printed something, FALSE otherwise.
+*/
+bool debugPrint_sleep() {
+   debugSleepEntry_t temp;
+   
+   powermanager_getStats(&temp);
+   
+   openserial_printStatus(STATUS_SLEEP,(uint8_t*)&temp,sizeof(debugSleepEntry_t));
+   return TRUE;
+}
+
+/**
+\brief Print the statistics opentimers exports.
+
+\returns TRUE if this function printed something, FALSE otherwise.
+*/
+bool debugPrint_timers() {
+   debugOpentimersEntry_t temp;
+   
+   opentimers_getStats(&temp);
+   
+   openserial_printStatus(STATUS_TIMERS,(uint8_t*)&temp,sizeof(debugOpentimersEntry_t));
+   return TRUE;
+}
+
+/**
+\brief Print the repeats of errors not reported for OPENSERIAL_ERR_PERIOD_MS.
+
+One row per (component, error code), with the number of repeats and the
+arguments of the last one.
+
+\returns TRUE if this function printed something, FALSE otherwise.
+*/
+bool debugPrint_errors() {
+   debugErrorEntry_t temp;
+   errAgg_t*         entry;
+   uint32_t          now;
+   bool              printed;
+   uint8_t           i;
+   INTERRUPT_DECLARATION();
+   
+   now     = opentimers_getValue();
+   printed = FALSE;
+   
+   for (i=0;i<OPENSERIAL_NUM_ERR_AGG;i++) {
+      entry = &openserial_vars.errAgg[i];
+      
+      DISABLE_INTERRUPTS();
+      if (
+            entry->numRepeats==0 ||
+            now-entry->lastReport<OPENSERIAL_ERR_PERIOD_TICKS
+         ) {
+         ENABLE_INTERRUPTS();
+         continue;
+      }
+      temp.component  = entry->component;
+      temp.code       = entry->code;
+      temp.numRepeats = entry->numRepeats;
+      temp.arg1       = entry->arg1;
+      temp.arg2       = entry->arg2;
+      ENABLE_INTERRUPTS();
+      
+      if (openserial_printStatus(STATUS_ERRORS,(uint8_t*)&temp,sizeof(debugErrorEntry_t))==E_FAIL) {
+         // no room left, the other rows will be printed next time
+         break;
+      }
+      printed = TRUE;
+      
+      // repeats may have been counted in the meantime
+      DISABLE_INTERRUPTS();
+      entry->numRepeats -= temp.numRepeats;
+      entry->lastReport  = now;
+      ENABLE_INTERRUPTS();
+   }
+   
+   return printed;
+}
+
 void openserial_goldenImageCommands(void){
    uint8_t  input_buffer[7];
    uint8_t  numDataBytes;
@@ -405,6 +676,7 @@ void openserial_goldenImageCommands(void){
    uint8_t  commandId;
    uint8_t  commandLen;
    uint8_t  comandParam_8;
+   openserial_command_cbt cb;
    
    numDataBytes = openserial_getNumDataBytes();
    //copying the buffer
@@ -447,56 +719,436 @@ void openserial_goldenImageCommands(void){
            }
            break;
        default:
-           // wrong command ID
+           // handled by the module which registered it, if any
+           if (commandId<COMMAND_MAX) {
+               cb = openserial_vars.commandCb[commandId];
+               if (cb!=NULL) {
+                   cb(&openserial_vars.inputBuf[5],commandLen);
+               }
+           }
            break;
    }
 }
 
+/**
+\brief Whether this occurrence of an info/error code is to be sent.
+*/
+bool openserial_eventSubscribed(uint8_t error_code) {
+   eventSub_t* sub;
+   uint8_t     i;
+   bool        returnVal;
+   INTERRUPT_DECLARATION();
+   
+   returnVal = TRUE;
+   
+   DISABLE_INTERRUPTS();
+   for (i=0;i<OPENSERIAL_NUM_EVENT_SUBS;i++) {
+      sub = &openserial_vars.eventSubs[i];
+      if (sub->code==error_code && sub->code!=0) {
+         if (sub->period==0) {
+            returnVal = FALSE;
+         } else {
+            sub->count++;
+            if (sub->count<sub->period) {
+               returnVal = FALSE;
+            } else {
+               sub->count = 0;
+            }
+         }
+         break;
+      }
+   }
+   ENABLE_INTERRUPTS();
+   
+   return returnVal;
+}
+
 //=========================== private =========================================
 
-//===== hdlc (output)
+//===== subscriptions
 
 /**
-\brief Start an HDLC frame in the output buffer.
+\brief Apply a subscription command received from the host.
+
+The command carries one or more entries of 3 bytes: kind (SUBSCRIBE_STATUS or
+SUBSCRIBE_EVENT), id (STATUS element or info/error code) and period.
+- for a STATUS element, it is sent every period outputs, never if 0.
+- for an event code, one out of period occurrences is sent, none if 0.
+  Setting the period of an event code back to 1 frees its table entry.
 */
-port_INLINE void outputHdlcOpen() {
-   // initialize the value of the CRC
-   openserial_vars.outputCrc                          = HDLC_CRCINIT;
+void openserial_subscribe() {
+   uint8_t     numBytes;
+   uint8_t*    entry;
+   uint8_t     kind;
+   uint8_t     id;
+   uint8_t     period;
+   eventSub_t* sub;
+   uint8_t     i;
+   uint8_t     j;
+   
+   numBytes = openserial_vars.inputBufFill-1;
+   if (numBytes==0 || numBytes%3!=0) {
+      openserial_printError(COMPONENT_OPENSERIAL,ERR_INPUTBUFFER_LENGTH,
+                            (errorparameter_t)numBytes,
+                            (errorparameter_t)SERFRAME_PC2MOTE_SUBSCRIBE);
+      return;
+   }
    
-   // write the opening HDLC flag
-   openserial_vars.outputBuf[openserial_vars.outputBufIdxW++]     = HDLC_FLAG;
+   for (i=0;i<numBytes;i+=3) {
+      entry  = &openserial_vars.inputBuf[1+i];
+      kind   = entry[0];
+      id     = entry[1];
+      period = entry[2];
+      switch (kind) {
+         case SUBSCRIBE_STATUS:
+            if (id>=STATUS_MAX) {
+               break;
+            }
+            openserial_vars.statusPeriod[id]    = period;
+            openserial_vars.statusCountdown[id] = 0;
+            break;
+         case SUBSCRIBE_EVENT:
+            // find the entry of that code, or a free one
+            sub = NULL;
+            for (j=0;j<OPENSERIAL_NUM_EVENT_SUBS;j++) {
+               if (openserial_vars.eventSubs[j].code==id) {
+                  sub = &openserial_vars.eventSubs[j];
+                  break;
+               }
+               if (sub==NULL && openserial_vars.eventSubs[j].code==0) {
+                  sub = &openserial_vars.eventSubs[j];
+               }
+            }
+            if (period==1) {
+               // back to the default, sending every occurrence
+               if (sub!=NULL && sub->code==id) {
+                  sub->code = 0;
+               }
+               break;
+            }
+            if (sub==NULL) {
+               openserial_printError(COMPONENT_OPENSERIAL,ERR_UNSUPPORTED_COMMAND,
+                                     (errorparameter_t)SERFRAME_PC2MOTE_SUBSCRIBE,
+                                     (errorparameter_t)id);
+               break;
+            }
+            sub->code   = id;
+            sub->period = period;
+            sub->count  = 0;
+            break;
+         default:
+            openserial_printError(COMPONENT_OPENSERIAL,ERR_UNSUPPORTED_COMMAND,
+                                  (errorparameter_t)SERFRAME_PC2MOTE_SUBSCRIBE,
+                                  (errorparameter_t)kind);
+            break;
+      }
+   }
 }
+
+//===== error aggregation
+
 /**
-\brief Add a byte to the outgoing HDLC frame being built.
+\brief Count an error in the aggregation table.
+
+The entry of that (component, error code) is looked up. Otherwise, a free entry
+is taken, or one with no repeats left to report and not reported for
+OPENSERIAL_ERR_PERIOD_MS. If there is none, the error isn't aggregated.
+
+\returns TRUE if the error was reported less than OPENSERIAL_ERR_PERIOD_MS
+   ago, in which case it is only counted; FALSE if it is to be reported now.
 */
-port_INLINE void outputHdlcWrite(uint8_t b) {
+bool openserial_errAggregate(
+      uint8_t          component,
+      uint8_t          code,
+      errorparameter_t arg1,
+      errorparameter_t arg2
+   ) {
+   errAgg_t* entry;
+   errAgg_t* candidate;
+   uint32_t  now;
+   uint8_t   i;
+   bool      returnVal;
+   INTERRUPT_DECLARATION();
    
-   // iterate through CRC calculator
-   openserial_vars.outputCrc = crcIteration(openserial_vars.outputCrc,b);
+   now = opentimers_getValue();
    
-   // add byte to buffer
-   if (b==HDLC_FLAG || b==HDLC_ESCAPE) {
-      openserial_vars.outputBuf[openserial_vars.outputBufIdxW++]  = HDLC_ESCAPE;
-      b                                               = b^HDLC_ESCAPE_MASK;
+   DISABLE_INTERRUPTS();
+   
+   entry = NULL;
+   for (i=0;i<OPENSERIAL_NUM_ERR_AGG;i++) {
+      candidate = &openserial_vars.errAgg[i];
+      if (candidate->code==code && candidate->component==component) {
+         entry = candidate;
+         break;
+      }
+      if (
+            entry==NULL                &&
+            candidate->numRepeats==0   &&
+            (
+               candidate->code==0 ||
+               now-candidate->lastReport>=OPENSERIAL_ERR_PERIOD_TICKS
+            )
+         ) {
+         entry = candidate;
+      }
+   }
+   
+   if (entry==NULL) {
+      // table full
+      returnVal = FALSE;
+   } else if (
+         entry->code==code && entry->component==component &&
+         now-entry->lastReport<OPENSERIAL_ERR_PERIOD_TICKS
+      ) {
+      // reported recently, only count it
+      if (entry->numRepeats<0xffff) {
+         entry->numRepeats++;
+      }
+      entry->arg1       = arg1;
+      entry->arg2       = arg2;
+      returnVal = TRUE;
+   } else {
+      // first occurrence for a while, report it
+      if (entry->code!=code || entry->component!=component) {
+         entry->component  = component;
+         entry->code       = code;
+         entry->numRepeats = 0;
+      }
+      entry->lastReport = now;
+      returnVal = FALSE;
+   }
+   
+   ENABLE_INTERRUPTS();
+   
+   return returnVal;
+}
+
+//===== status batch
+
+/**
+\brief Have a module print a status element.
+
+\returns TRUE if something was printed.
+*/
+bool openserial_debugPrint(uint8_t statusElement) {
+   bool    printed;
+   uint8_t i;
+   
+   printed = FALSE;
+   switch (statusElement) {
+      case STATUS_ISSYNC:
+         printed = debugPrint_isSync();
+         break;
+      case STATUS_ID:
+         printed = debugPrint_id();
+         break;
+      case STATUS_DAGRANK:
+         printed = debugPrint_myDAGrank();
+         break;
+      case STATUS_ASN:
+         printed = debugPrint_asn();
+         break;
+      case STATUS_MACSTATS:
+         printed = debugPrint_macStats();
+         break;
+      case STATUS_NEIGHBORS:
+         // several rows per frame, the table would take MAXNUMNEIGHBORS otherwise
+         for (i=0;i<STATUS_BATCH_NEIGHBOR_ROWS && openserial_vars.statusBatchFull==FALSE;i++) {
+            printed |= debugPrint_neighbors();
+         }
+         break;
+      case STATUS_TASKS:
+         printed = debugPrint_tasks();
+         break;
+      case STATUS_TIMERS:
+         printed = debugPrint_timers();
+         break;
+      case STATUS_SLEEP:
+         printed = debugPrint_sleep();
+         break;
+      case STATUS_OUTBUFFER:
+         printed = debugPrint_outBufferIndexes();
+         break;
+      case STATUS_ERRORS:
+         printed = debugPrint_errors();
+         break;
+      default:
+         break;
+   }
+   return printed;
+}
+
+/**
+\brief Start collecting status elements into a batched status frame.
+
+The payload budget is chosen so the frame fits in the room left in the output
+buffer even if every byte needs to be HDLC-escaped.
+*/
+void openserial_statusBatchOpen() {
+   uint16_t room;
+   uint16_t budget;
+   INTERRUPT_DECLARATION();
+   
+   DISABLE_INTERRUPTS();
+   room = SERIAL_OUTPUT_BUFFER_SIZE-(uint16_t)(openserial_vars.outputBufIdxReserved-openserial_vars.outputBufIdxR);
+   ENABLE_INTERRUPTS();
+   
+   // 2 flags, then type, address, version and CRC, all possibly escaped
+   if (room<2+2*(1+2+1+2)) {
+      budget = 0;
+   } else {
+      budget = (room-(2+2*(1+2+1+2)))/2;
+   }
+   if (budget>STATUS_BATCH_MAXLEN) {
+      budget = STATUS_BATCH_MAXLEN;
    }
-   openserial_vars.outputBuf[openserial_vars.outputBufIdxW++]     = b;
    
+   openserial_vars.statusBatchBudget  = (uint8_t)budget;
+   openserial_vars.statusBatchLen     = 0;
+   openserial_vars.statusBatchFull    = FALSE;
+   openserial_vars.statusBatching     = TRUE;
 }
+
 /**
-\brief Finalize the outgoing HDLC frame.
+\brief Send the batched status frame, if any element was collected.
+
+Format: version (1B), then for each element its type (1B), length (1B) and
+value.
 */
-port_INLINE void outputHdlcClose() {
-   uint16_t   finalCrc;
-    
-   // finalize the calculation of the CRC
-   finalCrc   = ~openserial_vars.outputCrc;
+void openserial_statusBatchClose() {
+   uint8_t head[4];
    
-   // write the CRC value
-   outputHdlcWrite((finalCrc>>0)&0xff);
-   outputHdlcWrite((finalCrc>>8)&0xff);
+   openserial_vars.statusBatching     = FALSE;
    
-   // write the closing HDLC flag
-   openserial_vars.outputBuf[openserial_vars.outputBufIdxW++]   = HDLC_FLAG;
+   if (openserial_vars.statusBatchLen==0) {
+      return;
+   }
+   
+   head[0] = SERFRAME_MOTE2PC_STATUS_BATCH;
+   head[1] = idmanager_getMyID(ADDR_16B)->addr_16b[0];
+   head[2] = idmanager_getMyID(ADDR_16B)->addr_16b[1];
+   head[3] = STATUS_BATCH_VERSION;
+   outputHdlcFrame(
+      head,
+      sizeof(head),
+      openserial_vars.statusBatchBuf,
+      openserial_vars.statusBatchLen,
+      NULL,
+      0
+   );
+}
+
+//===== hdlc (output)
+
+/**
+\brief Queue an HDLC frame in the output buffer.
+
+The frame is the concatenation of up to three parts, any of which can be
+empty. Its CRC and escaped length are computed first. Room for the whole frame
+is then reserved in a short critical section; if there isn't enough, the frame
+is dropped and counted. The reserved bytes are written with interrupts enabled,
+and handed to the UART once no other frame is being written, as a frame can be
+queued from an interrupt while another one is being written.
+
+\returns E_FAIL if the frame was dropped.
+*/
+owerror_t outputHdlcFrame(
+      uint8_t* head,
+      uint8_t  headLen,
+      uint8_t* body,
+      uint8_t  bodyLen,
+      uint8_t* tail,
+      uint8_t  tailLen
+   ) {
+   uint8_t*   parts[3];
+   uint8_t    partLens[3];
+   uint16_t   crc;
+   uint16_t   frameLen;
+   uint16_t   fill;
+   uint16_t   idx;
+   uint8_t    p;
+   uint8_t    i;
+   INTERRUPT_DECLARATION();
+   
+   parts[0]    = head;
+   partLens[0] = headLen;
+   parts[1]    = body;
+   partLens[1] = bodyLen;
+   parts[2]    = tail;
+   partLens[2] = tailLen;
+   
+   // CRC and length once escaped, including the two flags
+   crc         = HDLC_CRCINIT;
+   frameLen    = 2;
+   for (p=0;p<3;p++) {
+      for (i=0;i<partLens[p];i++) {
+         crc       = crcIteration(crc,parts[p][i]);
+         frameLen += outputHdlcLen(parts[p][i]);
+      }
+   }
+   crc         = ~crc;
+   frameLen   += outputHdlcLen((crc>>0)&0xff);
+   frameLen   += outputHdlcLen((crc>>8)&0xff);
+   
+   // reserve room for the whole frame
+   DISABLE_INTERRUPTS();
+   fill = (uint16_t)(openserial_vars.outputBufIdxReserved-openserial_vars.outputBufIdxR);
+   if (frameLen>SERIAL_OUTPUT_BUFFER_SIZE-fill) {
+      openserial_vars.outputNumDroppedFrames++;
+      openserial_vars.outputNumDroppedBytes += frameLen;
+      ENABLE_INTERRUPTS();
+      return E_FAIL;
+   }
+   idx                                   = openserial_vars.outputBufIdxReserved;
+   openserial_vars.outputBufIdxReserved += frameLen;
+   openserial_vars.outputNumWriters++;
+   if (fill+frameLen>openserial_vars.outputMaxFill) {
+      openserial_vars.outputMaxFill      = fill+frameLen;
+   }
+   ENABLE_INTERRUPTS();
+   
+   // write the frame
+   openserial_vars.outputBuf[(idx++)&SERIAL_OUTPUT_BUFFER_MASK] = HDLC_FLAG;
+   for (p=0;p<3;p++) {
+      for (i=0;i<partLens[p];i++) {
+         idx = outputHdlcWrite(idx,parts[p][i]);
+      }
+   }
+   idx = outputHdlcWrite(idx,(crc>>0)&0xff);
+   idx = outputHdlcWrite(idx,(crc>>8)&0xff);
+   openserial_vars.outputBuf[(idx++)&SERIAL_OUTPUT_BUFFER_MASK] = HDLC_FLAG;
+   
+   // hand it to the UART, along with frames reserved after it, if written
+   DISABLE_INTERRUPTS();
+   openserial_vars.outputNumWriters--;
+   if (openserial_vars.outputNumWriters==0) {
+      openserial_vars.outputBufIdxW      = openserial_vars.outputBufIdxReserved;
+   }
+   ENABLE_INTERRUPTS();
+   
+   return E_SUCCESS;
+}
+/**
+\brief Number of bytes a byte takes once HDLC-escaped.
+*/
+port_INLINE uint8_t outputHdlcLen(uint8_t b) {
+   if (b==HDLC_FLAG || b==HDLC_ESCAPE) {
+      return 2;
+   }
+   return 1;
+}
+/**
+\brief Write a byte, HDLC-escaped, into the output buffer.
+
+\returns The index following the byte(s) written.
+*/
+port_INLINE uint16_t outputHdlcWrite(uint16_t idx, uint8_t b) {
+   if (b==HDLC_FLAG || b==HDLC_ESCAPE) {
+      openserial_vars.outputBuf[(idx++)&SERIAL_OUTPUT_BUFFER_MASK] = HDLC_ESCAPE;
+      b                                                            = b^HDLC_ESCAPE_MASK;
+   }
+   openserial_vars.outputBuf[(idx++)&SERIAL_OUTPUT_BUFFER_MASK]    = b;
+   return idx;
 }
 
 //===== hdlc (input)
@@ -562,11 +1214,8 @@ void isr_openserial_tx() {
          }
          break;
       case MODE_OUTPUT:
-         if (openserial_vars.outputBufIdxW==openserial_vars.outputBufIdxR) {
-            openserial_vars.outputBufFilled = FALSE;
-         }
-         if (openserial_vars.outputBufFilled) {
-            uart_writeByte(openserial_vars.outputBuf[openserial_vars.outputBufIdxR++]);
+         if (openserial_vars.outputBufIdxR!=openserial_vars.outputBufIdxW) {
+            uart_writeByte(openserial_vars.outputBuf[(openserial_vars.outputBufIdxR++)&SERIAL_OUTPUT_BUFFER_MASK]);
          }
          break;
       case MODE_OFF:
@@ -21,10 +21,22 @@
 /**
 \brief Number of bytes of the serial output buffer, in bytes.
 
-\warning should be exactly 256 so wrap-around on the index does not require
-         the use of a slow modulo operator.
+\warning Must be a power of two, at most 32768, as indices into the buffer are
+         free-running 16-bit counters, masked with SERIAL_OUTPUT_BUFFER_MASK.
+
+The sniffer image streams every frame it overhears, it gets a larger buffer.
 */
-#define SERIAL_OUTPUT_BUFFER_SIZE 256 // leave at 256!
+#ifndef SERIAL_OUTPUT_BUFFER_SIZE
+#ifdef GOLDEN_IMAGE_SNIFFER
+#define SERIAL_OUTPUT_BUFFER_SIZE 1024
+#else
+#define SERIAL_OUTPUT_BUFFER_SIZE 256
+#endif
+#endif
+#if (SERIAL_OUTPUT_BUFFER_SIZE&(SERIAL_OUTPUT_BUFFER_SIZE-1))!=0 || SERIAL_OUTPUT_BUFFER_SIZE>32768
+#error "SERIAL_OUTPUT_BUFFER_SIZE must be a power of two, at most 32768"
+#endif
+#define SERIAL_OUTPUT_BUFFER_MASK (SERIAL_OUTPUT_BUFFER_SIZE-1)
 
 /**
 \brief Number of bytes of the serial input buffer, in bytes.
@@ -34,6 +46,42 @@
 */
 #define SERIAL_INPUT_BUFFER_SIZE  200
 
+/**
+\brief Maximum number of payload bytes of a batched status frame.
+
+Status elements are packed into a single SERFRAME_MOTE2PC_STATUS_BATCH frame,
+as long as they fit in that many bytes and, once HDLC-escaped, in the room
+left in the output buffer.
+*/
+#define STATUS_BATCH_MAXLEN       120
+
+/// version of the TLV layout of batched status frames
+#define STATUS_BATCH_VERSION      1
+
+/// neighbor rows sent per batched status frame, at most
+#define STATUS_BATCH_NEIGHBOR_ROWS 4
+
+/// number of event codes whose rate can be set by the host
+#define OPENSERIAL_NUM_EVENT_SUBS  8
+
+/// number of (component, error code) pairs whose repeats can be aggregated
+#define OPENSERIAL_NUM_ERR_AGG     8
+
+/**
+\brief Minimum time between two reports of the same error, in ms.
+
+Repeats in between are only counted, and reported as a STATUS_ERRORS row once
+that time has elapsed. It is measured with opentimers, not the ASN, which
+stands still while the mote is not synchronized.
+*/
+#ifndef OPENSERIAL_ERR_PERIOD_MS
+#define OPENSERIAL_ERR_PERIOD_MS 15000
+#endif
+#define OPENSERIAL_ERR_PERIOD_TICKS ((uint32_t)OPENSERIAL_ERR_PERIOD_MS*PORT_TICS_PER_MS)
+
+/// how late the reboot after a critical error may happen, see openserial_printCritical()
+#define OPENSERIAL_RESET_SLACK_MS 50
+
 /// Modes of the openserial module.
 enum {
    MODE_OFF    = 0, ///< The module is off, no serial activity.
@@ -49,12 +97,22 @@ enum {
 #define SERFRAME_MOTE2PC_CRITICAL           ((uint8_t)'C')
 #define SERFRAME_MOTE2PC_REQUEST            ((uint8_t)'R')
 #define SERFRAME_MOTE2PC_SNIFFED_PACKET     ((uint8_t)'P')
+#define SERFRAME_MOTE2PC_STATUS_BATCH       ((uint8_t)'B')
+#define SERFRAME_MOTE2PC_EVENTLOG           ((uint8_t)'L')
+
+/**
+\brief Number of bytes following the frame in a SERFRAME_MOTE2PC_SNIFFED_PACKET.
+
+   rssi (1B) | lqi (1B) | crc (1B) | ASN (5B) | channel (1B)
+*/
+#define SNIFFED_PACKET_TAIL_LEN             (1+1+1+5+1)
 
 // frames sent PC->mote
 #define SERFRAME_PC2MOTE_SETROOT            ((uint8_t)'R')
 #define SERFRAME_PC2MOTE_DATA               ((uint8_t)'D')
 #define SERFRAME_PC2MOTE_TRIGGERSERIALECHO  ((uint8_t)'S')
 #define SERFRAME_PC2MOTE_COMMAND_GD         ((uint8_t)'G')
+#define SERFRAME_PC2MOTE_SUBSCRIBE          ((uint8_t)'U')
 
 //=========================== typedef =========================================
 
@@ -69,15 +127,79 @@ enum {
    COMMAND_SET_SECURITY_STATUS   =  7,
    COMMAND_SET_FRAMELENGTH       =  8,
    COMMAND_SET_ACK_STATUS        =  9,
-   COMMAND_MAX                   = 10,
+   COMMAND_SET_UINJECTPERIOD     = 10,
+   COMMAND_MAX                   = 11,
+};
+
+/// Handler of a golden image command, given its 1 or 2 parameter bytes.
+typedef void (*openserial_command_cbt)(uint8_t* param, uint8_t paramLen);
+
+BEGIN_PACK
+typedef struct {
+   uint16_t   readIdx;
+   uint16_t   writeIdx;
+   uint16_t   maxFill;
+   uint16_t   numDroppedFrames;
+   uint32_t   numDroppedBytes;
+} debugOutBufferEntry_t;
+END_PACK
+
+BEGIN_PACK
+typedef struct {
+   uint8_t          component;
+   uint8_t          code;
+   uint16_t         numRepeats;
+   errorparameter_t arg1;
+   errorparameter_t arg2;
+} debugErrorEntry_t;
+END_PACK
+
+/// Repeats of an error reported less than OPENSERIAL_ERR_PERIOD_MS ago.
+typedef struct {
+   uint8_t          component;
+   uint8_t          code;        ///< error code, 0 if the entry is free
+   uint16_t         numRepeats;  ///< occurrences not reported yet
+   errorparameter_t arg1;        ///< of the last occurrence
+   errorparameter_t arg2;        ///< of the last occurrence
+   uint32_t         lastReport;  ///< when last reported, as a frame or a row, opentimers time
+} errAgg_t;
+
+/// Kinds of entries of a SERFRAME_PC2MOTE_SUBSCRIBE frame.
+enum {
+   SUBSCRIBE_STATUS              =  0, ///< id is a STATUS element
+   SUBSCRIBE_EVENT               =  1, ///< id is an info/error code
 };
 
+/**
+\brief Rate at which an info/error code is sent.
+
+Event codes not in the subscription table are always sent.
+*/
+typedef struct {
+   uint8_t    code;    ///< info/error code, 0 if the entry is free
+   uint8_t    period;  ///< send one out of that many, 0 to send none
+   uint8_t    count;   ///< occurrences since the last one sent
+} eventSub_t;
+
 //=========================== module variables ================================
 
 typedef struct {
    // admin
    uint8_t    mode;
    uint8_t    debugPrintCounter;
+   bool       isTaskDropReported;          // was the first task the scheduler dropped reported?
+   // subscriptions
+   uint8_t    statusPeriod[STATUS_MAX];    // send every that many outputs, 0 for never
+   uint8_t    statusCountdown[STATUS_MAX]; // outputs left before the element is due
+   eventSub_t eventSubs[OPENSERIAL_NUM_EVENT_SUBS];
+   // error aggregation
+   errAgg_t   errAgg[OPENSERIAL_NUM_ERR_AGG];
+   // status batch
+   bool       statusBatching;
+   bool       statusBatchFull;
+   uint8_t    statusBatchBudget;
+   uint8_t    statusBatchLen;
+   uint8_t    statusBatchBuf[STATUS_BATCH_MAXLEN];
    // input
    uint8_t    reqFrame[1+1+2+1]; // flag (1B), command (2B), CRC (2B), flag (1B)
    uint8_t    reqFrameIdx;
@@ -87,11 +209,15 @@ typedef struct {
    uint16_t   inputCrc;
    uint8_t    inputBufFill;
    uint8_t    inputBuf[SERIAL_INPUT_BUFFER_SIZE];
-   // output
-   bool       outputBufFilled;
-   uint16_t   outputCrc;
-   uint8_t    outputBufIdxW;
-   uint8_t    outputBufIdxR;
+   openserial_command_cbt commandCb[COMMAND_MAX]; // handlers registered by other modules, NULL if none
+   // output (single consumer, the UART; frames are queued from any context)
+   uint16_t   outputBufIdxR;        // next byte to send, only moved by the UART
+   uint16_t   outputBufIdxW;        // end of the bytes ready to be sent
+   uint16_t   outputBufIdxReserved; // end of the bytes reserved for frames
+   uint8_t    outputNumWriters;     // frames reserved, but not yet written
+   uint16_t   outputMaxFill;
+   uint16_t   outputNumDroppedFrames;
+   uint32_t   outputNumDroppedBytes;
    uint8_t    outputBuf[SERIAL_OUTPUT_BUFFER_SIZE];
 } openserial_vars_t;
 
@@ -109,13 +235,22 @@ owerror_t openserial_printCritical(uint8_t calling_component, uint8_t error_code
                               errorparameter_t arg1,
                               errorparameter_t arg2);
 owerror_t openserial_printData(uint8_t* buffer, uint8_t length);
-owerror_t openserial_printPacket(uint8_t* buffer, uint8_t length, uint8_t channel);
+owerror_t openserial_printPacket(uint8_t* buffer, uint8_t length, uint8_t channel,
+                              int8_t rssi, uint8_t lqi, bool crc);
+owerror_t openserial_printEventLog(uint8_t* buffer, uint8_t length);
+bool    openserial_eventSubscribed(uint8_t error_code);
 uint8_t openserial_getNumDataBytes(void);
 uint8_t openserial_getInputBuffer(uint8_t* bufferToWrite, uint8_t maxNumBytes);
 void    openserial_startInput(void);
 void    openserial_startOutput(void);
 void    openserial_stop(void);
+bool    openserial_isIdle(void);
+void    openserial_registerCommand(uint8_t commandId, openserial_command_cbt cb);
 bool    debugPrint_outBufferIndexes(void);
+bool    debugPrint_errors(void);
+bool    debugPrint_timers(void);
+bool    debugPrint_tasks(void);
+bool    debugPrint_sleep(void);
 void    openserial_echo(uint8_t* but, uint8_t bufLen);
 
 // interrupt handlers
@@ -4,6 +4,15 @@
 This driver uses a single hardware timer, which it virtualizes to support
 at most MAX_NUM_TIMERS timers.
 
+Running timers are kept in a binary min-heap ordered by deadline. Starting or
+stopping a timer takes O(log n), and finding the next timer to expire O(1).
+When the hardware timer elapses, only the timers which expired are touched.
+
+Timers can be given some slack (see opentimers_setSlack()). Such a timer may
+fire up to that many ticks late, which allows it to be served from a task
+right after a TSCH slot boundary (see opentimers_newSlot()), when the MCU is
+awake anyway, rather than waking it up through the hardware timer.
+
 \author Xavi Vilajosana <xvilajosana@eecs.berkeley.edu>, March 2012.
  */
 
@@ -17,11 +26,26 @@ at most MAX_NUM_TIMERS timers.
 //=========================== variables =======================================
 
 opentimers_vars_t opentimers_vars;
-//uint32_t counter; //counts the elapsed time.
+opentimers_dbg_t  opentimers_dbg;
 
 //=========================== prototypes ======================================
 
-void opentimers_timer_callback(void);
+void     opentimers_timer_callback(void);
+opentimer_id_t opentimers_popDue(uint32_t now, opentimers_cbt* callback);
+// time
+uint32_t opentimers_toTicks(time_type_t timetype, uint32_t duration);
+uint32_t opentimers_getTime(void);
+void     opentimers_catchUp(void);
+uint8_t  opentimers_expire(uint32_t now);
+void     opentimers_schedule(void);
+void     opentimers_rearm(void);
+// heap
+bool     opentimers_isEarlier(opentimer_id_t a, opentimer_id_t b);
+void     opentimers_heapSwap(uint8_t i, uint8_t j);
+void     opentimers_heapSiftUp(uint8_t pos);
+void     opentimers_heapSiftDown(uint8_t pos);
+void     opentimers_heapInsert(opentimer_id_t id);
+void     opentimers_heapRemove(opentimer_id_t id);
 
 //=========================== public ==========================================
 
@@ -34,15 +58,17 @@ void opentimers_init(){
    uint8_t i;
 
    // initialize local variables
+   memset(&opentimers_vars,0,sizeof(opentimers_vars_t));
+   memset(&opentimers_dbg,0,sizeof(opentimers_dbg_t));
    opentimers_vars.running=FALSE;
    for (i=0;i<MAX_NUM_TIMERS;i++) {
-      opentimers_vars.timersBuf[i].period_ticks       = 0;
-      opentimers_vars.timersBuf[i].ticks_remaining    = 0;
       opentimers_vars.timersBuf[i].type               = TIMER_ONESHOT;
       opentimers_vars.timersBuf[i].isrunning          = FALSE;
       opentimers_vars.timersBuf[i].callback           = NULL;
-      opentimers_vars.timersBuf[i].hasExpired         = FALSE;
+      // lowest ids are handed out first
+      opentimers_vars.freeIds[i]                      = MAX_NUM_TIMERS-1-i;
    }
+   opentimers_vars.numFree                            = MAX_NUM_TIMERS;
 
    // set callback for bsp_timers module
    bsp_timer_set_callback(opentimers_timer_callback);
@@ -52,10 +78,9 @@ void opentimers_init(){
 \brief Start a timer.
 
 The timer works as follows:
-- currentTimeout is the number of ticks before the next timer expires.
-- if a new timer is inserted, we check that it is not earlier than the soonest
-- if it is earliest, replace it
-- if not, insert it in the list
+- the timer is given a deadline, "duration" after the current time.
+- it is inserted in the heap of running timers.
+- if it is now the earliest one, the hardware timer is re-armed.
 
 \param duration Number milli-seconds after which the timer will fire.
 \param type     Type of timer:
@@ -71,293 +96,610 @@ The timer works as follows:
 \returns TOO_MANY_TIMERS_ERROR if the timer could NOT be started.
  */
 opentimer_id_t opentimers_start(uint32_t duration, timer_type_t type, time_type_t timetype, opentimers_cbt callback) {
+   opentimer_id_t id;
+   INTERRUPT_DECLARATION();
 
-   uint8_t  id;
+   DISABLE_INTERRUPTS();
 
    // find an unused timer
-   for (id=0; id<MAX_NUM_TIMERS && opentimers_vars.timersBuf[id].isrunning==TRUE; id++);
-
-   if (id<MAX_NUM_TIMERS) {
-      // we found an unused timer
-
-      // register the timer
-      if (timetype==TIME_MS) {
-         opentimers_vars.timersBuf[id].period_ticks      = duration*PORT_TICS_PER_MS;
-         opentimers_vars.timersBuf[id].wraps_remaining   = (duration*PORT_TICS_PER_MS/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t
-      } else if (timetype==TIME_TICS) {
-         opentimers_vars.timersBuf[id].period_ticks      = duration;
-         opentimers_vars.timersBuf[id].wraps_remaining   = (duration/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t  
-      } else {
-         while (1); //error
+   if (opentimers_vars.numFree==0) {
+      ENABLE_INTERRUPTS();
+      return TOO_MANY_TIMERS_ERROR;
+   }
+   id = opentimers_vars.freeIds[--opentimers_vars.numFree];
+
+   // register the timer
+   opentimers_vars.timersBuf[id].period_ticks      = opentimers_toTicks(timetype,duration);
+   opentimers_vars.timersBuf[id].deadline          = opentimers_getTime()+opentimers_vars.timersBuf[id].period_ticks;
+   opentimers_vars.timersBuf[id].slack_ticks       = 0;
+   opentimers_vars.timersBuf[id].type              = type;
+   opentimers_vars.timersBuf[id].isrunning         = TRUE;
+   opentimers_vars.timersBuf[id].callback          = callback;
+   opentimers_heapInsert(id);
+
+   // re-schedule the hardware timer, if needed
+   if (opentimers_vars.heap[0]==id) {
+      opentimers_rearm();
+   }
+
+   ENABLE_INTERRUPTS();
+
+   return id;
+}
+
+/**
+\brief Replace the period of a running timer.
+
+If the timer is running, it now elapses "newDuration" after the current time.
+ */
+void  opentimers_setPeriod(opentimer_id_t id,time_type_t timetype,uint32_t newDuration) {
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+
+   opentimers_vars.timersBuf[id].period_ticks      = opentimers_toTicks(timetype,newDuration);
+
+   if (opentimers_vars.timersBuf[id].isrunning==TRUE) {
+      // move the timer to its new place in the heap
+      opentimers_vars.timersBuf[id].deadline       = opentimers_getTime()+opentimers_vars.timersBuf[id].period_ticks;
+      opentimers_heapSiftUp(opentimers_vars.timersBuf[id].heapIndex);
+      opentimers_heapSiftDown(opentimers_vars.timersBuf[id].heapIndex);
+
+      // re-schedule the hardware timer, if needed
+      if (opentimers_vars.heap[0]==id) {
+         opentimers_rearm();
+      }
+   }
+
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Stop a running timer.
+
+Sets the timer to "not running", and releases its id. The system recovers even
+if this was the next timer to expire.
+ */
+void opentimers_stop(opentimer_id_t id) {
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+
+   if (opentimers_vars.timersBuf[id].isrunning==TRUE) {
+      opentimers_heapRemove(id);
+      opentimers_vars.timersBuf[id].isrunning     = FALSE;
+      opentimers_vars.freeIds[opentimers_vars.numFree++] = id;
+   }
+
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Restart a stopped timer.
+
+Sets the timer to "running" again, for a full period, provided its id was not
+handed out to another timer in the meantime.
+ */
+void opentimers_restart(opentimer_id_t id) {
+   uint8_t i;
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+
+   if (opentimers_vars.timersBuf[id].isrunning==TRUE) {
+      ENABLE_INTERRUPTS();
+      return;
+   }
+
+   // take the id back from the free ones
+   for (i=0;i<opentimers_vars.numFree;i++) {
+      if (opentimers_vars.freeIds[i]==id) {
+         break;
+      }
+   }
+   if (i==opentimers_vars.numFree) {
+      ENABLE_INTERRUPTS();
+      return;
+   }
+   opentimers_vars.freeIds[i] = opentimers_vars.freeIds[--opentimers_vars.numFree];
+
+   opentimers_vars.timersBuf[id].deadline          = opentimers_getTime()+opentimers_vars.timersBuf[id].period_ticks;
+   opentimers_vars.timersBuf[id].isrunning         = TRUE;
+   opentimers_heapInsert(id);
+
+   if (opentimers_vars.heap[0]==id) {
+      opentimers_rearm();
+   }
+
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Allow a running timer to fire late.
+
+A timer with some slack fires between its deadline and its deadline plus the
+slack. If a slot boundary falls within that window, it is served right after
+that boundary, from a task (see opentimers_newSlot()). Use a slack of at least one slot duration
+for that to happen every time. A slack of 0 (the default) restores the timer
+to firing from the hardware timer interrupt, on time.
+
+\param id       The id of the timer.
+\param timetype Units of the <tt>slack</tt>.
+\param slack    How late the timer may fire.
+ */
+void opentimers_setSlack(opentimer_id_t id,time_type_t timetype,uint32_t slack) {
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+
+   if (timetype==TIME_MS) {
+      opentimers_vars.timersBuf[id].slack_ticks   = slack*PORT_TICS_PER_MS;
+   } else {
+      opentimers_vars.timersBuf[id].slack_ticks   = slack;
+   }
+
+   if (opentimers_vars.timersBuf[id].isrunning==TRUE) {
+      // move the timer to its new place in the heap
+      opentimers_heapSiftUp(opentimers_vars.timersBuf[id].heapIndex);
+      opentimers_heapSiftDown(opentimers_vars.timersBuf[id].heapIndex);
+
+      if (opentimers_vars.heap[0]==id) {
+         opentimers_rearm();
       }
-      //if the number of ticks falls below a 16bit value, use it, otherwise set to max 16bit value
-      if(opentimers_vars.timersBuf[id].wraps_remaining==0){
-         if (timetype==TIME_MS){ 
-            opentimers_vars.timersBuf[id].ticks_remaining   = duration*PORT_TICS_PER_MS;
-         } else if (timetype==TIME_TICS) {
-            opentimers_vars.timersBuf[id].ticks_remaining   = duration;
-         } else {
-            // this should never happpen!
-   
-            // we can not print from within the drivers. Instead:
-            // blink the error LED
-            leds_error_blink();
-            // reset the board
-            board_reset();
-         }
-      }else{
-         opentimers_vars.timersBuf[id].ticks_remaining = MAX_TICKS_IN_SINGLE_CLOCK;
-      }                                                   
-      opentimers_vars.timersBuf[id].type              = type;
-      opentimers_vars.timersBuf[id].isrunning         = TRUE;
-      opentimers_vars.timersBuf[id].callback          = callback;
-      opentimers_vars.timersBuf[id].hasExpired        = FALSE;
-
-      // re-schedule the running timer, if needed
+   }
+
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Indicates a new TSCH slot has started.
+
+Executed in interrupt mode, at every slot boundary, so it only checks whether
+the next timer has slack and is already due. The driver doesn't depend on the
+scheduler, the caller posts opentimers_task_coalesce() to serve it.
+
+\returns TRUE if opentimers_task_coalesce() is to be posted, FALSE otherwise.
+ */
+bool opentimers_newSlot() {
+   opentimers_t* first;
+
+   // follow the hardware counter, even with no timer armed
+   opentimers_catchUp();
+
+   if (
+         opentimers_vars.numRunning==0            ||
+         opentimers_vars.isExpiring==TRUE         ||
+         opentimers_vars.coalescePending==TRUE
+      ) {
+      return FALSE;
+   }
+
+   first = &opentimers_vars.timersBuf[opentimers_vars.heap[0]];
+   if (
+         first->slack_ticks==0 ||
+         (int32_t)(first->deadline-opentimers_getTime())>0
+      ) {
+      return FALSE;
+   }
+
+   opentimers_vars.coalescePending = TRUE;
+   return TRUE;
+}
+
+/**
+\brief Serve the timers which are due, right after a slot boundary.
+
+Executed as a task. The callbacks are called with interrupts enabled, each
+timer being taken off the heap in a critical section of its own. If this moves
+the hardware timer further away, one of its wakeups was saved.
+ */
+void opentimers_task_coalesce() {
+   opentimer_id_t id;
+   opentimers_cbt callback;
+   uint32_t       target;
+   uint8_t        numExpired;
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   opentimers_vars.coalescePending = FALSE;
+   // when the hardware timer would have woken us up
+   target     = opentimers_vars.lastCompareTime+opentimers_vars.currentTimeout;
+   ENABLE_INTERRUPTS();
+
+   // call callbacks of expired timers
+   numExpired = 0;
+   while (1) {
+      DISABLE_INTERRUPTS();
+      id = opentimers_popDue(opentimers_getTime(),&callback);
+      ENABLE_INTERRUPTS();
+      if (id==TOO_MANY_TIMERS_ERROR) {
+         break;
+      }
+      numExpired++;
+      callback(id);
+   }
+
+   if (numExpired>0) {
+      DISABLE_INTERRUPTS();
+      opentimers_dbg.numCoalesced += numExpired;
+
+      opentimers_rearm();
       if (
-            (opentimers_vars.running==FALSE)
-            ||
-            (opentimers_vars.timersBuf[id].ticks_remaining < opentimers_vars.currentTimeout)
-      ) {  
-         opentimers_vars.currentTimeout            = opentimers_vars.timersBuf[id].ticks_remaining;
-         if (opentimers_vars.running==FALSE) {
-            bsp_timer_reset();
-         }
-         bsp_timer_scheduleIn(opentimers_vars.timersBuf[id].ticks_remaining);
+            opentimers_vars.running==FALSE ||
+            (int32_t)(opentimers_vars.lastCompareTime+opentimers_vars.currentTimeout-target)>0
+         ) {
+         opentimers_dbg.numWakeupsSaved++;
       }
+      ENABLE_INTERRUPTS();
+   }
+}
 
-      opentimers_vars.running                         = TRUE;
+/**
+\brief Time until the hardware timer fires.
 
+\returns The number of ticks until the hardware timer fires, 0xffffffff if it
+   is not armed.
+ */
+uint32_t opentimers_getTimeToNextEvent() {
+   PORT_TIMER_WIDTH elapsed;
+   uint32_t         returnVal;
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   if (opentimers_vars.running==FALSE) {
+      returnVal = 0xffffffff;
    } else {
-      return TOO_MANY_TIMERS_ERROR;
+      elapsed = (PORT_TIMER_WIDTH)(bsp_timer_get_currentValue()-opentimers_vars.lastCompareValue);
+      if (elapsed>=opentimers_vars.currentTimeout) {
+         returnVal = 0;
+      } else {
+         returnVal = opentimers_vars.currentTimeout-elapsed;
+      }
    }
+   ENABLE_INTERRUPTS();
 
-   return id;
+   return returnVal;
 }
 
 /**
-\brief Replace the period of a running timer.
+\brief Read the statistics of this driver.
+
+The driver can't print from within the drivers, openserial prints them.
+
+\param[out] stats Where to write them.
  */
-void  opentimers_setPeriod(opentimer_id_t id,time_type_t timetype,uint32_t newDuration) {
+void opentimers_getStats(debugOpentimersEntry_t* stats) {
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   stats->numRunning      = opentimers_vars.numRunning;
+   stats->numHwWakeups    = opentimers_dbg.numHwWakeups;
+   stats->numCoalesced    = opentimers_dbg.numCoalesced;
+   stats->numWakeupsSaved = opentimers_dbg.numWakeupsSaved;
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Account for time the hardware timer did not count.
+
+\param sleepTime Number of ticks elapsed while the hardware timer was stopped.
+ */
+void opentimers_sleepTimeCompesation(uint16_t sleepTime) {
+
+   // reCount the time after waking up from sleep
+   opentimers_vars.lastCompareTime += sleepTime;
+
+   // call callbacks of expired timers
+   opentimers_vars.isExpiring = TRUE;
+   opentimers_expire(opentimers_vars.lastCompareTime);
+   opentimers_vars.isExpiring = FALSE;
+
+   // schedule next timeout
+   opentimers_schedule();
+}
+
+/**
+\brief Current opentimers time, from outside the driver.
+
+Unlike the counter of bsp_timer, which is reset each time the hardware timer
+is re-armed, it keeps counting, so two readings can be subtracted. It also
+counts while no timer runs, see opentimers_catchUp().
+
+\returns The current opentimers time, in ticks.
+ */
+uint32_t opentimers_getValue() {
+   uint32_t returnVal;
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   opentimers_catchUp();
+   returnVal = opentimers_getTime();
+   ENABLE_INTERRUPTS();
+
+   return returnVal;
+}
+
+//=========================== private =========================================
+
+/**
+\brief Function called when the hardware timer expires.
+
+Executed in interrupt mode.
+
+This function pops the expired timers from the heap, calls the corresponding
+callback(s), and restarts the hardware timer with the next timer to expire.
+ */
+void opentimers_timer_callback() {
+
+   // the hardware timer elapsed, advance time
+   opentimers_vars.lastCompareTime  += opentimers_vars.currentTimeout;
+   opentimers_vars.lastCompareValue += opentimers_vars.currentTimeout;
+   opentimers_dbg.numHwWakeups++;
+
+   // the due timers are served here, a coalescing task lost on a full
+   // scheduler must not hold up the next ones
+   opentimers_vars.coalescePending   = FALSE;
+
+   // call callbacks of expired timers, the hardware timer is re-armed after
+   opentimers_vars.isExpiring = TRUE;
+   opentimers_expire(opentimers_vars.lastCompareTime);
+   opentimers_vars.isExpiring = FALSE;
+
+   // schedule next timeout
+   opentimers_schedule();
+}
+
+//=== time
+
+uint32_t opentimers_toTicks(time_type_t timetype, uint32_t duration) {
+   uint32_t ticks;
+
    if        (timetype==TIME_MS) {
-      opentimers_vars.timersBuf[id].period_ticks      = newDuration*PORT_TICS_PER_MS;
-      opentimers_vars.timersBuf[id].wraps_remaining   = (newDuration*PORT_TICS_PER_MS/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t
+      ticks = duration*PORT_TICS_PER_MS;
    } else if (timetype==TIME_TICS) {
-      opentimers_vars.timersBuf[id].period_ticks      = newDuration;
-      opentimers_vars.timersBuf[id].wraps_remaining   = (newDuration/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t
+      ticks = duration;
    } else {
       // this should never happpen!
-      
+
       // we can not print from within the drivers. Instead:
       // blink the error LED
       leds_error_blink();
       // reset the board
       board_reset();
+      ticks = 0;
    }
-   if(opentimers_vars.timersBuf[id].wraps_remaining==0) {
-      if        (timetype==TIME_MS){
-         opentimers_vars.timersBuf[id].ticks_remaining   = newDuration*PORT_TICS_PER_MS;
-      } else if (timetype==TIME_TICS){
-         opentimers_vars.timersBuf[id].ticks_remaining   = newDuration;
-      }
-   } else {
-      opentimers_vars.timersBuf[id].ticks_remaining = MAX_TICKS_IN_SINGLE_CLOCK;
+
+   // a periodic timer of period 0 would expire forever
+   if (ticks==0) {
+      ticks = 1;
    }
+
+   return ticks;
 }
 
 /**
-\brief Stop a running timer.
+\brief Current opentimers time.
 
-Sets the timer to "not running". the system recovers even if this was the next
-timer to expire.
+\returns The time of the last hardware timer compare, plus the ticks elapsed
+   since, as counted by the hardware timer. The counter keeps running while
+   the hardware timer isn't armed, and so does this time.
  */
-void opentimers_stop(opentimer_id_t id) {
-   opentimers_vars.timersBuf[id].isrunning=FALSE;
+uint32_t opentimers_getTime() {
+   return opentimers_vars.lastCompareTime +
+          (PORT_TIMER_WIDTH)(bsp_timer_get_currentValue()-opentimers_vars.lastCompareValue);
 }
 
 /**
-\brief Restart a stop timer.
+\brief Move the time of the last compare to now, while the hardware timer isn't
+   armed.
 
-Sets the timer to " running".
+With no compare to come, nothing else would account for the wraps of the
+hardware counter, which is narrower than opentimers time. Called at every slot,
+which is well within a wrap.
  */
-void opentimers_restart(opentimer_id_t id) {
-   opentimers_vars.timersBuf[id].isrunning=TRUE;
+void opentimers_catchUp() {
+   PORT_TIMER_WIDTH value;
+
+   if (opentimers_vars.running==TRUE) {
+      return;
+   }
+   value                             = bsp_timer_get_currentValue();
+   opentimers_vars.lastCompareTime  += (PORT_TIMER_WIDTH)(value-opentimers_vars.lastCompareValue);
+   opentimers_vars.lastCompareValue  = value;
 }
 
+/**
+\brief Call the callback of the timers which are due.
 
-//=========================== private =========================================
+Timers are taken from the top of the heap, for as long as they are due. A timer
+with slack might hence be due but not served, as long as a timer with an
+earlier deadline+slack is not due yet. It is then served later, still within
+its slack.
 
-/**
-\brief Function called when the hardware timer expires.
+Periodic timers are re-inserted in the heap before their callback is called,
+so the callback can stop them.
 
-Executed in interrupt mode.
+\param now The current opentimers time.
 
-This function maps the expiration event to possibly multiple timers, calls the
-corresponding callback(s), and restarts the hardware timer with the next timer
-to expire.
+\returns The number of timers which expired.
  */
-void opentimers_timer_callback() {
-   
-   opentimer_id_t   id;
-   PORT_TIMER_WIDTH min_timeout;
-   bool             found;
-    
-   // step 1. Identify expired timers
-   for(id=0; id<MAX_NUM_TIMERS; id++) {
-      if (opentimers_vars.timersBuf[id].isrunning==TRUE) {
-
-         if(opentimers_vars.currentTimeout >= opentimers_vars.timersBuf[id].ticks_remaining) {
-            // this timer has expired
-            //check to see if we have completed the whole timer, or we're just wrapping around the max 16bit value
-            if(opentimers_vars.timersBuf[id].wraps_remaining == 0){
-               // declare as so
-               opentimers_vars.timersBuf[id].hasExpired  = TRUE;
-            }else{
-               opentimers_vars.timersBuf[id].wraps_remaining--;
-               if(opentimers_vars.timersBuf[id].wraps_remaining == 0){
-                  //if we have fully wrapped around, then set the remainring ticks to the modulus of the total ticks and the max clock value
-                  opentimers_vars.timersBuf[id].ticks_remaining = (opentimers_vars.timersBuf[id].period_ticks) % MAX_TICKS_IN_SINGLE_CLOCK;
-               }else{
-                  opentimers_vars.timersBuf[id].ticks_remaining = MAX_TICKS_IN_SINGLE_CLOCK;
-               }
-            }
-         } else {
-            // this timer is not expired
-
-            // update its counter
-            opentimers_vars.timersBuf[id].ticks_remaining -= opentimers_vars.currentTimeout;
-         }   
-      }
+uint8_t opentimers_expire(uint32_t now) {
+   opentimer_id_t id;
+   opentimers_cbt callback;
+   uint8_t        numExpired;
+
+   numExpired = 0;
+   while ((id = opentimers_popDue(now,&callback))!=TOO_MANY_TIMERS_ERROR) {
+      numExpired++;
+      callback(id);
    }
 
-   // step 2. call callbacks of expired timers
-   for(id=0; id<MAX_NUM_TIMERS; id++) {
-      if (opentimers_vars.timersBuf[id].hasExpired==TRUE){
-
-         // call the callback
-         opentimers_vars.timersBuf[id].callback(id);
-         opentimers_vars.timersBuf[id].hasExpired     = FALSE;
-
-         // reload the timer, if applicable
-         if (opentimers_vars.timersBuf[id].type==TIMER_PERIODIC) {
-            opentimers_vars.timersBuf[id].wraps_remaining   = (opentimers_vars.timersBuf[id].period_ticks/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t
-            //if the number of ticks falls below a 16bit value, use it, otherwise set to max 16bit value
-            if(opentimers_vars.timersBuf[id].wraps_remaining==0)                                                
-               opentimers_vars.timersBuf[id].ticks_remaining   = opentimers_vars.timersBuf[id].period_ticks;
-            else
-               opentimers_vars.timersBuf[id].ticks_remaining = MAX_TICKS_IN_SINGLE_CLOCK;
-
-         } else {
-            opentimers_vars.timersBuf[id].isrunning   = FALSE;
-         }
-      }
+   return numExpired;
+}
 
-   }
+/**
+\brief Take the timer at the top of the heap, if it is due.
 
-   // step 3. find the minimum remaining timeout among running timers
-   found = FALSE;
-   for(id=0;id<MAX_NUM_TIMERS;id++) {
-      if (
-            opentimers_vars.timersBuf[id].isrunning==TRUE &&
-            (
-                  found==FALSE
-                  ||
-                  opentimers_vars.timersBuf[id].ticks_remaining < min_timeout
-            )
+A periodic timer is re-inserted for its next period, a one-shot one released.
+
+\param now           The current opentimers time.
+\param[out] callback The function to call for it, read before its id can be
+   handed out again.
+
+\returns The id of the timer, TOO_MANY_TIMERS_ERROR if none is due.
+ */
+opentimer_id_t opentimers_popDue(uint32_t now, opentimers_cbt* callback) {
+   opentimer_id_t id;
+
+   if (
+         opentimers_vars.numRunning==0 ||
+         (int32_t)(opentimers_vars.timersBuf[opentimers_vars.heap[0]].deadline-now)>0
       ) {
-         min_timeout    = opentimers_vars.timersBuf[id].ticks_remaining;
-         found          = TRUE;
-      }
+      return TOO_MANY_TIMERS_ERROR;
    }
+   id        = opentimers_vars.heap[0];
+   *callback = opentimers_vars.timersBuf[id].callback;
 
-   // step 4. schedule next timeout
-   if (found==TRUE) {
-      // at least one timer pending
-      opentimers_vars.currentTimeout = min_timeout;
-      bsp_timer_scheduleIn(opentimers_vars.currentTimeout);
+   // reload the timer, if applicable
+   if (opentimers_vars.timersBuf[id].type==TIMER_PERIODIC) {
+      opentimers_vars.timersBuf[id].deadline  += opentimers_vars.timersBuf[id].period_ticks;
+      opentimers_heapSiftDown(0);
    } else {
+      opentimers_heapRemove(id);
+      opentimers_vars.timersBuf[id].isrunning  = FALSE;
+      opentimers_vars.freeIds[opentimers_vars.numFree++] = id;
+   }
+
+   return id;
+}
+
+/**
+\brief Arm the hardware timer for the next timer to expire.
+
+The hardware timer is chained from its previous compare value, so no time is
+lost between consecutive timeouts.
+ */
+void opentimers_schedule() {
+   uint32_t timeout;
+
+   if (opentimers_vars.numRunning==0) {
       // no more timers pending
       opentimers_vars.running = FALSE;
+      return;
    }
+
+   // at least one timer pending, wake up at the latest time it may expire
+   timeout = opentimers_vars.timersBuf[opentimers_vars.heap[0]].deadline+
+             opentimers_vars.timersBuf[opentimers_vars.heap[0]].slack_ticks-
+             opentimers_vars.lastCompareTime;
+   if ((int32_t)timeout<=0) {
+      // already late, expire as soon as possible
+      timeout = 1;
+   } else if (timeout>MAX_TICKS_IN_SINGLE_CLOCK) {
+      // the hardware timer can't count that far, wake up on the way
+      timeout = MAX_TICKS_IN_SINGLE_CLOCK;
+   }
+   opentimers_vars.currentTimeout = (PORT_TIMER_WIDTH)timeout;
+   opentimers_vars.running        = TRUE;
+   bsp_timer_scheduleIn(opentimers_vars.currentTimeout);
 }
 
-void opentimers_sleepTimeCompesation(uint16_t sleepTime)
-{
-   opentimer_id_t   id;
-   PORT_TIMER_WIDTH min_timeout;
-   bool             found;
-   
-   //step 1. reCount the ticks_remain after waking up from sleep
-   for(id=0; id<MAX_NUM_TIMERS; id++)
-   {
-     if (opentimers_vars.timersBuf[id].isrunning==TRUE) 
-     {
-       if(opentimers_vars.timersBuf[id].ticks_remaining > sleepTime)
-       {
-         opentimers_vars.timersBuf[id].ticks_remaining -= sleepTime;
-       }
-       else
-       {
-         if(opentimers_vars.timersBuf[id].wraps_remaining > 0)
-         {
-           opentimers_vars.timersBuf[id].wraps_remaining--;
-           opentimers_vars.timersBuf[id].ticks_remaining += (MAX_TICKS_IN_SINGLE_CLOCK - sleepTime);
-         }
-         else
-         {
-           opentimers_vars.timersBuf[id].hasExpired  = TRUE;
-         }
-       }
-     }
+/**
+\brief Re-arm the hardware timer from the current time.
+
+Called when the earliest timer changes outside of opentimers_expire(). There
+is nothing to do while expired timers are being processed, as the hardware
+timer is armed right after.
+ */
+void opentimers_rearm() {
+
+   if (opentimers_vars.isExpiring==TRUE) {
+      return;
    }
-   
-   // step 2. call callbacks of expired timers
-   for(id=0; id<MAX_NUM_TIMERS; id++) {
-      if (opentimers_vars.timersBuf[id].hasExpired==TRUE){
-
-         // call the callback
-         opentimers_vars.timersBuf[id].callback(id);
-         opentimers_vars.timersBuf[id].hasExpired     = FALSE;
-
-         // reload the timer, if applicable
-         if (opentimers_vars.timersBuf[id].type==TIMER_PERIODIC) {
-            opentimers_vars.timersBuf[id].wraps_remaining   = (opentimers_vars.timersBuf[id].period_ticks/MAX_TICKS_IN_SINGLE_CLOCK);//65535=maxValue of uint16_t
-            //if the number of ticks falls below a 16bit value, use it, otherwise set to max 16bit value
-            if(opentimers_vars.timersBuf[id].wraps_remaining==0)                                                
-               opentimers_vars.timersBuf[id].ticks_remaining   = opentimers_vars.timersBuf[id].period_ticks;
-            else
-               opentimers_vars.timersBuf[id].ticks_remaining = MAX_TICKS_IN_SINGLE_CLOCK;
-
-         } else {
-            opentimers_vars.timersBuf[id].isrunning   = FALSE;
-         }
-      }
 
+   opentimers_vars.lastCompareTime  = opentimers_getTime();
+   if (opentimers_vars.running==TRUE) {
+      bsp_timer_cancel_schedule();
+   }
+   bsp_timer_reset();
+   opentimers_vars.lastCompareValue = bsp_timer_get_currentValue();
+
+   opentimers_schedule();
+}
+
+//=== heap
+
+bool opentimers_isEarlier(opentimer_id_t a, opentimer_id_t b) {
+   return (int32_t)(
+      (opentimers_vars.timersBuf[a].deadline+opentimers_vars.timersBuf[a].slack_ticks)-
+      (opentimers_vars.timersBuf[b].deadline+opentimers_vars.timersBuf[b].slack_ticks)
+   )<0;
+}
+
+void opentimers_heapSwap(uint8_t i, uint8_t j) {
+   opentimer_id_t id;
+
+   id                                = opentimers_vars.heap[i];
+   opentimers_vars.heap[i]           = opentimers_vars.heap[j];
+   opentimers_vars.heap[j]           = id;
+   opentimers_vars.timersBuf[opentimers_vars.heap[i]].heapIndex = i;
+   opentimers_vars.timersBuf[opentimers_vars.heap[j]].heapIndex = j;
+}
+
+void opentimers_heapSiftUp(uint8_t pos) {
+   uint8_t parent;
+
+   while (pos>0) {
+      parent = (pos-1)/2;
+      if (opentimers_isEarlier(opentimers_vars.heap[pos],opentimers_vars.heap[parent])==FALSE) {
+         break;
+      }
+      opentimers_heapSwap(pos,parent);
+      pos = parent;
    }
-   
-   // step 3. find the minimum remaining timeout among running timers
-   found = FALSE;
-   for(id=0;id<MAX_NUM_TIMERS;id++) {
+}
+
+void opentimers_heapSiftDown(uint8_t pos) {
+   uint8_t child;
+
+   while (2*pos+1<opentimers_vars.numRunning) {
+      // pick the earliest child
+      child = 2*pos+1;
       if (
-            opentimers_vars.timersBuf[id].isrunning==TRUE &&
-            (
-                  found==FALSE
-                  ||
-                  opentimers_vars.timersBuf[id].ticks_remaining < min_timeout
-            )
-      ) {
-         min_timeout    = opentimers_vars.timersBuf[id].ticks_remaining;
-         found          = TRUE;
+            child+1<opentimers_vars.numRunning &&
+            opentimers_isEarlier(opentimers_vars.heap[child+1],opentimers_vars.heap[child])
+         ) {
+         child++;
+      }
+      if (opentimers_isEarlier(opentimers_vars.heap[child],opentimers_vars.heap[pos])==FALSE) {
+         break;
       }
+      opentimers_heapSwap(pos,child);
+      pos = child;
    }
+}
 
-   // step 4. schedule next timeout
-   if (found==TRUE) {
-      // at least one timer pending
-      opentimers_vars.currentTimeout = min_timeout;
-      bsp_timer_scheduleIn(opentimers_vars.currentTimeout);
-   } else {
-      // no more timers pending
-      opentimers_vars.running = FALSE;
+void opentimers_heapInsert(opentimer_id_t id) {
+   uint8_t pos;
+
+   pos                                    = opentimers_vars.numRunning++;
+   opentimers_vars.heap[pos]              = id;
+   opentimers_vars.timersBuf[id].heapIndex = pos;
+   opentimers_heapSiftUp(pos);
+}
+
+void opentimers_heapRemove(opentimer_id_t id) {
+   uint8_t        pos;
+   opentimer_id_t moved;
+
+   pos = opentimers_vars.timersBuf[id].heapIndex;
+   opentimers_vars.numRunning--;
+   if (pos!=opentimers_vars.numRunning) {
+      // move the last entry into the hole, and restore the heap property
+      moved                               = opentimers_vars.heap[opentimers_vars.numRunning];
+      opentimers_vars.heap[pos]           = moved;
+      opentimers_vars.timersBuf[moved].heapIndex = pos;
+      opentimers_heapSiftUp(pos);
+      opentimers_heapSiftDown(opentimers_vars.timersBuf[moved].heapIndex);
    }
 }
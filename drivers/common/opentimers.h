@@ -18,8 +18,10 @@
 
 //=========================== define ==========================================
 
-/// Maximum number of timers that can run concurrently
-#define MAX_NUM_TIMERS            5
+/// Maximum number of timers that can run concurrently (at most 254)
+#ifndef MAX_NUM_TIMERS
+#define MAX_NUM_TIMERS            32
+#endif
 
 #define MAX_TICKS_IN_SINGLE_CLOCK ((PORT_TIMER_WIDTH)0xFFFFFFFF)
 
@@ -44,23 +46,51 @@ typedef enum {
 
 typedef struct {
    uint32_t             period_ticks;       // total number of clock ticks
-   PORT_TIMER_WIDTH     ticks_remaining;    // ticks remaining before elapses
-   uint16_t             wraps_remaining;    // the clock register is 16 bit, and can't count beyond 32k...
-                                            // so period_ticks = wraps_remaining*(32k or uint16_t)
+   uint32_t             deadline;           // when the timer elapses, in opentimers time
+   uint32_t             slack_ticks;        // how late the timer may fire, to save a wakeup
    timer_type_t         type;               // periodic or one-shot
    bool                 isrunning;          // is running?
    opentimers_cbt       callback;           // function to call when elapses
-   bool                 hasExpired;         // whether the callback has to be called
+   uint8_t              heapIndex;          // position in the heap, when running
 } opentimers_t;
 
 //=========================== module variables ================================
 
+/**
+Running timers are kept in a binary min-heap ordered by deadline+slack, so the
+latest time the next timer may expire is always at heap[0]. Deadlines are
+expressed in a 32-bit "opentimers time", which follows the free-running
+hardware counter, whether or not the hardware timer is armed.
+*/
 typedef struct {
    opentimers_t         timersBuf[MAX_NUM_TIMERS];
-   bool                 running;
-   PORT_TIMER_WIDTH     currentTimeout; // current timeout, in ticks
+   opentimer_id_t       heap[MAX_NUM_TIMERS];     // ids of the running timers
+   uint8_t              numRunning;               // number of entries in heap
+   opentimer_id_t       freeIds[MAX_NUM_TIMERS];  // ids which can be allocated
+   uint8_t              numFree;                  // number of entries in freeIds
+   bool                 running;                  // is the hardware timer armed?
+   bool                 isExpiring;               // are expired timers being processed?
+   bool                 coalescePending;          // is opentimers_task_coalesce() posted?
+   PORT_TIMER_WIDTH     currentTimeout;           // current timeout, in ticks
+   uint32_t             lastCompareTime;          // opentimers time when the hardware timer was last armed from
+   PORT_TIMER_WIDTH     lastCompareValue;         // value of the hardware counter at that time
 } opentimers_vars_t;
 
+typedef struct {
+   uint32_t             numHwWakeups;             // number of times the hardware timer elapsed
+   uint32_t             numCoalesced;             // number of expirations served on a slot boundary
+   uint32_t             numWakeupsSaved;          // number of hardware timer wakeups avoided
+} opentimers_dbg_t;
+
+BEGIN_PACK
+typedef struct {
+   uint8_t              numRunning;
+   uint32_t             numHwWakeups;
+   uint32_t             numCoalesced;
+   uint32_t             numWakeupsSaved;
+} debugOpentimersEntry_t;
+END_PACK
+
 //=========================== prototypes ======================================
 
 void           opentimers_init(void);
@@ -71,6 +101,12 @@ opentimer_id_t opentimers_start(uint32_t       duration,
 void           opentimers_setPeriod(opentimer_id_t id,time_type_t timetype, uint32_t       newPeriod);
 void           opentimers_stop(opentimer_id_t id);
 void           opentimers_restart(opentimer_id_t id);
+void           opentimers_setSlack(opentimer_id_t id,time_type_t timetype, uint32_t       slack);
+bool           opentimers_newSlot(void);
+void           opentimers_task_coalesce(void);
+uint32_t       opentimers_getTimeToNextEvent(void);
+uint32_t       opentimers_getValue(void);
+void           opentimers_getStats(debugOpentimersEntry_t* stats);
 
 void           opentimers_sleepTimeCompesation(uint16_t sleepTime);
 
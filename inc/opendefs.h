@@ -107,7 +107,12 @@ enum {
    STATUS_ASN                          =  3,
    STATUS_MACSTATS                     =  4,
    STATUS_NEIGHBORS                    =  5,
-   STATUS_MAX                          =  6,
+   STATUS_TASKS                        =  6,
+   STATUS_TIMERS                       =  7,
+   STATUS_SLEEP                        =  8,
+   STATUS_OUTBUFFER                    =  9,
+   STATUS_ERRORS                       = 10,
+   STATUS_MAX                          = 11,
 };
 
 //component identifiers
@@ -246,6 +251,12 @@ enum {
    ERR_UINJECT_SND                     = 0x3d, // uinject snd pkt to {0}, counter {1}
    ERR_UINJECT_RCV                     = 0x3e, // uinject rcv pkt from {0}, delay {1}
    ERR_UINJECT_FWD                     = 0x3f, // uinject fwd pkt from {0} to {1}
+   // openqueue
+   ERR_TRANSFER_UNUSED                 = 0x40, // transferring ownership of unused memory to component {0}
+   // uinject aggregation
+   ERR_UINJECT_AGG                     = 0x41, // uinject fwd {0} aggregated records to {1}
+   // scheduler
+   ERR_TASK_DROPPED                    = 0x42, // task dropped, FIFO of priority {0} full (STATUS_TASKS row {1})
    
 };
 
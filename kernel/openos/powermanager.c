@@ -0,0 +1,182 @@
+/**
+\brief OpenOS power manager.
+
+Called by the scheduler when there is no task left to run. It looks at when
+the next event is due (opentimers and radiotimer interrupts), and whether the
+serial port is in use, and picks the deepest sleep level the board supports
+for that interval. Time spent at each level is counted, and openserial reports
+it.
+
+Levels below SLEEP_IDLE are only used when compiled with DEEPSLEEP, as UART
+reception is not possible in those levels.
+*/
+
+#include "opendefs.h"
+#include "powermanager.h"
+#include "scheduler.h"
+#include "board.h"
+#include "radiotimer.h"
+#include "opentimers.h"
+
+//=========================== variables =======================================
+
+powermanager_vars_t powermanager_vars;
+
+extern scheduler_vars_t scheduler_vars;
+
+//=========================== prototypes ======================================
+
+sleep_level_t powermanager_pickLevel(void);
+void          powermanager_wakeup_cb(opentimer_id_t id);
+
+//=========================== public ==========================================
+
+void powermanager_init() {
+
+   // initialization module variables
+   memset(&powermanager_vars,0,sizeof(powermanager_vars_t));
+   powermanager_vars.wakeupTimerId = TOO_MANY_TIMERS_ERROR;
+}
+
+/**
+\brief Put the board to sleep until the next interrupt.
+
+\pre There is no task to run.
+*/
+void powermanager_sleep() {
+   INTERRUPT_DECLARATION();
+
+   powermanager_vars.sleepStart = opentimers_getValue();
+
+#ifdef DEEPSLEEP
+   powermanager_vars.sleepLevel = powermanager_pickLevel();
+#else
+   powermanager_vars.sleepLevel = SLEEP_IDLE;
+#endif
+
+   if (powermanager_vars.sleepLevel==SLEEP_IDLE) {
+      board_sleep();
+   } else {
+      DISABLE_INTERRUPTS();
+      if (scheduler_vars.readyMask==0) {
+         // returns with interrupts disabled, pending ones are served below
+         board_sleepAtLevel(powermanager_vars.sleepLevel);
+      } else {
+         // a task was posted in the meantime
+         powermanager_vars.sleepLevel = SLEEP_IDLE;
+      }
+      ENABLE_INTERRUPTS();
+   }
+
+   powermanager_wakeup();
+}
+
+/**
+\brief Account for the sleep which just ended.
+
+The sleep in progress is kept in powermanager_vars rather than on the stack,
+so the simulation can end it when it resumes a mote restored asleep.
+*/
+void powermanager_wakeup() {
+   sleep_level_t level;
+
+   level = powermanager_vars.sleepLevel;
+
+   // the wake-up timer isn't needed anymore
+   if (powermanager_vars.wakeupTimerId!=TOO_MANY_TIMERS_ERROR) {
+      opentimers_stop(powermanager_vars.wakeupTimerId);
+      powermanager_vars.wakeupTimerId = TOO_MANY_TIMERS_ERROR;
+   }
+
+   // time spent at that level, also counted with no opentimer armed, as on a DAG root
+   powermanager_vars.ticksAtLevel[level] += opentimers_getValue()-powermanager_vars.sleepStart;
+   powermanager_vars.numSleeps[level]++;
+}
+
+/**
+\brief Tell the power manager whether the UART is in use.
+
+\param cb Returns FALSE while the UART needs the high-speed clock.
+*/
+void powermanager_setUartIdleCb(powermanager_idle_cbt cb) {
+   powermanager_vars.uartIdleCb = cb;
+}
+
+/**
+\brief Read the time spent at each sleep level.
+
+\param[out] stats Where to write it.
+*/
+void powermanager_getStats(debugSleepEntry_t* stats) {
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   memcpy(stats->ticksAtLevel,powermanager_vars.ticksAtLevel,sizeof(stats->ticksAtLevel));
+   memcpy(stats->numSleeps,powermanager_vars.numSleeps,sizeof(stats->numSleeps));
+   ENABLE_INTERRUPTS();
+}
+
+//=========================== private =========================================
+
+/**
+\brief Pick the deepest sleep level which is safe right now.
+
+If that level is below SLEEP_IDLE, the radiotimer no longer wakes up the board,
+so a one-shot opentimer is started to do so, if the radiotimer fires first.
+
+\returns The sleep level to use.
+*/
+sleep_level_t powermanager_pickLevel() {
+   uint32_t              timeToOpentimers;
+   PORT_RADIOTIMER_WIDTH timeToRadiotimer;
+   uint32_t              timeToNextEvent;
+   sleep_level_t         level;
+
+   // the UART needs the high-speed clock
+   if (powermanager_vars.uartIdleCb!=NULL && powermanager_vars.uartIdleCb()==FALSE) {
+      return SLEEP_IDLE;
+   }
+
+   // when is the next event due?
+   timeToOpentimers = opentimers_getTimeToNextEvent();
+   timeToRadiotimer = radiotimer_getIdleTime();
+   if (timeToRadiotimer<=SLEEP_GUARD_TICKS) {
+      // in the middle of a slot, or about to start one
+      return SLEEP_IDLE;
+   }
+   timeToNextEvent  = timeToOpentimers;
+   if (timeToRadiotimer<timeToNextEvent) {
+      timeToNextEvent = timeToRadiotimer;
+   }
+
+   // deepest level which can be left in time
+   if        (timeToNextEvent>=SLEEP_DEEP_MIN_TICKS) {
+      level = SLEEP_DEEP;
+   } else if (timeToNextEvent>=SLEEP_LIGHT_MIN_TICKS) {
+      level = SLEEP_LIGHT;
+   } else {
+      return SLEEP_IDLE;
+   }
+
+   // have opentimers wake us up in time for the radiotimer
+   if (timeToRadiotimer<=timeToOpentimers) {
+      powermanager_vars.wakeupTimerId = opentimers_start(
+         timeToRadiotimer-SLEEP_GUARD_TICKS,
+         TIMER_ONESHOT,
+         TIME_TICS,
+         powermanager_wakeup_cb
+      );
+      if (powermanager_vars.wakeupTimerId==TOO_MANY_TIMERS_ERROR) {
+         return SLEEP_IDLE;
+      }
+   }
+
+   return level;
+}
+
+/**
+\note Only there to wake up the board ahead of a radiotimer event.
+*/
+void powermanager_wakeup_cb(opentimer_id_t id) {
+   powermanager_vars.wakeupTimerId = TOO_MANY_TIMERS_ERROR;
+}
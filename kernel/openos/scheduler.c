@@ -1,6 +1,9 @@
 /**
 \brief OpenOS scheduler.
 
+Pending tasks are kept in one FIFO per priority. A bitmap indicates which
+FIFOs are non-empty, so pushing and popping a task both take constant time.
+
 \author Thomas Watteyne <watteyne@eecs.berkeley.edu>, February 2012.
 */
 
@@ -9,97 +12,313 @@
 #include "board.h"
 #include "debugpins.h"
 #include "leds.h"
+#include "opentimers.h"
+#include "powermanager.h"
 
 //=========================== variables =======================================
 
 scheduler_vars_t scheduler_vars;
 scheduler_dbg_t  scheduler_dbg;
 
+// index of the lowest bit set in a nibble
+static const uint8_t scheduler_lowestBit[16] = {
+   0,0,1,0,2,0,1,0,3,0,1,0,2,0,1,0
+};
+
 //=========================== prototypes ======================================
 
-void consumeTask(uint8_t taskId);
+task_cbt scheduler_pop_task(PORT_TIMER_WIDTH* pushTime);
+#ifdef TASK_PROFILING
+void     scheduler_profile(task_cbt cb, PORT_TIMER_WIDTH latency, PORT_TIMER_WIDTH exec);
+#endif
 
 //=========================== public ==========================================
 
-void scheduler_init() {   
-   
+void scheduler_init() {
+
    // initialization module variables
    memset(&scheduler_vars,0,sizeof(scheduler_vars_t));
    memset(&scheduler_dbg,0,sizeof(scheduler_dbg_t));
-   
+
+   powermanager_init();
+
    // enable the scheduler's interrupt so SW can wake up the scheduler
    SCHEDULER_ENABLE_INTERRUPT();
 }
 
 void scheduler_start() {
-   taskList_item_t* pThisTask;
+   task_cbt         cb;
+   PORT_TIMER_WIDTH pushTime;
+#ifdef TASK_PROFILING
+   PORT_TIMER_WIDTH startTime;
+#endif
+   INTERRUPT_DECLARATION();
+
    while (1) {
-      while(scheduler_vars.task_list!=NULL) {
-         // there is still at least one task in the linked-list of tasks
-         
-         // the task to execute is the one at the head of the queue
-         pThisTask                = scheduler_vars.task_list;
-         
-         // shift the queue by one task
-         scheduler_vars.task_list = pThisTask->next;
-         
-         // execute the current task
-         pThisTask->cb();
-         
-         // free up this task container
-         pThisTask->cb            = NULL;
-         pThisTask->prio          = TASKPRIO_NONE;
-         pThisTask->next          = NULL;
-         scheduler_dbg.numTasksCur--;
+      while(scheduler_vars.readyMask!=0) {
+         // there is still at least one pending task
+
+         // take the oldest task of the highest priority
+         DISABLE_INTERRUPTS();
+         cb = scheduler_pop_task(&pushTime);
+         ENABLE_INTERRUPTS();
+
+         // execute it, timed with opentimers time, which bsp_timer resets don't affect
+#ifdef TASK_PROFILING
+         startTime = (PORT_TIMER_WIDTH)opentimers_getValue();
+         cb();
+         scheduler_profile(
+            cb,
+            (PORT_TIMER_WIDTH)(startTime-pushTime),
+            (PORT_TIMER_WIDTH)(opentimers_getValue()-startTime)
+         );
+#else
+         cb();
+#endif
       }
       debugpins_task_clr();
-      board_sleep();
+      powermanager_sleep();
       debugpins_task_set();                      // IAR should halt here if nothing to do
    }
 }
 
- void scheduler_push_task(task_cbt cb, task_prio_t prio) {
-   taskList_item_t*  taskContainer;
-   taskList_item_t** taskListWalker;
+/**
+\brief Post a task, to be executed from the scheduler loop.
+
+Tasks of a given priority are executed in the order they were pushed. When
+the FIFO of that priority is full, the task is not queued:
+- if the same task is already pending, the push is coalesced with it. Tasks
+  which can be pushed at a high rate must hence process all pending work when
+  they run (see e.g. task_sixtopNotifReceive()).
+- otherwise, the task is dropped, and its work lost. openserial reports the
+  first drop as an error (see scheduler_getFirstDrop()).
+Both cases are counted in scheduler_dbg, and reported in STATUS_TASKS, rather
+than resetting the board.
+*/
+void scheduler_push_task(task_cbt cb, task_prio_t prio) {
+   taskFifo_t* fifo;
+   uint8_t     i;
    INTERRUPT_DECLARATION();
-   
+
    DISABLE_INTERRUPTS();
-   
-   // find an empty task container
-   taskContainer = &scheduler_vars.taskBuf[0];
-   while (taskContainer->cb!=NULL &&
-          taskContainer<=&scheduler_vars.taskBuf[TASK_LIST_DEPTH-1]) {
-      taskContainer++;
-   }
-   if (taskContainer>&scheduler_vars.taskBuf[TASK_LIST_DEPTH-1]) {
-      // task list has overflown. This should never happpen!
-   
-      // we can not print from within the kernel. Instead:
-      // blink the error LED
-      leds_error_blink();
-      // reset the board
-      board_reset();
-   }
-   // fill that task container with this task
-   taskContainer->cb              = cb;
-   taskContainer->prio            = prio;
-   
-   // find position in queue
-   taskListWalker                 = &scheduler_vars.task_list;
-   while (*taskListWalker!=NULL &&
-          (*taskListWalker)->prio < taskContainer->prio) {
-      taskListWalker              = (taskList_item_t**)&((*taskListWalker)->next);
+
+   fifo = &scheduler_vars.fifo[prio];
+
+   if (fifo->count==TASK_FIFO_DEPTH) {
+      // FIFO of that priority is full
+      for (i=0;i<TASK_FIFO_DEPTH;i++) {
+         if (fifo->cb[i]==cb) {
+            scheduler_dbg.numTasksCoalesced++;
+            ENABLE_INTERRUPTS();
+            return;
+         }
+      }
+      if (scheduler_dbg.firstDroppedCb==NULL) {
+         scheduler_dbg.firstDroppedCb   = cb;
+         scheduler_dbg.firstDroppedPrio = prio;
+      }
+      scheduler_dbg.numTasksDropped++;
+      ENABLE_INTERRUPTS();
+      return;
    }
-   // insert at that position
-   taskContainer->next            = *taskListWalker;
-   *taskListWalker                = taskContainer;
+
+   // append at the tail of the FIFO
+   fifo->cb[(fifo->head+fifo->count)&(TASK_FIFO_DEPTH-1)] = cb;
+#ifdef TASK_PROFILING
+   fifo->pushTime[(fifo->head+fifo->count)&(TASK_FIFO_DEPTH-1)] = (PORT_TIMER_WIDTH)opentimers_getValue();
+#endif
+   fifo->count++;
+   scheduler_vars.readyMask      |= (1<<prio);
+
    // maintain debug stats
    scheduler_dbg.numTasksCur++;
    if (scheduler_dbg.numTasksCur>scheduler_dbg.numTasksMax) {
       scheduler_dbg.numTasksMax   = scheduler_dbg.numTasksCur;
    }
-   
+
+   ENABLE_INTERRUPTS();
+}
+
+/**
+\brief Read the statistics of the scheduler.
+
+With task profiling, each call also gives those of the next profiled callback.
+Without, row is TASK_PROFILE_ROW_NONE.
+
+\param[out] stats Where to write them.
+*/
+void scheduler_getStats(debugTaskProfileEntry_t* stats) {
+#ifdef TASK_PROFILING
+   taskProfile_t*          p;
+   uint8_t                 i;
+#endif
+   INTERRUPT_DECLARATION();
+
+   memset(stats,0,sizeof(debugTaskProfileEntry_t));
+   stats->row           = TASK_PROFILE_ROW_NONE;
+
+   DISABLE_INTERRUPTS();
+#ifdef TASK_PROFILING
+   // find the next profiled callback, if any
+   for (i=0;i<TASK_PROFILE_NUM_CB;i++) {
+      scheduler_vars.debugRow = (scheduler_vars.debugRow+1)%TASK_PROFILE_NUM_CB;
+      p = &scheduler_vars.profile[scheduler_vars.debugRow];
+      if (p->cb!=NULL) {
+         stats->row     = scheduler_vars.debugRow;
+         stats->cb      = (uint32_t)(uintptr_t)p->cb;
+         stats->numRuns = p->numRuns;
+         stats->execMin = (uint16_t)p->execMin;
+         stats->execAvg = (uint16_t)(p->execSum/p->numRuns);
+         stats->execMax = (uint16_t)p->execMax;
+         stats->latMin  = (uint16_t)p->latMin;
+         stats->latAvg  = (uint16_t)(p->latSum/p->numRuns);
+         stats->latMax  = (uint16_t)p->latMax;
+         break;
+      }
+   }
+#endif
+   stats->numTasksCur       = scheduler_dbg.numTasksCur;
+   stats->numTasksMax       = scheduler_dbg.numTasksMax;
+   stats->numTasksCoalesced = scheduler_dbg.numTasksCoalesced;
+   stats->numTasksDropped   = scheduler_dbg.numTasksDropped;
    ENABLE_INTERRUPTS();
 }
 
+/**
+\brief The first task dropped since boot, if any.
+
+The callback address doesn't fit an error parameter on every board, the row
+of its STATUS_TASKS entry identifies it instead.
+
+\param[out] prio Its priority.
+\param[out] row  Row of its callback in STATUS_TASKS, TASK_PROFILE_ROW_NONE if
+   it isn't profiled.
+
+\returns TRUE if a task was dropped, FALSE otherwise.
+*/
+bool scheduler_getFirstDrop(uint8_t* prio, uint8_t* row) {
+   bool    returnVal;
+#ifdef TASK_PROFILING
+   uint8_t i;
+#endif
+   INTERRUPT_DECLARATION();
+
+   DISABLE_INTERRUPTS();
+   returnVal = (scheduler_dbg.firstDroppedCb!=NULL);
+   *prio     = scheduler_dbg.firstDroppedPrio;
+   *row      = TASK_PROFILE_ROW_NONE;
+#ifdef TASK_PROFILING
+   for (i=0;i<TASK_PROFILE_NUM_CB && returnVal==TRUE;i++) {
+      if (scheduler_vars.profile[i].cb==scheduler_dbg.firstDroppedCb) {
+         *row = i;
+         break;
+      }
+   }
+#endif
+   ENABLE_INTERRUPTS();
+
+   return returnVal;
+}
+
 //=========================== private =========================================
+
+/**
+\brief Remove the next task to execute.
+
+\pre Interrupts are disabled, and at least one task is pending.
+
+\param[out] pushTime When the task was pushed (only with task profiling).
+
+\returns The oldest task of the highest priority (i.e. lowest task_prio_t).
+*/
+task_cbt scheduler_pop_task(PORT_TIMER_WIDTH* pushTime) {
+   uint16_t    mask;
+   uint8_t     prio;
+   taskFifo_t* fifo;
+   task_cbt    cb;
+
+   // find the highest priority with a pending task
+   mask = scheduler_vars.readyMask;
+   prio = 0;
+   if ((mask&0x00ff)==0) {
+      mask >>= 8;
+      prio  += 8;
+   }
+   if ((mask&0x0f)==0) {
+      mask >>= 4;
+      prio  += 4;
+   }
+   prio += scheduler_lowestBit[mask&0x0f];
+
+   // take the task at the head of its FIFO
+   fifo       = &scheduler_vars.fifo[prio];
+   cb         = fifo->cb[fifo->head];
+#ifdef TASK_PROFILING
+   *pushTime  = fifo->pushTime[fifo->head];
+#endif
+   fifo->cb[fifo->head] = NULL;
+   fifo->head = (fifo->head+1)&(TASK_FIFO_DEPTH-1);
+   fifo->count--;
+   if (fifo->count==0) {
+      scheduler_vars.readyMask &= ~(1<<prio);
+   }
+
+   scheduler_dbg.numTasksCur--;
+
+   return cb;
+}
+
+#ifdef TASK_PROFILING
+/**
+\brief Account for one execution of a task.
+
+Statistics are kept per callback, for the first TASK_PROFILE_NUM_CB distinct
+callbacks executed. They are reset when the number of runs wraps around.
+*/
+void scheduler_profile(task_cbt cb, PORT_TIMER_WIDTH latency, PORT_TIMER_WIDTH exec) {
+   taskProfile_t* p;
+   uint8_t        i;
+   INTERRUPT_DECLARATION();
+
+   // find the entry of that callback, or a free one
+   p = NULL;
+   for (i=0;i<TASK_PROFILE_NUM_CB;i++) {
+      if (scheduler_vars.profile[i].cb==cb || scheduler_vars.profile[i].cb==NULL) {
+         p = &scheduler_vars.profile[i];
+         break;
+      }
+   }
+   if (p==NULL) {
+      // table full
+      return;
+   }
+
+   DISABLE_INTERRUPTS();
+   if (p->cb==NULL || p->numRuns==0xffff) {
+      p->cb        = cb;
+      p->numRuns   = 0;
+      p->execMin   = exec;
+      p->execMax   = exec;
+      p->execSum   = 0;
+      p->latMin    = latency;
+      p->latMax    = latency;
+      p->latSum    = 0;
+   }
+   p->numRuns++;
+   if (exec<p->execMin) {
+      p->execMin   = exec;
+   }
+   if (exec>p->execMax) {
+      p->execMax   = exec;
+   }
+   p->execSum     += exec;
+   if (latency<p->latMin) {
+      p->latMin    = latency;
+   }
+   if (latency>p->latMax) {
+      p->latMax    = latency;
+   }
+   p->latSum      += latency;
+   ENABLE_INTERRUPTS();
+}
+#endif
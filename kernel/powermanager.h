@@ -0,0 +1,78 @@
+#ifndef __POWERMANAGER_H
+#define __POWERMANAGER_H
+
+/**
+\addtogroup kernel
+\{
+\addtogroup PowerManager
+\{
+*/
+
+#include "opendefs.h"
+#include "board.h"
+#include "opentimers.h"
+
+//=========================== define ==========================================
+
+/**
+\brief Minimum time to the next event for a sleep level to be used, in 32kHz
+   ticks.
+
+Boards supporting a level below SLEEP_IDLE define the corresponding
+PORT_SLEEP_*_MIN_TICKS in their board_info.h, covering the time it takes to
+enter and leave that level. Levels a board does not define are never used.
+*/
+#ifdef PORT_SLEEP_LIGHT_MIN_TICKS
+#define SLEEP_LIGHT_MIN_TICKS     PORT_SLEEP_LIGHT_MIN_TICKS
+#else
+#define SLEEP_LIGHT_MIN_TICKS     0xffffffff
+#endif
+#ifdef PORT_SLEEP_DEEP_MIN_TICKS
+#define SLEEP_DEEP_MIN_TICKS      PORT_SLEEP_DEEP_MIN_TICKS
+#else
+#define SLEEP_DEEP_MIN_TICKS      0xffffffff
+#endif
+
+/// how early to wake up before the next radiotimer event, in 32kHz ticks
+#ifdef PORT_SLEEP_GUARD_TICKS
+#define SLEEP_GUARD_TICKS         PORT_SLEEP_GUARD_TICKS
+#else
+#define SLEEP_GUARD_TICKS         2
+#endif
+
+//=========================== typedef =========================================
+
+typedef bool (*powermanager_idle_cbt)(void);
+
+BEGIN_PACK
+typedef struct {
+   uint32_t             ticksAtLevel[SLEEP_LEVEL_MAX];
+   uint16_t             numSleeps[SLEEP_LEVEL_MAX];
+} debugSleepEntry_t;
+END_PACK
+
+//=========================== module variables ================================
+
+typedef struct {
+   uint32_t             ticksAtLevel[SLEEP_LEVEL_MAX];  // time spent at each level, in 32kHz ticks
+   uint16_t             numSleeps[SLEEP_LEVEL_MAX];     // number of times each level was entered
+   opentimer_id_t       wakeupTimerId;                  // wakes us up for the radiotimer
+   sleep_level_t        sleepLevel;                     // of the sleep in progress
+   uint32_t             sleepStart;                     // opentimers time when it started, runs with no timer armed
+   powermanager_idle_cbt uartIdleCb;                    // is the UART idle? NULL if none registered
+} powermanager_vars_t;
+
+//=========================== prototypes ======================================
+
+void powermanager_init(void);
+void powermanager_sleep(void);
+void powermanager_wakeup(void);
+void powermanager_setUartIdleCb(powermanager_idle_cbt cb);
+void powermanager_getStats(debugSleepEntry_t* stats);
+
+/**
+\}
+\}
+*/
+
+#endif
@@ -28,33 +28,91 @@ typedef enum {
    TASKPRIO_BUTTON                = 0x09,
    TASKPRIO_SIXTOP_TIMEOUT        = 0x0a,
    TASKPRIO_SNIFFER               = 0x0b,
-   TASKPRIO_MAX                   = 0x0c,
+   // drivers
+   TASKPRIO_OPENTIMERS            = 0x0c,
+   TASKPRIO_MAX                   = 0x0d,
 } task_prio_t;
 
-#define TASK_LIST_DEPTH           10
+/**
+\brief Maximum number of pending tasks per priority.
+
+\warning should be a power of 2 so wrap-around on the FIFO index does not
+         require the use of a slow modulo operator.
+*/
+#define TASK_FIFO_DEPTH           4
+
+#ifdef TASK_PROFILING
+/// number of distinct task callbacks which are profiled
+#define TASK_PROFILE_NUM_CB       8
+#endif
+
+/// row of a STATUS_TASKS entry which only holds the counters, no profile
+#define TASK_PROFILE_ROW_NONE     0xff
 
 //=========================== typedef =========================================
 
 typedef void (*task_cbt)(void);
 
-typedef struct task_llist_t {
-   task_cbt                       cb;
-   task_prio_t                    prio;
-   void*                          next;
-} taskList_item_t;
+/// FIFO of the pending tasks of a given priority
+typedef struct {
+   task_cbt                       cb[TASK_FIFO_DEPTH];
+#ifdef TASK_PROFILING
+   PORT_TIMER_WIDTH               pushTime[TASK_FIFO_DEPTH]; // when each task was pushed
+#endif
+   uint8_t                        head;          // index of the next task to run
+   uint8_t                        count;         // number of pending tasks
+} taskFifo_t;
 
-//=========================== module variables ================================
+#ifdef TASK_PROFILING
+/// execution statistics of a task callback, in ticks of opentimers time, which also runs with no timer armed
+typedef struct {
+   task_cbt                       cb;
+   uint16_t                       numRuns;
+   PORT_TIMER_WIDTH               execMin;       // execution time
+   PORT_TIMER_WIDTH               execMax;
+   uint32_t                       execSum;
+   PORT_TIMER_WIDTH               latMin;        // time between push and start of execution
+   PORT_TIMER_WIDTH               latMax;
+   uint32_t                       latSum;
+} taskProfile_t;
+#endif
 
+BEGIN_PACK
 typedef struct {
-   taskList_item_t                taskBuf[TASK_LIST_DEPTH];
-   taskList_item_t*               task_list;
+   uint8_t                        row;
+   uint32_t                       cb;            // address of the callback, resolve with the map file
+   uint16_t                       numRuns;
+   uint16_t                       execMin;
+   uint16_t                       execAvg;
+   uint16_t                       execMax;
+   uint16_t                       latMin;
+   uint16_t                       latAvg;
+   uint16_t                       latMax;
    uint8_t                        numTasksCur;
    uint8_t                        numTasksMax;
+   uint16_t                       numTasksCoalesced;
+   uint16_t                       numTasksDropped;
+} debugTaskProfileEntry_t;
+END_PACK
+
+//=========================== module variables ================================
+
+typedef struct {
+   taskFifo_t                     fifo[TASKPRIO_MAX];
+   uint16_t                       readyMask;     // bit i set iff fifo[i] holds at least one task
+#ifdef TASK_PROFILING
+   taskProfile_t                  profile[TASK_PROFILE_NUM_CB];
+   uint8_t                        debugRow;
+#endif
 } scheduler_vars_t;
 
 typedef struct {
    uint8_t                        numTasksCur;
    uint8_t                        numTasksMax;
+   uint16_t                       numTasksCoalesced; // pushed on a full FIFO which already held that task
+   uint16_t                       numTasksDropped;   // pushed on a full FIFO which did not hold that task
+   task_cbt                       firstDroppedCb;    // first task dropped, NULL if none
+   uint8_t                        firstDroppedPrio;
 } scheduler_dbg_t;
 
 //=========================== prototypes ======================================
@@ -62,6 +120,8 @@ typedef struct {
 void scheduler_init(void);
 void scheduler_start(void);
 void scheduler_push_task(task_cbt task_cb, task_prio_t prio);
+void scheduler_getStats(debugTaskProfileEntry_t* stats);
+bool scheduler_getFirstDrop(uint8_t* prio, uint8_t* row);
 
 /**
 \}
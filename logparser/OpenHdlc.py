@@ -139,6 +139,20 @@ class OpenHdlc(object):
         
             return (returnVal,f.tell())
 
+    def dehdlcifyFrame(self,inBuf):
+        '''
+        De-HDLC a single frame, given the bytes between its two flags.
+        
+        \returns The frame, without its CRC, as a list of bytes.
+        \raises ValueError if its CRC is invalid.
+        '''
+        self._inputEscaping = False
+        self._hdlc_inputOpen()
+        for b in inBuf:
+            self._hdlc_inputWrite(b)
+        self._hdlc_inputClose()
+        return [ord(b) for b in self._inputBuf]
+
     #============================ private =====================================
     
     def _crcIteration(self,crc,b):
@@ -110,7 +110,7 @@ errorDescriptions = {
   61: "flooding packet rcv, seq {0}, state {1}",
   62: "flooding packet fw, seq {0}, state {1}",
   63: "light measurement {0}",
-  64: "sink state {0}, delay {1}",
-  65: "flooding packet dropped, seq {0}, state {1}",
-  66: "flooding packet generated, seq {0}, state {1}",
+  64: "transferring ownership of unused memory to component {0}",
+  65: "uinject fwd {0} aggregated records to {1}",
+  66: "task dropped, FIFO of priority {0} full (STATUS_TASKS row {1})",
 }
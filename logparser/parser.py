@@ -18,6 +18,16 @@ class fieldParsingKey(object):
 
 class LogfileParser(object):
     
+    COMPONENT_UINJECT      = 0x24
+    ERR_UINJECT_SND        = 0x3d
+    ERR_UINJECT_RCV        = 0x3e
+    ERR_UINJECT_AGG        = 0x41
+    
+    STATUS_BATCH_VERSION   = 1
+    
+    EVENTLOG_VERSION       = 1
+    EVENTLOG_FLAG_COMPONENT= 0x80
+    
     HDLC_FLAG              = '\x7e'
     HDLC_FLAG_ESCAPED      = '\x5e'
     HDLC_ESCAPE            = '\x7d'
@@ -49,7 +59,7 @@ class LogfileParser(object):
                 errstring = StackDefines.errorDescriptions[d['errcode']]
                 if errstring not in errorcount:
                     errorcount[errstring] = 0
-                errorcount[errstring] += 1
+                errorcount[errstring] += d.get('numRepeats',1)
         with open('question_2.txt','w') as f:
             f.write(str(errorcount))
             
@@ -78,7 +88,33 @@ class LogfileParser(object):
                 output += ['{0}: {1}'.format(k,sorted(v))]
             f.write('\n'.join(output))
         
-        # question 5: network churn
+        # question 5: uinject delivery (aggregated frames are unpacked by the sink, one RCV per record)
+        numSent        = 0
+        rcvPerSource   = {}
+        numAggFrames   = 0
+        numAggRecords  = 0
+        for d in allflatdata:
+            if d.get('severity')!='I' or d.get('component')!=self.COMPONENT_UINJECT:
+                continue
+            if   d['infocode']==self.ERR_UINJECT_SND:
+                numSent += 1
+            elif d['infocode']==self.ERR_UINJECT_RCV:
+                if d['arg1'] not in rcvPerSource:
+                    rcvPerSource[d['arg1']] = []
+                rcvPerSource[d['arg1']] += [d['arg2']]
+            elif d['infocode']==self.ERR_UINJECT_AGG:
+                numAggFrames  += 1
+                numAggRecords += d['arg1']
+        with open('question_5.txt','w') as f:
+            output  = []
+            output += ['sent: {0}'.format(numSent)]
+            output += ['received: {0}'.format(sum([len(v) for v in rcvPerSource.values()]))]
+            output += ['aggregated frames: {0} ({1} records)'.format(numAggFrames,numAggRecords)]
+            for (src,delays) in sorted(rcvPerSource.items()):
+                output += ['{0}: {1} records, avg delay {2:.1f} slots'.format(hex(src),len(delays),float(sum(delays))/len(delays))]
+            f.write('\n'.join(output))
+        
+        # question 6: network churn
         
     def parseAllFiles(self):
         alldata = {}
@@ -100,6 +136,10 @@ class LogfileParser(object):
                 pf = self.parse_DATA(f[1:])
             elif f[0]==ord('S'):
                 pf = self.parse_STATUS(f[1:])
+            elif f[0]==ord('B'):
+                pf = self.parse_STATUS_BATCH(f[1:])
+            elif f[0]==ord('L'):
+                pf = self.parse_EVENTLOG(f[1:])
             elif f[0]==ord('I'):
                 pf = self.parse_INFO(f[1:])
             elif f[0]==ord('E'):
@@ -110,7 +150,9 @@ class LogfileParser(object):
                 pf = self.parse_REQUEST(f[1:])
             else:
                 print 'TODO: parse frame of type {0}'.format(chr(f[0])) 
-            if pf:
+            if isinstance(pf,list):
+                parsedFrames += pf
+            elif pf:
                 parsedFrames += [pf]
         
         with open(filename+'.parsed','w') as f:
@@ -124,12 +166,75 @@ class LogfileParser(object):
         return {}
     def parse_STATUS(self,frame):
         header     = self.parseHeader(frame[:3],'<HB',('src','type'))
+        return self.parse_statusElement(header['type'],frame[3:])
+    def parse_STATUS_BATCH(self,frame):
+        # src (2B), version (1B), then one TLV per status element
+        header     = self.parseHeader(frame[:3],'<HB',('src','version'))
+        if header['version']!=self.STATUS_BATCH_VERSION:
+            print 'WARNING: unsupported status batch version {0}'.format(header['version'])
+            return None
+        payloads   = []
+        idx        = 3
+        while idx+2<=len(frame):
+            (t,l)  = (frame[idx],frame[idx+1])
+            if idx+2+l>len(frame):
+                print 'WARNING: truncated status batch'
+                break
+            payloads += [self.parse_statusElement(t,frame[idx+2:idx+2+l])]
+            idx   += 2+l
+        return payloads
+    
+    def parse_EVENTLOG(self,frame):
+        '''
+        Each record becomes the same dict as an INFO frame, plus the ASN at
+        which the event happened.
+        '''
+        # src (2B), version (1B), lost (2B), base ASN (5B), then the records
+        header     = self.parseHeader(frame[:3],'<HB',('moteID','version'))
+        if header['version']!=self.EVENTLOG_VERSION:
+            print 'WARNING: unsupported event log version {0}'.format(header['version'])
+            return None
+        (numLost,asn0_1,asn2_3,asn4) = struct.unpack('<HHHB',''.join([chr(b) for b in frame[3:10]]))
+        if numLost:
+            print 'WARNING: mote {0} lost {1} event records'.format(hex(header['moteID']),numLost)
+        asn        = (asn4<<32) | (asn2_3<<16) | asn0_1
+        component  = None
+        payloads   = []
+        idx        = 10
+        try:
+            while idx<len(frame):
+                code     = frame[idx]
+                idx     += 1
+                if code & self.EVENTLOG_FLAG_COMPONENT:
+                    code      &= ~self.EVENTLOG_FLAG_COMPONENT
+                    component  = frame[idx]
+                    idx       += 1
+                (delta,idx) = self.parseVarint(frame,idx)
+                (arg1,idx)  = self.parseVarint(frame,idx)
+                (arg2,idx)  = self.parseVarint(frame,idx)
+                asn     += delta
+                payloads += [{
+                    'moteID':    header['moteID'],
+                    'component': component,
+                    'infocode':  code,
+                    'arg1':      arg1,
+                    'arg2':      arg2,
+                    'asn':       asn,
+                    'severity':  'I',
+                }]
+        except IndexError:
+            print 'WARNING: truncated event log'
+        return payloads
+    
+    #======================== level 2 parsers =================================
+    
+    def parse_statusElement(self,type,value):
         payload    = {}
-        if   header['type']==0: # IsSync
-            payload = self.parseHeader(frame[3:],'<B',('isSync',))
-        elif header['type']==1: # IdManager
+        if   type==0: # IsSync
+            payload = self.parseHeader(value,'<B',('isSync',))
+        elif type==1: # IdManager
             payload = self.parseHeader(
-                frame[3:3+5],
+                value[:5],
                 '<BHH',
                 (
                     'isDAGroot',
@@ -137,25 +242,12 @@ class LogfileParser(object):
                     'my16bID',
                 ),
             )
-        elif header['type']==2: # MyDagRank
-            payload = self.parseHeader(frame[3:],'<H',('myDAGrank',))
-        elif header['type']==6: # ScheduleRow
+        elif type==2: # MyDagRank
+            payload = self.parseHeader(value,'<H',('myDAGrank',))
+        elif type==5: # NeighborsRow
             payload = self.parseHeader(
-                frame[3:3+7],
-                '<BHBBBB',
-                (
-                    'row',
-                    'slotOffset',
-                    'channelOffset',
-                    'type',
-                    'numRx',
-                    'numTx',
-                ),
-            )
-        elif header['type']==8: # NeighborsRow
-            payload = self.parseHeader(
-                frame[3:],
-                '<BBBBBHHbBBBBHH',
+                value[:19],
+                '<BBBBBHHbBBBBBHH',
                 (
                     'row',                       # B
                     'used',                      # B
@@ -167,17 +259,89 @@ class LogfileParser(object):
                     'rssi',                      # b
                     'numRx',                     # B
                     'numTx',                     # B
+                    'numTxACK',                  # B
                     'numWraps',                  # B
                     'asn_4',                     # B
                     'asn_2_3',                   # H
                     'asn_0_1',                   # H
                 ),
             )
+        elif type==6: # TaskProfile (times in 32kHz ticks)
+            payload = self.parseHeader(
+                value[:25],
+                '<BIHHHHHHHBBHH',
+                (
+                    'row',                       # B
+                    'cb',                        # I
+                    'numRuns',                   # H
+                    'execMin',                   # H
+                    'execAvg',                   # H
+                    'execMax',                   # H
+                    'latMin',                    # H
+                    'latAvg',                    # H
+                    'latMax',                    # H
+                    'numTasksCur',               # B
+                    'numTasksMax',               # B
+                    'numTasksCoalesced',         # H
+                    'numTasksDropped',           # H
+                ),
+            )
+        elif type==7: # Opentimers
+            payload = self.parseHeader(
+                value[:13],
+                '<BIII',
+                (
+                    'numRunning',                # B
+                    'numHwWakeups',              # I
+                    'numCoalesced',              # I
+                    'numWakeupsSaved',           # I
+                ),
+            )
+        elif type==8: # Sleep (times in 32kHz ticks)
+            payload = self.parseHeader(
+                value[:18],
+                '<IIIHHH',
+                (
+                    'ticksIdle',                 # I
+                    'ticksLight',                # I
+                    'ticksDeep',                 # I
+                    'numIdle',                   # H
+                    'numLight',                  # H
+                    'numDeep',                   # H
+                ),
+            )
+        elif type==9: # OutBuffer (indices wrap at 65536)
+            payload = self.parseHeader(
+                value[:12],
+                '<HHHHI',
+                (
+                    'readIdx',                   # H
+                    'writeIdx',                  # H
+                    'maxFill',                   # H
+                    'numDroppedFrames',          # H
+                    'numDroppedBytes',           # I
+                ),
+            )
+        elif type==10: # Errors (repeats not reported individually)
+            payload = self.parseHeader(
+                value[:8],
+                '<BBHHH',
+                (
+                    'component',                 # B
+                    'errcode',                   # B
+                    'numRepeats',                # H
+                    'arg1',                      # H
+                    'arg2',                      # H
+                ),
+            )
         else:
             pass
         return payload
     def parse_INFO(self,frame):
-        pass
+        payload    = self.parseHeader(frame[:4],'<HBB',('moteID','component','infocode'))
+        payload.update(self.parseHeader(frame[4:8],'>HH',('arg1','arg2')))
+        payload['severity'] = 'I'
+        return payload
     def parse_ERROR(self,frame):
         payload    = self.parseHeader(frame[:8],'<HBBHH',('moteID','component','errcode','arg1','arg2'))
         return payload
@@ -186,10 +350,24 @@ class LogfileParser(object):
     def parse_REQUEST(self,frame):
         pass
     
-    #======================== level 2 parsers =================================
-    
     #======================== helpers =========================================
     
+    def parseVarint(self,bytes,idx):
+        '''
+        Parse an unsigned LEB128 varint.
+        
+        \returns (value, index of the byte following it)
+        '''
+        value      = 0
+        shift      = 0
+        while True:
+            b      = bytes[idx]
+            idx   += 1
+            value |= (b & 0x7f)<<shift
+            shift += 7
+            if not (b & 0x80):
+                return (value,idx)
+    
     def parseHeader(self,bytes,formatString,fieldNames):
         returnVal = {}
         fieldVals = struct.unpack(formatString, ''.join([chr(b) for b in bytes]))
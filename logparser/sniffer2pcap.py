@@ -0,0 +1,165 @@
+#!/usr/bin/python
+'''
+Write the frames streamed by a sniffer mote to a pcap file.
+
+A mote built with goldenImage=sniffer synchronizes to the network on its EBs,
+then listens in every slot on the channel the network hops to. Each frame it
+overhears is sent over serial in a 'P' frame:
+
+    src (2B) | frame, without CRC | rssi | lqi | crc | ASN (5B) | channel
+
+The input is either a log of the serial bytes, or a serial port to capture
+from (until Ctrl-C):
+
+    sniffer2pcap.py COM7 capture.pcap
+    sniffer2pcap.py sniffer.txt capture.pcap --raw
+
+By default, frames are written with the IEEE 802.15.4 TAP link type, which
+carries the channel, RSSI, LQI and ASN of each of them. --raw writes the bare
+frames instead. Frames failing their CRC are dropped, unless --bad-crc is
+given. Timestamps are derived from the ASN, so they reflect the schedule
+rather than the serial latency.
+
+The MAC header of this stack is its own (see l2_ht in sixtop.h), not the
+802.15.4 one: Wireshark lists the frames, but can't decode their header.
+'''
+
+import os
+import sys
+import struct
+import OpenHdlc
+
+SERFRAME_MOTE2PC_SNIFFED_PACKET = ord('P')
+SNIFFED_PACKET_TAIL_LEN         = 1+1+1+5+1
+
+SLOT_DURATION_US                = 15000
+
+LINKTYPE_IEEE802_15_4_NOFCS     = 230
+LINKTYPE_IEEE802_15_4_TAP       = 283
+
+# TLVs of the IEEE 802.15.4 TAP header
+TAP_FCS_TYPE                    = 0
+TAP_RSS                         = 1
+TAP_CHANNEL_ASSIGNMENT          = 3
+TAP_ASN                         = 7
+TAP_LQI                         = 10
+TAP_FCS_TYPE_NONE               = 0
+
+def parseSniffedPacket(frame):
+    '''
+    \\returns A dict with the fields of a 'P' frame (given without its type
+       byte), None if it is too short.
+    '''
+    if len(frame)<2+SNIFFED_PACKET_TAIL_LEN:
+        return None
+    tail = ''.join([chr(b) for b in frame[-SNIFFED_PACKET_TAIL_LEN:]])
+    (rssi,lqi,crc,asn0_1,asn2_3,asn4,channel) = struct.unpack('<bBBHHBB',tail)
+    return {
+        'src':     (frame[1]<<8) | frame[0],
+        'frame':   ''.join([chr(b) for b in frame[2:-SNIFFED_PACKET_TAIL_LEN]]),
+        'rssi':    rssi,
+        'lqi':     lqi,
+        'crc':     crc,
+        'asn':     (asn4<<32) | (asn2_3<<16) | asn0_1,
+        'channel': channel,
+    }
+
+def tapTlv(type,value):
+    # values are padded to a multiple of 4 bytes
+    return struct.pack('<HH',type,len(value))+value+'\x00'*(-len(value)%4)
+
+def tapHeader(pkt):
+    tlvs  = tapTlv(TAP_FCS_TYPE,          struct.pack('<B',TAP_FCS_TYPE_NONE))
+    tlvs += tapTlv(TAP_RSS,               struct.pack('<f',pkt['rssi']))
+    tlvs += tapTlv(TAP_CHANNEL_ASSIGNMENT,struct.pack('<HB',pkt['channel'],0))
+    tlvs += tapTlv(TAP_ASN,               struct.pack('<Q',pkt['asn']))
+    tlvs += tapTlv(TAP_LQI,               struct.pack('<B',pkt['lqi']))
+    return struct.pack('<BBH',0,0,4+len(tlvs))+tlvs
+
+class PcapWriter(object):
+
+    def __init__(self,fileName,raw=False):
+        self.raw  = raw
+        self.f    = open(fileName,'wb')
+        self.f.write(struct.pack('<IHHiIII',
+            0xa1b2c3d4,                          # magic number
+            2,4,                                 # version
+            0,                                   # GMT offset
+            0,                                   # timestamp accuracy
+            0xffff,                              # snapshot length
+            LINKTYPE_IEEE802_15_4_NOFCS if raw else LINKTYPE_IEEE802_15_4_TAP,
+        ))
+
+    def write(self,pkt):
+        if self.raw:
+            data  = pkt['frame']
+        else:
+            data  = tapHeader(pkt)+pkt['frame']
+        us        = pkt['asn']*SLOT_DURATION_US
+        self.f.write(struct.pack('<IIII',us/1000000,us%1000000,len(data),len(data)))
+        self.f.write(data)
+        self.f.flush()
+
+    def close(self):
+        self.f.close()
+
+def readFile(fileName):
+    (hdlcFrames,_) = OpenHdlc.OpenHdlc().dehdlcify(fileName)
+    for f in hdlcFrames:
+        yield f
+
+def readSerial(portName):
+    import serial
+    port   = serial.Serial(portName,'115200')
+    hdlc   = OpenHdlc.OpenHdlc()
+    rxBuf  = None
+    try:
+        while True:
+            b = port.read(1)
+            if b==OpenHdlc.OpenHdlc.HDLC_FLAG:
+                if rxBuf:
+                    try:
+                        yield hdlc.dehdlcifyFrame(rxBuf)
+                    except ValueError:
+                        # invalid HDLC frame
+                        pass
+                rxBuf = ''
+            elif rxBuf is not None:
+                rxBuf += b
+    finally:
+        port.close()
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith('--')]
+    if len(args)!=2:
+        print __doc__
+        return
+
+    if os.path.isfile(args[0]):
+        frames = readFile(args[0])
+    else:
+        frames = readSerial(args[0])
+    writer     = PcapWriter(args[1],raw='--raw' in sys.argv)
+
+    numWritten = 0
+    numBadCrc  = 0
+    try:
+        for f in frames:
+            if not f or f[0]!=SERFRAME_MOTE2PC_SNIFFED_PACKET:
+                continue
+            pkt = parseSniffedPacket(f[1:])
+            if not pkt:
+                continue
+            if not pkt['crc']:
+                numBadCrc += 1
+                if '--bad-crc' not in sys.argv:
+                    continue
+            writer.write(pkt)
+            numWritten += 1
+    except KeyboardInterrupt:
+        pass
+    writer.close()
+    print '{0} frames written, {1} with a bad CRC.'.format(numWritten,numBadCrc)
+
+if __name__=="__main__":
+    main()
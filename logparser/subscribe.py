@@ -0,0 +1,77 @@
+#!/usr/bin/python
+'''
+Set which status elements and events a mote sends over serial, and how often.
+
+The subscription frame is sent when the mote asks for input (a 'R' frame).
+Each entry is 3 bytes:
+- kind:   0 for a status element, 1 for an info/error code
+- id:     the status element (see parser.py) or the info/error code
+- period: status element: sent every that many serial outputs, never if 0
+          info/error code: one out of that many occurrences sent, none if 0
+
+Example, asking for the neighbor table every 4 outputs, dropping the isSync
+element and sending one out of 10 "sent" uinject info messages:
+
+    subscribe.py COM7 s:5:4 s:0:0 e:0x3d:10
+'''
+
+import sys
+import serial
+import OpenHdlc
+
+SERFRAME_PC2MOTE_SUBSCRIBE = ord('U')
+SERFRAME_MOTE2PC_REQUEST   = ord('R')
+
+SUBSCRIBE_STATUS           = 0
+SUBSCRIBE_EVENT            = 1
+
+def subscriptionFrame(statusPeriods={},eventPeriods={}):
+    '''
+    Build the HDLC frame setting the given periods.
+
+    statusPeriods and eventPeriods map a status element, resp. an info/error
+    code, to its period.
+    '''
+    frame  = [SERFRAME_PC2MOTE_SUBSCRIBE]
+    for (id,period) in sorted(statusPeriods.items()):
+        frame += [SUBSCRIBE_STATUS,id,period]
+    for (id,period) in sorted(eventPeriods.items()):
+        frame += [SUBSCRIBE_EVENT,id,period]
+    return OpenHdlc.OpenHdlc().hdlcify(frame)
+
+def parseEntries(args):
+    statusPeriods = {}
+    eventPeriods  = {}
+    for arg in args:
+        (kind,id,period) = arg.split(':')
+        if   kind=='s':
+            statusPeriods[int(id,0)] = int(period,0)
+        elif kind=='e':
+            eventPeriods[int(id,0)]  = int(period,0)
+        else:
+            raise ValueError('unknown kind {0} in {1}'.format(kind,arg))
+    return (statusPeriods,eventPeriods)
+
+def main():
+    if len(sys.argv)<3:
+        print __doc__
+        return
+
+    (statusPeriods,eventPeriods) = parseEntries(sys.argv[2:])
+    frame = ''.join([chr(b) for b in subscriptionFrame(statusPeriods,eventPeriods)])
+
+    # wait for the mote to ask for input: a request frame is 5 bytes long
+    request   = OpenHdlc.OpenHdlc().hdlcify([SERFRAME_MOTE2PC_REQUEST])
+    request   = ''.join([chr(b) for b in request])
+    port      = serial.Serial(sys.argv[1],'115200')
+    rxBuf     = ''
+    while True:
+        rxBuf = (rxBuf+port.read(1))[-len(request):]
+        if rxBuf==request:
+            port.write(frame)
+            break
+    port.close()
+    print 'subscription sent.'
+
+if __name__=="__main__":
+    main()
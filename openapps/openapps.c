@@ -16,5 +16,8 @@
 //=========================== private =========================================
 
 void openapps_init(void) {
+#ifndef GOLDEN_IMAGE_SNIFFER
+   // a sniffer never transmits, the packets of the apps would fill the queue
    uinject_init();
+#endif
 }
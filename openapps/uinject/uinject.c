@@ -3,6 +3,7 @@
 #include "openqueue.h"
 #include "opentimers.h"
 #include "openserial.h"
+#include "openeventlog.h"
 #include "packetfunctions.h"
 #include "neighbors.h"
 #include "scheduler.h"
@@ -18,90 +19,150 @@ uinject_vars_t uinject_vars;
 
 void uinject_timer_cb(opentimer_id_t id);
 void uinject_task_cb(void);
+void uinject_command_cb(uint8_t* param, uint8_t paramLen);
+// aggregation
+bool uinject_aggAppend(uint16_t nextHop, uinject_rec_t* recs, uint8_t numRecs);
+void uinject_aggFlush(void);
+void uinject_aggTimer_cb(opentimer_id_t id);
+void uinject_aggTask_cb(void);
 
 //=========================== public ==========================================
 
 void uinject_init() {
-   
+
    // clear local variables
    memset(&uinject_vars,0,sizeof(uinject_vars_t));
-   
+   uinject_vars.aggPkt     = NULL;
+   uinject_vars.aggTimerId = TOO_MANY_TIMERS_ERROR;
+
    // start periodic timer
    uinject_vars.timerId = opentimers_start(
                                 UINJECT_PERIOD_MS,
                                 TIMER_PERIODIC,TIME_MS,
                                 uinject_timer_cb
                           );
+   // the exact sending time doesn't matter, don't wake up just for it
+   opentimers_setSlack(uinject_vars.timerId,TIME_MS,UINJECT_SLACK_MS);
+   
+   // the period can be changed over serial
+   openserial_registerCommand(COMMAND_SET_UINJECTPERIOD,uinject_command_cb);
+}
+
+/**
+\brief Change the period at which packets are generated.
+
+\param periodMs The new period, in ms. The next packet comes one period after
+   this call.
+*/
+void uinject_setPeriod(uint16_t periodMs) {
+   
+   // the DAG root doesn't generate packets, its timer is gone
+   if (idmanager_getIsDAGroot() || periodMs==0) {
+      return;
+   }
+   opentimers_setPeriod(uinject_vars.timerId,TIME_MS,periodMs);
 }
 
 void uinject_sendDone(OpenQueueEntry_t* msg, owerror_t error) {
    openqueue_freePacketBuffer(msg);
 }
 
+/**
+\brief Handle a received uinject frame.
+
+At the sink, every record carried in the frame is reported. At a relay, the
+records are forwarded to the preferred parent. Rather than sending one frame
+per record, relays aggregate records going to the same next hop into a single
+frame, held for at most UINJECT_AGG_BUDGET_MS.
+*/
 void uinject_receive(OpenQueueEntry_t* pkt) {
-   OpenQueueEntry_t    *fwd;
-   uinject_ht          *pkt_payload, *fwd_payload;
-   
+   uinject_ht          *pkt_payload;
+   uinject_rec_t       *rec;
+   uint16_t            nextHop;
+   uint8_t             numRecs;
+   uint8_t             i;
+
    // get the received packet payload
    pkt_payload = (uinject_ht*)(pkt->payload);
-   
-   if (pkt_payload->l3_dst != idmanager_getMyShortID()) {
-       // need to forward the packet
-     
-      fwd = openqueue_getFreePacketBuffer(COMPONENT_UINJECT);
-      if (fwd==NULL) {
-         openserial_printError(COMPONENT_UINJECT, ERR_NO_FREE_PACKET_BUFFER,
-                              (errorparameter_t)0, (errorparameter_t)0);
+
+   // the number of records follows from the length of the frame
+   if (
+         pkt->length<sizeof(uinject_ht) ||
+         (pkt->length-sizeof(l2_ht))%sizeof(uinject_rec_t)!=0
+      ) {
+      openserial_printError(COMPONENT_UINJECT, ERR_INPUTBUFFER_LENGTH,
+                            (errorparameter_t)pkt->length, (errorparameter_t)0);
+      return;
+   }
+   numRecs = (pkt->length-sizeof(l2_ht))/sizeof(uinject_rec_t);
+
+   if (pkt_payload->rec.l3_dst != idmanager_getMyShortID()) {
+      // need to forward the packet
+
+      nextHop = neighbors_getPreferredParent();
+
+      openeventlog_log(COMPONENT_UINJECT, ERR_UINJECT_FWD,
+                       (errorparameter_t)pkt_payload->rec.l3_src,
+                       (errorparameter_t)pkt_payload->rec.l3_dst);
+
+      // try to add the records to the frame being aggregated
+      if (uinject_aggAppend(nextHop, &pkt_payload->rec, numRecs)==TRUE) {
+         // pkt will be destroyed by sixtop
          return;
       }
-      
-      fwd->owner                                   = COMPONENT_UINJECT;
-      fwd->creator                                 = COMPONENT_UINJECT;
-      fwd->l2_nextORpreviousHop.type               = ADDR_16B;
-      uint16_t nextHop                             = neighbors_getPreferredParent();
-      fwd->l2_nextORpreviousHop.addr_16b[0]        = (uint8_t)(nextHop&0xff);
-      fwd->l2_nextORpreviousHop.addr_16b[1]        = (uint8_t)(nextHop>>8);
-   
-      // fill fwd payload
-      packetfunctions_reserveHeaderSize(fwd, sizeof(uinject_ht));
-      fwd_payload               = (uinject_ht*)(fwd->payload);
-      fwd_payload->l2_hdr.type  = LONGTYPE_DATA;
-      fwd_payload->l2_hdr.src   = idmanager_getMyShortID();
-      fwd_payload->l2_hdr.dst   = nextHop;
-      fwd_payload->l3_src       = pkt_payload->l3_src;
-      fwd_payload->l3_dst       = pkt_payload->l3_dst;
-      fwd_payload->counter      = pkt_payload->counter;
-      fwd_payload->asn0         = pkt_payload->asn0;
-      fwd_payload->asn1         = pkt_payload->asn1;
-      fwd_payload->asn2         = pkt_payload->asn2;
-      fwd_payload->asn3         = pkt_payload->asn3;
-   
-      openserial_printInfo(COMPONENT_UINJECT, ERR_UINJECT_FWD, 
-                            (errorparameter_t)pkt_payload->l3_src, 
-                            (errorparameter_t)pkt_payload->l3_dst);
-      
-      if ((sixtop_send(fwd))==E_FAIL) {
-         openqueue_freePacketBuffer(fwd);
+
+      // reuse the received buffer, only the L2 header changes
+      if (openqueue_transferOwnership(pkt, COMPONENT_UINJECT)==E_FAIL) {
+         return;
+      }
+
+      pkt->l2_nextORpreviousHop.type               = ADDR_16B;
+      pkt->l2_nextORpreviousHop.addr_16b[0]        = (uint8_t)(nextHop&0xff);
+      pkt->l2_nextORpreviousHop.addr_16b[1]        = (uint8_t)(nextHop>>8);
+
+      // rewrite the L2 header in place
+      pkt_payload->l2_hdr.type  = LONGTYPE_DATA;
+      pkt_payload->l2_hdr.src   = idmanager_getMyShortID();
+      pkt_payload->l2_hdr.dst   = nextHop;
+
+      // hold it, waiting for other records to the same next hop
+      if (UINJECT_AGG_BUDGET_MS>0 && numRecs<UINJECT_AGG_MAXRECS) {
+         uinject_vars.aggTimerId = opentimers_start(
+                                      UINJECT_AGG_BUDGET_MS,
+                                      TIMER_ONESHOT,TIME_MS,
+                                      uinject_aggTimer_cb
+                                   );
+         if (uinject_vars.aggTimerId!=TOO_MANY_TIMERS_ERROR) {
+            uinject_vars.aggPkt = pkt;
+            return;
+         }
+      }
+
+      if ((sixtop_send(pkt))==E_FAIL) {
+         openqueue_freePacketBuffer(pkt);
       }
    }
    else {
-      // just process the packet  
-      
-      uint8_t asn[5];   // we create a local array to store the ASN from the rcv packet
-      asn[0] = 0;                       // byte4
-      asn[1] = pkt_payload->asn2;       // bytes2and3
-      asn[2] = pkt_payload->asn3;       // bytes2and3
-      asn[3] = pkt_payload->asn0;       // bytes0and1
-      asn[4] = pkt_payload->asn1;       // bytes0and1
-        
-      uint32_t asnDiff = ieee154e_asnDiff((asn_t *)asn);
-       
-      openserial_printInfo(COMPONENT_UINJECT, ERR_UINJECT_RCV, 
-                           (errorparameter_t)pkt_payload->l3_src, 
-                           (errorparameter_t)asnDiff);
+      // just process the packet, one record at a time
+
+      rec = &pkt_payload->rec;
+      for (i=0;i<numRecs;i++,rec++) {
+         uint8_t asn[5];   // we create a local array to store the ASN from the rcv packet
+         asn[0] = 0;                       // byte4
+         asn[1] = rec->asn2;               // bytes2and3
+         asn[2] = rec->asn3;               // bytes2and3
+         asn[3] = rec->asn0;               // bytes0and1
+         asn[4] = rec->asn1;               // bytes0and1
+
+         uint32_t asnDiff = ieee154e_asnDiff((asn_t *)asn);
+
+         openeventlog_log(COMPONENT_UINJECT, ERR_UINJECT_RCV,
+                          (errorparameter_t)rec->l3_src,
+                          (errorparameter_t)asnDiff);
+      }
    }
-   
-   // pkt will be destroyed by sixtop
+
+   // if not forwarded, pkt will be destroyed by sixtop
 }
 
 //=========================== private =========================================
@@ -111,62 +172,178 @@ void uinject_receive(OpenQueueEntry_t* pkt) {
    task to scheduler with CoAP priority, and let scheduler take care of it.
 */
 void uinject_timer_cb(opentimer_id_t id){
-   
+
    scheduler_push_task(uinject_task_cb,TASKPRIO_COAP);
 }
 
 void uinject_task_cb() {
    OpenQueueEntry_t*    pkt;
    uinject_ht*          payload;
-   
+   uinject_rec_t        rec;
+
    // don't run if not synch
    if (ieee154e_isSynch() == FALSE) return;
-   
+
    // don't run on dagroot
    if (idmanager_getIsDAGroot()) {
       opentimers_stop(uinject_vars.timerId);
       return;
    }
-   
+
    // if you get here, send a packet
-   
+
+   uint16_t nextHop     = neighbors_getPreferredParent();
+
+   // fill record
+   rec.l3_src           = idmanager_getMyShortID();
+   rec.l3_dst           = SINK_ID;
+   rec.counter          = uinject_vars.counter++;
+
+   // get the current ASN
+   uint8_t curAsn[5];
+   ieee154e_getAsn(curAsn);
+   rec.asn0             = curAsn[0];
+   rec.asn1             = curAsn[1];
+   rec.asn2             = curAsn[2];
+   rec.asn3             = curAsn[3];
+
+   openeventlog_log(COMPONENT_UINJECT, ERR_UINJECT_SND,
+                    (errorparameter_t)rec.l3_dst, (errorparameter_t)rec.counter);
+
+   // piggyback on the frame being aggregated, if any
+   if (uinject_aggAppend(nextHop, &rec, 1)==TRUE) {
+      return;
+   }
+
    // get a free packet buffer
    pkt = openqueue_getFreePacketBuffer(COMPONENT_UINJECT);
    if (pkt==NULL) {
-      openserial_printError(COMPONENT_UINJECT, ERR_NO_FREE_PACKET_BUFFER, 
+      openserial_printError(COMPONENT_UINJECT, ERR_NO_FREE_PACKET_BUFFER,
                             (errorparameter_t)0, (errorparameter_t)0);
       return;
    }
-   
+
    pkt->owner                                   = COMPONENT_UINJECT;
    pkt->creator                                 = COMPONENT_UINJECT;
    pkt->l2_nextORpreviousHop.type               = ADDR_16B;
-   uint16_t nextHop                             = neighbors_getPreferredParent();
    pkt->l2_nextORpreviousHop.addr_16b[0]        = (uint8_t)(nextHop&0xff);
    pkt->l2_nextORpreviousHop.addr_16b[1]        = (uint8_t)(nextHop>>8);
-   
+
    // fill payload
    packetfunctions_reserveHeaderSize(pkt ,sizeof(uinject_ht));
    payload              = (uinject_ht*)(pkt->payload);
    payload->l2_hdr.type = LONGTYPE_DATA;
    payload->l2_hdr.src  = idmanager_getMyShortID();
    payload->l2_hdr.dst  = nextHop;
-   payload->l3_src      = idmanager_getMyShortID();
-   payload->l3_dst      = SINK_ID;
-   payload->counter     = uinject_vars.counter++;
-   
-   // get the current ASN
-   uint8_t curAsn[5];
-   ieee154e_getAsn(curAsn);
-   payload->asn0        = curAsn[0];
-   payload->asn1        = curAsn[1];
-   payload->asn2        = curAsn[2];
-   payload->asn3        = curAsn[3];
-            
-   openserial_printInfo(COMPONENT_UINJECT, ERR_UINJECT_SND, 
-                        (errorparameter_t)payload->l3_dst, (errorparameter_t)payload->counter);
-   
+   memcpy(&payload->rec,&rec,sizeof(uinject_rec_t));
+
+   if ((sixtop_send(pkt))==E_FAIL) {
+      openqueue_freePacketBuffer(pkt);
+   }
+}
+
+/**
+\brief COMMAND_SET_UINJECTPERIOD received over serial, the period in ms.
+*/
+void uinject_command_cb(uint8_t* param, uint8_t paramLen) {
+   if (paramLen!=2) {
+      return;
+   }
+   uinject_setPeriod((uint16_t)param[0] | ((uint16_t)param[1]<<8));
+}
+
+//=== aggregation
+
+/**
+\brief Append records to the frame being aggregated.
+
+\param nextHop The next hop the records are to be sent to.
+\param recs    The records to append.
+\param numRecs The number of records to append.
+
+\returns TRUE if the records were appended, FALSE if there is no frame being
+   aggregated for that next hop, or not enough room left in it (in which case
+   it is sent right away).
+*/
+bool uinject_aggAppend(uint16_t nextHop, uinject_rec_t* recs, uint8_t numRecs) {
+   uinject_ht*          payload;
+   uint8_t              aggRecs;
+
+   if (uinject_vars.aggPkt==NULL) {
+      return FALSE;
+   }
+
+   payload = (uinject_ht*)(uinject_vars.aggPkt->payload);
+   aggRecs = (uinject_vars.aggPkt->length-sizeof(l2_ht))/sizeof(uinject_rec_t);
+
+   // send the frame being aggregated if it can't take these records
+   if (payload->l2_hdr.dst!=nextHop || aggRecs+numRecs>UINJECT_AGG_MAXRECS) {
+      uinject_aggFlush();
+      return FALSE;
+   }
+
+   // the frame sits at the start of a received buffer, append at the tail
+   memcpy(
+      uinject_vars.aggPkt->payload+uinject_vars.aggPkt->length,
+      recs,
+      numRecs*sizeof(uinject_rec_t)
+   );
+   uinject_vars.aggPkt->length += numRecs*sizeof(uinject_rec_t);
+
+   // send right away once full
+   if (aggRecs+numRecs==UINJECT_AGG_MAXRECS) {
+      uinject_aggFlush();
+   }
+
+   return TRUE;
+}
+
+/**
+\brief Hand the frame being aggregated (if any) to sixtop.
+*/
+void uinject_aggFlush() {
+   OpenQueueEntry_t*    pkt;
+   uint8_t              numRecs;
+   INTERRUPT_DECLARATION();
+
+   if (uinject_vars.aggPkt==NULL) {
+      return;
+   }
+
+   // stop the budget timer, unless it already fired
+   DISABLE_INTERRUPTS();
+   if (uinject_vars.aggTimerId!=TOO_MANY_TIMERS_ERROR) {
+      opentimers_stop(uinject_vars.aggTimerId);
+      uinject_vars.aggTimerId = TOO_MANY_TIMERS_ERROR;
+   }
+   ENABLE_INTERRUPTS();
+
+   pkt                  = uinject_vars.aggPkt;
+   uinject_vars.aggPkt  = NULL;
+
+   numRecs = (pkt->length-sizeof(l2_ht))/sizeof(uinject_rec_t);
+   if (numRecs>1) {
+      openeventlog_log(COMPONENT_UINJECT, ERR_UINJECT_AGG,
+                       (errorparameter_t)numRecs,
+                       (errorparameter_t)((uinject_ht*)(pkt->payload))->l2_hdr.dst);
+   }
+
    if ((sixtop_send(pkt))==E_FAIL) {
       openqueue_freePacketBuffer(pkt);
    }
-}
\ No newline at end of file
+}
+
+/**
+\note latency budget elapsed, send what was aggregated from task context.
+*/
+void uinject_aggTimer_cb(opentimer_id_t id) {
+
+   // one-shot timer, the id may be reused from now on
+   uinject_vars.aggTimerId = TOO_MANY_TIMERS_ERROR;
+
+   scheduler_push_task(uinject_aggTask_cb,TASKPRIO_COAP);
+}
+
+void uinject_aggTask_cb() {
+   uinject_aggFlush();
+}
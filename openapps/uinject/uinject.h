@@ -14,12 +14,16 @@
 //=========================== define ==========================================
 
 #define UINJECT_PERIOD_MS 1000
+#define UINJECT_SLACK_MS  50
+
+// aggregation of forwarded records (see uinject_receive())
+#define UINJECT_AGG_BUDGET_MS   200 // max time a forwarded record is held back, waiting for other records to the same next hop (0 disables aggregation)
+#define UINJECT_AGG_MAXRECS       8 // max number of records per frame (7B header + 8*10B records + 2B CRC fits in a 127B frame)
 
 //=========================== typedef =========================================
 
 BEGIN_PACK
 typedef struct {                                 // always written big endian, i.e. MSB in addr[0]
-   l2_ht     l2_hdr;
    uint16_t  l3_src;
    uint16_t  l3_dst;
    uint16_t  counter;
@@ -27,19 +31,36 @@ typedef struct {                                 // always written big endian, i
    uint8_t   asn1;
    uint8_t   asn2;
    uint8_t   asn3;   
+} uinject_rec_t;
+END_PACK
+
+/**
+\brief A uinject frame.
+
+A frame carries one record, or several when aggregated by a relay, in which
+case the additional records directly follow the first one. The number of
+records is given by the length of the frame.
+*/
+BEGIN_PACK
+typedef struct {                                 // always written big endian, i.e. MSB in addr[0]
+   l2_ht           l2_hdr;
+   uinject_rec_t   rec;
 } uinject_ht;
 END_PACK
 
 //=========================== variables =======================================
 
 typedef struct {
-   opentimer_id_t       timerId;  // periodic timer which triggers transmission
-   uint16_t             counter;  // incrementing counter which is written into the packet
+   opentimer_id_t       timerId;     // periodic timer which triggers transmission
+   uint16_t             counter;     // incrementing counter which is written into the packet
+   OpenQueueEntry_t*    aggPkt;      // forwarded frame being aggregated, held until full or budget elapsed
+   opentimer_id_t       aggTimerId;  // one-shot timer bounding how long aggPkt is held
 } uinject_vars_t;
 
 //=========================== prototypes ======================================
 
 void uinject_init(void);
+void uinject_setPeriod(uint16_t periodMs);
 void uinject_sendDone(OpenQueueEntry_t* msg, owerror_t error);
 void uinject_receive(OpenQueueEntry_t* msg);
 
@@ -17,6 +17,7 @@
 #include "sensors.h"
 #include "topology.h"
 #include "openapps.h" 
+#include "opentimers.h"
 
 //=========================== variables =======================================
 
@@ -179,6 +180,27 @@ PORT_RADIOTIMER_WIDTH ieee154e_asnDiff(asn_t* someASN) {
    return diff;
 }
 
+/**
+\brief Number of slots from one ASN to a later one.
+
+Unlike ieee154e_asnDiff(), works on copies of the ASN, and can hence be called
+with interrupts disabled.
+
+\returns The difference, or 0xffffffff if the ASN went backwards (e.g. when
+   synchronizing) or too far to be represented.
+*/
+uint32_t ieee154e_asnSince(asn_t* now, asn_t* then) {
+   uint32_t nowLow;
+   uint32_t thenLow;
+   
+   nowLow  = ((uint32_t)now->bytes2and3<<16)  | now->bytes0and1;
+   thenLow = ((uint32_t)then->bytes2and3<<16) | then->bytes0and1;
+   if (now->byte4!=then->byte4 || nowLow<thenLow) {
+      return 0xffffffff;
+   }
+   return nowLow-thenLow;
+}
+
 //======= events
 
 /**
@@ -203,6 +225,11 @@ void isr_ieee154e_newSlot() {
       activity_ti1ORri1();
    }
    ieee154e_dbg.num_newSlot++;
+
+   // serve the timers which can wait for a slot boundary, from a task
+   if (opentimers_newSlot()==TRUE) {
+      scheduler_push_task(opentimers_task_coalesce,TASKPRIO_OPENTIMERS);
+   }
 }
 
 /**
@@ -760,6 +787,15 @@ port_INLINE void activity_ti1ORri1() {
       return;
    }
    
+#ifdef GOLDEN_IMAGE_SNIFFER
+   // a sniffer listens in every active cell, and never transmits. Without Tx
+   // nor ACK to time, the serial output started in an idle slot can go on.
+   ieee154e_vars.dataToSend = NULL;
+   changeState(S_RXDATAOFFSET);
+   radiotimer_schedule(DURATION_rt1);
+   return;
+#endif
+   
    // stop using serial
    openserial_stop();
    // assuming that there is nothing to send
@@ -876,15 +912,20 @@ port_INLINE void activity_ti1ORri1() {
 }
 
 port_INLINE void activity_ti2() {
+   OpenQueueEntry_t* frame;
    
    // change state
    changeState(S_TXDATAPREPARE);
-
-   // make a local copy of the frame
-   packetfunctions_duplicatePacket(&ieee154e_vars.localCopyForTransmission, ieee154e_vars.dataToSend);
    
-   // add 2 CRC bytes only to the local copy as we end up here for each retransmission
-   packetfunctions_reserveFooterSize(&ieee154e_vars.localCopyForTransmission, 2);
+   // the CRC footer was reserved by sixtop when enqueuing, so the queued frame
+   // can be loaded as is. Only make a local copy if it is transformed before
+   // going out (security), the queued frame must stay intact for retransmissions.
+   if (ieee154e_vars.isSecurityEnabled==TRUE) {
+      packetfunctions_duplicatePacket(&ieee154e_vars.localCopyForTransmission, ieee154e_vars.dataToSend);
+      frame = &ieee154e_vars.localCopyForTransmission;
+   } else {
+      frame = ieee154e_vars.dataToSend;
+   }
    
    // calculate the frequency to transmit on
    ieee154e_vars.freq = calculateFrequency(schedule_getChannelOffset()); 
@@ -893,8 +934,8 @@ port_INLINE void activity_ti2() {
    radio_setFrequency(ieee154e_vars.freq);
    
    // load the packet in the radio's Tx buffer
-   radio_loadPacket(ieee154e_vars.localCopyForTransmission.payload,
-                    ieee154e_vars.localCopyForTransmission.length);
+   radio_loadPacket(frame->payload,
+                    frame->length);
    
    // enable the radio in Tx mode. This does not send the packet.
    radio_txEnable();
@@ -1051,6 +1092,12 @@ port_INLINE void activity_ti7() {
 }
 
 port_INLINE void activity_tie5() {
+#ifdef GOLDEN_IMAGE_SNIFFER
+   // no ACK overheard, there is no transmission to conclude
+   endSlot();
+   return;
+#endif
+   
    // indicate transmit failed to schedule to keep stats
    schedule_indicateTx(&ieee154e_vars.asn,FALSE);
    
@@ -1109,20 +1156,8 @@ port_INLINE void activity_ti9(PORT_RADIOTIMER_WIDTH capturedTime) {
    // record the captured time
    ieee154e_vars.lastCapturedTime = capturedTime;
    
-   // get a buffer to put the (received) ACK in
-   ieee154e_vars.ackReceived = openqueue_getFreePacketBuffer(COMPONENT_IEEE802154E);
-   if (ieee154e_vars.ackReceived==NULL) {
-      // log the error
-      openserial_printError(COMPONENT_IEEE802154E,ERR_NO_FREE_PACKET_BUFFER,
-                            (errorparameter_t)0, (errorparameter_t)0);
-      // abort
-      endSlot();
-      return;
-   }
-   
-   // declare ownership over that packet
-   ieee154e_vars.ackReceived->creator = COMPONENT_IEEE802154E;
-   ieee154e_vars.ackReceived->owner   = COMPONENT_IEEE802154E;
+   // use the MAC's own buffer to put the (received) ACK in
+   ieee154e_vars.ackReceived = &ieee154e_vars.ackRxBuf;
    
    /*
    The do-while loop that follows is a little parsing trick.
@@ -1136,7 +1171,8 @@ port_INLINE void activity_ti9(PORT_RADIOTIMER_WIDTH capturedTime) {
    do { // this "loop" is only executed once
       
       // retrieve the received ack frame from the radio's Rx buffer
-      ieee154e_vars.ackReceived->payload = &(ieee154e_vars.ackReceived->packet[FIRST_FRAME_BYTE]);
+      ieee154e_vars.ackReceived->payload = &(ieee154e_vars.ackReceived->packet[0]);
+      ieee154e_vars.ackReceived->length  = 0; // left untouched by the radio if the frame is rejected
       radio_getReceivedFrame(       ieee154e_vars.ackReceived->payload,
                                    &ieee154e_vars.ackReceived->length,
                              sizeof(ieee154e_vars.ackReceived->packet),
@@ -1144,13 +1180,28 @@ port_INLINE void activity_ti9(PORT_RADIOTIMER_WIDTH capturedTime) {
                                    &ieee154e_vars.ackReceived->l1_lqi,
                                    &ieee154e_vars.ackReceived->l1_crc);
       
+#ifdef GOLDEN_IMAGE_SNIFFER
+      // report the ACK, there is no transmission to conclude
+      if (ieee154e_vars.ackReceived->length>=LENGTH_CRC) {
+         openserial_printPacket(
+            ieee154e_vars.ackReceived->payload,
+            ieee154e_vars.ackReceived->length-LENGTH_CRC,
+            ieee154e_vars.freq,
+            ieee154e_vars.ackReceived->l1_rssi,
+            ieee154e_vars.ackReceived->l1_lqi,
+            ieee154e_vars.ackReceived->l1_crc
+         );
+      }
+      break;
+#endif
+      
       // break if wrong length
       if (ieee154e_vars.ackReceived->length!=sizeof(ack_ht)+2) {
          break;
       }
       
       // toss CRC (2 last bytes)
-      packetfunctions_tossFooter(   ieee154e_vars.ackReceived, LENGTH_CRC);
+      ieee154e_vars.ackReceived->length -= LENGTH_CRC;
    
       // break if invalid CRC
       if (ieee154e_vars.ackReceived->l1_crc==FALSE) {
@@ -1189,10 +1240,7 @@ port_INLINE void activity_ti9(PORT_RADIOTIMER_WIDTH capturedTime) {
       // in any case, execute the clean-up code below (processing of ACK done)
    } while (0);
    
-   // free the received ack so corresponding RAM memory can be recycled
-   openqueue_freePacketBuffer(ieee154e_vars.ackReceived);
-   
-   // clear local variable
+   // clear local variable (the ACK buffer is owned by the MAC, nothing to free)
    ieee154e_vars.ackReceived = NULL;
    
    // official end of Tx slot
@@ -1342,6 +1390,18 @@ port_INLINE void activity_ri5(PORT_RADIOTIMER_WIDTH capturedTime) {
       // toss CRC (2 last bytes)
       packetfunctions_tossFooter(   ieee154e_vars.dataReceived, LENGTH_CRC);
       
+#ifdef GOLDEN_IMAGE_SNIFFER
+      // report the frame, whatever its destination and CRC
+      openserial_printPacket(
+         ieee154e_vars.dataReceived->payload,
+         ieee154e_vars.dataReceived->length,
+         ieee154e_vars.freq,
+         ieee154e_vars.dataReceived->l1_rssi,
+         ieee154e_vars.dataReceived->l1_lqi,
+         ieee154e_vars.dataReceived->l1_crc
+      );
+#endif
+      
       // break if invalid CRC
       if (ieee154e_vars.dataReceived->l1_crc==FALSE) {
          // jump to the error code below this do-while loop
@@ -1351,6 +1411,34 @@ port_INLINE void activity_ri5(PORT_RADIOTIMER_WIDTH capturedTime) {
       // parse as if it's an EB (all packets start with type followed by src)
       eb_payload = (eb_ht*)ieee154e_vars.dataReceived->payload;
       
+#ifdef GOLDEN_IMAGE_SNIFFER
+      // stay synchronized on the EBs of any node
+      if (
+         eb_payload->l2_hdr.type == LONGTYPE_BEACON &&
+         eb_payload->syncnum != ieee154e_vars.syncnum
+      ) {
+         synchronizePacket(ieee154e_vars.syncCapturedTime);
+         ieee154e_vars.syncnum = eb_payload->syncnum;
+      }
+      
+      // overhear the ACK of unicast data, as if this mote had sent it
+      if (
+         eb_payload->l2_hdr.type == LONGTYPE_DATA &&
+         eb_payload->l2_hdr.dst  != BROADCAST_ID
+      ) {
+         openqueue_freePacketBuffer(ieee154e_vars.dataReceived);
+         ieee154e_vars.dataReceived = NULL;
+         
+         ieee154e_vars.lastCapturedTime = capturedTime;
+         changeState(S_RXACKOFFSET);
+         radiotimer_schedule(DURATION_tt5);
+         return;
+      }
+      
+      // nothing goes up the stack
+      break;
+#endif
+      
       // break if wrong type
       if (eb_payload->l2_hdr.type!=LONGTYPE_BEACON && eb_payload->l2_hdr.type!=LONGTYPE_DATA) {
          break;
@@ -1419,35 +1507,16 @@ port_INLINE void activity_ri6() {
    // change state
    changeState(S_TXACKPREPARE);
    
-   // get a buffer to put the ack to send in
-   ieee154e_vars.ackToSend = openqueue_getFreePacketBuffer(COMPONENT_IEEE802154E);
-   if (ieee154e_vars.ackToSend==NULL) {
-      // log the error
-      openserial_printError(COMPONENT_IEEE802154E,ERR_NO_FREE_PACKET_BUFFER,
-                            (errorparameter_t)0,
-                            (errorparameter_t)0);
-      // indicate we received a packet anyway (we don't want to loose any)
-      notif_receive(ieee154e_vars.dataReceived);
-      // free local variable
-      ieee154e_vars.dataReceived = NULL;
-      // abort
-      endSlot();
-      return;
-   }
-   
-   // declare ownership over that packet
-   ieee154e_vars.ackToSend->creator = COMPONENT_IEEE802154E;
-   ieee154e_vars.ackToSend->owner   = COMPONENT_IEEE802154E;
+   // use the MAC's own buffer to put the ack to send in
+   ieee154e_vars.ackToSend = &ieee154e_vars.ackTxBuf;
    
    // calculate the time timeCorrection (this is the time the sender is off w.r.t to this node. A negative number means
    // the sender is too late.
    ieee154e_vars.timeCorrection = (PORT_SIGNED_INT_WIDTH)((PORT_SIGNED_INT_WIDTH)TsTxOffset-(PORT_SIGNED_INT_WIDTH)ieee154e_vars.syncCapturedTime);
    
-   // prepend the IEEE802.15.4 header to the ACK
-   ieee154e_vars.ackToSend->l2_frameType = SHORTTYPE_ACK;
-   
    // fill in ACK
-   packetfunctions_reserveHeaderSize(ieee154e_vars.ackToSend,sizeof(ack_ht));
+   ieee154e_vars.ackToSend->payload = &(ieee154e_vars.ackToSend->packet[0]);
+   ieee154e_vars.ackToSend->length  = sizeof(ack_ht);
    payload       = (l2_ht*)(ieee154e_vars.ackToSend->payload);
    payload->type = LONGTYPE_ACK;
    payload->dsn  = ((l2_ht*)(ieee154e_vars.dataReceived->payload))->dsn;
@@ -1455,7 +1524,7 @@ port_INLINE void activity_ri6() {
    payload->dst  = ((l2_ht*)(ieee154e_vars.dataReceived->payload))->src;
    
    // space for 2-byte CRC
-   packetfunctions_reserveFooterSize(ieee154e_vars.ackToSend,2);
+   ieee154e_vars.ackToSend->length += LENGTH_CRC;
   
     // calculate the frequency to transmit on
    ieee154e_vars.freq = calculateFrequency(schedule_getChannelOffset()); 
@@ -1545,10 +1614,7 @@ port_INLINE void activity_ri9(PORT_RADIOTIMER_WIDTH capturedTime) {
    // record the captured time
    ieee154e_vars.lastCapturedTime = capturedTime;
    
-   // free the ack we just sent so corresponding RAM memory can be recycled
-   openqueue_freePacketBuffer(ieee154e_vars.ackToSend);
-   
-   // clear local variable
+   // clear local variable (the ACK buffer is owned by the MAC, nothing to free)
    ieee154e_vars.ackToSend = NULL;
    
    payload = (l2_ht*)(ieee154e_vars.dataReceived->payload);
@@ -1918,21 +1984,9 @@ void endSlot() {
       ieee154e_vars.dataReceived = NULL;
    }
    
-   // clean up ackToSend
-   if (ieee154e_vars.ackToSend!=NULL) {
-      // free ackToSend so corresponding RAM memory can be recycled
-      openqueue_freePacketBuffer(ieee154e_vars.ackToSend);
-      // reset local variable
-      ieee154e_vars.ackToSend = NULL;
-   }
-   
-   // clean up ackReceived
-   if (ieee154e_vars.ackReceived!=NULL) {
-      // free ackReceived so corresponding RAM memory can be recycled
-      openqueue_freePacketBuffer(ieee154e_vars.ackReceived);
-      // reset local variable
-      ieee154e_vars.ackReceived = NULL;
-   }
+   // clean up ackToSend and ackReceived (MAC-owned buffers, nothing to free)
+   ieee154e_vars.ackToSend   = NULL;
+   ieee154e_vars.ackReceived = NULL;
    
    // change state
    changeState(S_SLEEP);
@@ -46,6 +46,7 @@ static const uint8_t chTemplate_eb[] = {
 #define DESYNCTIMEOUT             2169 // in slots: 2169@4.61ms per slot -> ~10 seconds
 #define LIMITLARGETIMECORRECTION     5 // threshold number of ticks to declare a timeCorrection "large"
 #define LENGTH_IEEE154_MAX         128 // max length of a valid radio packet  
+#define LENGTH_ACK_BUFFER          LENGTH_IEEE154_MAX // size of the MAC-owned ACK buffers, any frame heard in the ACK window fits, with its RSSI/LQI or CRC
 #define DUTY_CYCLE_WINDOW_LIMIT    (0xFFFFFFFF>>1) // limit of the dutycycle window
 
 #define EB_PERIOD_TIMER   2000 // every 2 seconds increase the EB period by a certain amount
@@ -210,6 +211,26 @@ typedef struct {
    PORT_SIGNED_INT_WIDTH timeCorrection;
 } IEEE802154E_ACK_ht;
 
+/**
+\brief Buffer holding a single ACK frame.
+
+ACKs are short-lived (they never leave the slot they are sent/received in), so
+the MAC keeps one of these for Tx and one for Rx instead of taking full
+OpenQueueEntry_t's from openqueue. ACK processing hence never fails when the
+queue is full.
+
+Any frame heard in the ACK window lands in the Rx one, and not all radios
+honour the maximum length they are given, so it holds the longest frame.
+*/
+typedef struct {
+   uint8_t*                  payload;                 // pointer to the start of the frame
+   uint8_t                   length;                  // length in bytes of the frame, including CRC
+   int8_t                    l1_rssi;                 // RSSI of received ACK
+   uint8_t                   l1_lqi;                  // LQI of received ACK
+   bool                      l1_crc;                  // did received ACK pass CRC check?
+   uint8_t                   packet[LENGTH_ACK_BUFFER];
+} ieee154e_ackBuf_t;
+
 // includes payload header IE short + MLME short Header + Sync IE
 #define EB_PAYLOAD_LENGTH sizeof(payload_IE_ht) + \
                            sizeof(mlme_IE_ht)     + \
@@ -225,13 +246,15 @@ typedef struct {
    slotOffset_t              nextActiveSlotOffset;    // next active slot offset
    PORT_RADIOTIMER_WIDTH     deSyncTimeout;           // how many slots left before looses sync
    bool                      isSync;                  // TRUE iff mote is synchronized to network
-   OpenQueueEntry_t          localCopyForTransmission;// copy of the frame used for current TX
+   OpenQueueEntry_t          localCopyForTransmission;// copy of the frame used for current TX, only when security is enabled
    // as shown on the chronogram
    ieee154e_state_t          state;                   // state of the FSM
    OpenQueueEntry_t*         dataToSend;              // pointer to the data to send
    OpenQueueEntry_t*         dataReceived;            // pointer to the data received
-   OpenQueueEntry_t*         ackToSend;               // pointer to the ack to send
-   OpenQueueEntry_t*         ackReceived;             // pointer to the ack received
+   ieee154e_ackBuf_t*        ackToSend;               // pointer to the ack to send (ackTxBuf or NULL)
+   ieee154e_ackBuf_t*        ackReceived;             // pointer to the ack received (ackRxBuf or NULL)
+   ieee154e_ackBuf_t         ackTxBuf;                // buffer for the ack to send
+   ieee154e_ackBuf_t         ackRxBuf;                // buffer for the ack received
    PORT_RADIOTIMER_WIDTH     lastCapturedTime;        // last captured time
    PORT_RADIOTIMER_WIDTH     syncCapturedTime;        // captured time used to sync
    // channel hopping
@@ -292,6 +315,7 @@ typedef struct {
 void               ieee154e_init(void);
 // public
 PORT_RADIOTIMER_WIDTH   ieee154e_asnDiff(asn_t* someASN);
+uint32_t                ieee154e_asnSince(asn_t* now, asn_t* then);
 bool               ieee154e_isSynch(void);
 void               ieee154e_getAsn(uint8_t* array);
 void               ieee154e_getAsnStruct(asn_t* toAsn);
@@ -462,10 +462,12 @@ status information about several modules in the OpenWSN stack.
 */
 bool debugPrint_neighbors() {
    debugNeighborEntry_t temp;
-   neighbors_vars.debugRow=(neighbors_vars.debugRow+1)%MAXNUMNEIGHBORS;
-   temp.row=neighbors_vars.debugRow;
-   temp.neighborEntry=neighbors_vars.neighbors[neighbors_vars.debugRow];
-   openserial_printStatus(STATUS_NEIGHBORS,(uint8_t*)&temp,sizeof(debugNeighborEntry_t));
+   temp.row=(neighbors_vars.debugRow+1)%MAXNUMNEIGHBORS;
+   temp.neighborEntry=neighbors_vars.neighbors[temp.row];
+   // only move on once printed, so no row is skipped when the frame is full
+   if (openserial_printStatus(STATUS_NEIGHBORS,(uint8_t*)&temp,sizeof(debugNeighborEntry_t))==E_SUCCESS) {
+      neighbors_vars.debugRow=temp.row;
+   }
    return TRUE;
 }
 
@@ -58,8 +58,15 @@ void schedule_init() {
    extScheduleEntry_t 	extScheduleEntry;
    uint8_t              i;
    for (i = 0; running_slotOffset < NUM_EB_SLOTS + NUM_TXRX_SLOTS + NUM_UNICAST_SLOTS; running_slotOffset++, i++) {
+#ifdef GOLDEN_IMAGE_SNIFFER
+      // overhear whichever pair uses this time slot
+      extScheduleEntry.type        = CELLTYPE_RX;
+      extScheduleEntry.channelMask = SNIFFER_CHANNEL_OFFSET;
+      extScheduleEntry.neighbor    = BROADCAST_ID;
+#else
       // get the external schedule time slot
       getExtSchedule(idmanager_getMyShortID(), i, &extScheduleEntry);
+#endif
       // only add time slot for the ON cases
       if (extScheduleEntry.type != CELLTYPE_OFF) {
          schedule_addActiveSlot(
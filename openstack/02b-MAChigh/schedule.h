@@ -25,6 +25,16 @@ The superframe repears over time and can be arbitrarly long.
 
 #define MAXACTIVESLOTS       (NUM_EB_SLOTS + NUM_TXRX_SLOTS + NUM_UNICAST_SLOTS)
 
+/**
+\brief Channel offset the sniffer listens on in the unicast slots.
+
+The sniffer is in none of the pairs of the external schedule, it listens in
+all unicast slots, on the channel offset of the cells of ext_schedule.c.
+*/
+#ifndef SNIFFER_CHANNEL_OFFSET
+#define SNIFFER_CHANNEL_OFFSET 0
+#endif
+
 //=========================== typedef =========================================
 
 typedef uint8_t    channelOffset_t;
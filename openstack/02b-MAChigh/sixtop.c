@@ -52,6 +52,11 @@ port_INLINE void sixtop_sendEB(void) {
    OpenQueueEntry_t     *eb;
    eb_ht                *eb_payload;
    
+#ifdef GOLDEN_IMAGE_SNIFFER
+   // a sniffer only listens
+   return;
+#endif
+   
    if (neighbors_getMyDAGrank()==DEFAULTDAGRANK){
       // I have not acquired a DAGrank yet
       
@@ -96,101 +101,112 @@ port_INLINE void sixtop_sendEB(void) {
    sixtop_send_internal(eb);
 }
 
+/**
+\brief Handle the packets the MAC is done sending.
+
+Processes all sent packets in the queue, not only one, since the scheduler
+may coalesce several pushes of this task into a single run.
+*/
 void task_sixtopNotifSendDone(void) {
    OpenQueueEntry_t     *msg;
    l2_ht                *payload;
    
-   // get recently-sent packet from openqueue
-   msg = openqueue_sixtopGetSentPacket();
-   if (msg==NULL) {
-      openserial_printCritical(COMPONENT_SIXTOP, ERR_NO_SENT_PACKET,
-                              (errorparameter_t)0, (errorparameter_t)0);
-      return;
-   }
-   
-   // take ownership
-   msg->owner = COMPONENT_SIXTOP;
-   
-   // parse the payload
-   payload = (l2_ht *)(msg->payload);
-   
-   // update neighbor statistics
-   if (msg->l2_sendDoneError==E_SUCCESS) {
-      neighbors_indicateTx(
-         payload->dst,
-         msg->l2_numTxAttempts,
-         TRUE,
-         &msg->l2_asn
-      );
-   } else {
-      neighbors_indicateTx(
-         payload->dst,
-         msg->l2_numTxAttempts,
-         FALSE,
-         &msg->l2_asn
-      );
-   }
-   
-   // send the packet to where it belongs
-   switch (msg->creator) {
+   // get recently-sent packets from openqueue
+   while ((msg = openqueue_sixtopGetSentPacket())!=NULL) {
       
-      case COMPONENT_SIXTOP:
-         // this is a EB
-            
-         // discard packets
-         openqueue_freePacketBuffer(msg);
-         
-         break;
-  
-      case COMPONENT_UINJECT:
-         // this is a data packet
-         
-         uinject_sendDone(msg,msg->l2_sendDoneError);
-         break;
+      // take ownership
+      msg->owner = COMPONENT_SIXTOP;
+      
+      // parse the payload
+      payload = (l2_ht *)(msg->payload);
+      
+      // update neighbor statistics
+      if (msg->l2_sendDoneError==E_SUCCESS) {
+         neighbors_indicateTx(
+            payload->dst,
+            msg->l2_numTxAttempts,
+            TRUE,
+            &msg->l2_asn
+         );
+      } else {
+         neighbors_indicateTx(
+            payload->dst,
+            msg->l2_numTxAttempts,
+            FALSE,
+            &msg->l2_asn
+         );
+      }
+      
+      // send the packet to where it belongs
+      switch (msg->creator) {
          
-      default:
-         // send the rest up the stack
-         break;
+         case COMPONENT_SIXTOP:
+            // this is a EB
+               
+            // discard packets
+            openqueue_freePacketBuffer(msg);
+            
+            break;
+     
+         case COMPONENT_UINJECT:
+            // this is a data packet
+            
+            uinject_sendDone(msg,msg->l2_sendDoneError);
+            break;
+            
+         default:
+            // send the rest up the stack
+            break;
+      }
    }
 }
 
+/**
+\brief Handle the packets received by the MAC.
+
+Processes all received packets in the queue, not only one, since the
+scheduler may coalesce several pushes of this task into a single run.
+*/
 void task_sixtopNotifReceive(void) {
    OpenQueueEntry_t     *msg;
    l2_ht                *payload;
+   bool                 takenOver;
    
-   // get received packet from openqueue
-   msg = openqueue_sixtopGetReceivedPacket();
-   if (msg==NULL) {
-      openserial_printCritical(COMPONENT_SIXTOP, ERR_NO_RECEIVED_PACKET,
-                               (errorparameter_t)0, (errorparameter_t)0);
-      return;
-   }
-   
-   // take ownership
-   msg->owner = COMPONENT_SIXTOP;
-   
-   // parse as if it's an EB (all packets start with type, src, dst)
-   payload = (l2_ht*)msg->payload;
-   
-   // update neighbor statistics
-   neighbors_indicateRx(payload->src, msg->l1_rssi, &msg->l2_asn);
-   
-   // send the packet up the stack, if it qualifies
-   switch (payload->type) {
-      case LONGTYPE_BEACON:
-         neighbors_indicateRxEB(msg);
-         break;
-      case LONGTYPE_DATA:
-         uinject_receive(msg);
-         break;
-      default:
-         // log the error
-         openserial_printError(COMPONENT_SIXTOP, ERR_MSG_UNKNOWN_TYPE,
-                               (errorparameter_t)payload->type, (errorparameter_t)0);
-         break;
+   // get received packets from openqueue
+   while ((msg = openqueue_sixtopGetReceivedPacket())!=NULL) {
+      
+      // take ownership
+      msg->owner = COMPONENT_SIXTOP;
+      
+      // parse as if it's an EB (all packets start with type, src, dst)
+      payload = (l2_ht*)msg->payload;
+      
+      // update neighbor statistics
+      neighbors_indicateRx(payload->src, msg->l1_rssi, &msg->l2_asn);
+      
+      // send the packet up the stack, if it qualifies
+      takenOver = FALSE;
+      switch (payload->type) {
+         case LONGTYPE_BEACON:
+            neighbors_indicateRxEB(msg);
+            break;
+         case LONGTYPE_DATA:
+            uinject_receive(msg);
+            // uinject takes the packet over when forwarding it (see
+            // openqueue_transferOwnership())
+            takenOver = (msg->owner!=COMPONENT_SIXTOP);
+            break;
+         default:
+            // log the error
+            openserial_printError(COMPONENT_SIXTOP, ERR_MSG_UNKNOWN_TYPE,
+                                  (errorparameter_t)payload->type, (errorparameter_t)0);
+            break;
+      }
+      // free the packet's RAM memory, unless an upper layer took it over
+      if (takenOver==FALSE) {
+         openqueue_freePacketBuffer(msg);
+      }
    }
-   // free the packet's RAM memory
-   openqueue_freePacketBuffer(msg);
 }
 
 //======= debugging
@@ -245,6 +261,9 @@ owerror_t sixtop_send_internal(OpenQueueEntry_t* msg) {
    ((l2_ht *)(msg->payload))->dsn = sixtop_vars.dsn++;
    msg->l2_dsn = ((l2_ht *)(msg->payload))->dsn;
    
+   // space for 2-byte CRC, reserved once here rather than on each Tx attempt
+   packetfunctions_reserveFooterSize(msg,2);
+   
    // this is a new packet which I never attempted to send
    msg->l2_numTxAttempts = 0;
    // transmit with the default TX power
@@ -25,6 +25,7 @@ void openqueue_init() {
    for (i=0;i<QUEUELENGTH;i++){
       openqueue_reset_entry(&(openqueue_vars.queue[i]));
    }
+   openqueue_vars.numDropped = 0;
 }
 
 //======= called by any component
@@ -63,6 +64,7 @@ OpenQueueEntry_t* openqueue_getFreePacketBuffer(uint8_t creator) {
          return &openqueue_vars.queue[i];
       }
    }
+   openqueue_vars.numDropped++;
    ENABLE_INTERRUPTS();
    return NULL;
 }
@@ -135,6 +137,57 @@ void openqueue_removeAllOwnedBy(uint8_t owner) {
    ENABLE_INTERRUPTS();
 }
 
+/**
+\brief Hand a packet buffer over to another component, keeping its content.
+
+A component which wants to reuse a received packet buffer (e.g. to forward
+it) calls this function instead of allocating a new buffer and copying the
+frame into it. The frame (payload, length) is left untouched, only the
+metadata of the previous hop is reset so the buffer can be requeued.
+
+\note The new owner also becomes the creator of the buffer, so the sendDone
+      notification is routed to it, and it is responsible for freeing it.
+
+\param pkt      A pointer to the previously-allocated packet buffer.
+\param newOwner The identifier of the component, taken in COMPONENT_*.
+
+\returns E_SUCCESS when the transfer was successful.
+\returns E_FAIL when the buffer is not an allocated openqueue entry.
+*/
+owerror_t openqueue_transferOwnership(OpenQueueEntry_t* pkt, uint8_t newOwner) {
+   uint8_t i;
+   INTERRUPT_DECLARATION();
+   DISABLE_INTERRUPTS();
+   for (i=0;i<QUEUELENGTH;i++) {
+      if (&openqueue_vars.queue[i]==pkt) {
+         if (pkt->owner==COMPONENT_NULL) {
+            break;
+         }
+         // new owner
+         pkt->creator                   = newOwner;
+         pkt->owner                     = newOwner;
+         // forget about the previous hop
+         pkt->l2_nextORpreviousHop.type = ADDR_NONE;
+         pkt->l2_frameType              = SHORTTYPE_UNDEFINED;
+         pkt->l2_retriesLeft            = 0;
+         pkt->l2_numTxAttempts          = 0;
+         pkt->l2_sendDoneError          = E_SUCCESS;
+         pkt->l2_ASNpayload             = NULL;
+         pkt->l1_rssi                   = 0;
+         pkt->l1_lqi                    = 0;
+         pkt->l1_crc                    = FALSE;
+         ENABLE_INTERRUPTS();
+         return E_SUCCESS;
+      }
+   }
+   // log the error
+   openserial_printCritical(COMPONENT_OPENQUEUE,ERR_TRANSFER_UNUSED,
+                         (errorparameter_t)newOwner,
+                         (errorparameter_t)0);
+   ENABLE_INTERRUPTS();
+   return E_FAIL;
+}
+
 //======= called by RES
 
 OpenQueueEntry_t* openqueue_sixtopGetSentPacket() {
@@ -25,6 +25,7 @@ typedef struct {
 
 typedef struct {
    OpenQueueEntry_t queue[QUEUELENGTH];
+   uint16_t         numDropped;    // buffers refused as all were in use
 } openqueue_vars_t;
 
 //=========================== prototypes ======================================
@@ -37,6 +38,7 @@ OpenQueueEntry_t*  openqueue_getFreePacketBuffer(uint8_t creator);
 owerror_t          openqueue_freePacketBuffer(OpenQueueEntry_t* pkt);
 void               openqueue_removeAllCreatedBy(uint8_t creator);
 void               openqueue_removeAllOwnedBy(uint8_t owner);
+owerror_t          openqueue_transferOwnership(OpenQueueEntry_t* pkt, uint8_t newOwner);
 // called by res
 OpenQueueEntry_t*  openqueue_sixtopGetSentPacket(void);
 OpenQueueEntry_t*  openqueue_sixtopGetReceivedPacket(void);
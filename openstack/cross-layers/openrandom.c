@@ -1,6 +1,7 @@
 #include "opendefs.h"
 #include "openrandom.h"
 #include "idmanager.h"
+#include "board.h"
 
 //=========================== variables =======================================
 
@@ -15,6 +16,14 @@ void openrandom_init() {
    random_vars.shift_reg  = 0;
    random_vars.shift_reg += idmanager_getMyID(ADDR_16B)->addr_16b[0]*256;
    random_vars.shift_reg += idmanager_getMyID(ADDR_16B)->addr_16b[1];
+#ifdef OPENSIM
+   // the simulator can draw other sequences for the same address
+   random_vars.shift_reg ^= board_getRandomSeed();
+   if (random_vars.shift_reg==0) {
+      // the shift register would never leave 0
+      random_vars.shift_reg = 1;
+   }
+#endif
 }
 
 uint16_t openrandom_get16b() {
@@ -7,6 +7,7 @@
 #include "opendefs.h"
 //===== drivers
 #include "openserial.h"
+#include "openeventlog.h"
 //===== stack
 #include "openstack.h"
 //-- cross-layer
@@ -36,6 +37,7 @@ void openstack_init(void) {
    
    //===== drivers
    openserial_init();
+   openeventlog_init();
    
    //===== stack
    //-- cross-layer
@@ -0,0 +1,188 @@
+/**
+\brief Benchmark of the "opentimers" driver, with many concurrent timers.
+
+Since the drivers have the same declaration on all platforms, you can use this
+project with any platform.
+
+This program starts BENCH_NUM_TIMERS periodic timers, each with a different
+period, plus one "churn" timer. Every time the churn timer fires, it stops and
+restarts BENCH_CHURN_BATCH of the other timers.
+
+Results are accumulated in app_dbg, to be read through the debugger:
+- the number of times each timer expired, and the largest deviation (in ticks)
+  between two consecutive expirations and the timer's period.
+- the time spent in opentimers_stop()/opentimers_start(), in ticks per batch.
+Timer expirations are also visible on the "frame" debugpin, and the churn
+batches on the "slot" debugpin.
+*/
+
+#include "stdint.h"
+#include "string.h"
+#include "board.h"
+#include "debugpins.h"
+#include "leds.h"
+#include "opentimers.h"
+
+//=========================== defines =========================================
+
+#define BENCH_NUM_TIMERS     (MAX_NUM_TIMERS-1) // one left for the churn timer
+#define BENCH_BASE_PERIOD    328                // 328 ticks = 10ms @ 32kHz
+#define BENCH_PERIOD_STEP    37                 // ticks, prime to spread expirations
+#define BENCH_CHURN_PERIOD   500                // ms
+#define BENCH_CHURN_BATCH    8                  // timers restarted by churn timer
+
+//=========================== variables =======================================
+
+typedef struct {
+   uint32_t             num_expired[BENCH_NUM_TIMERS];
+   PORT_TIMER_WIDTH     max_jitter[BENCH_NUM_TIMERS];
+   uint16_t             num_churn;
+   uint16_t             num_startFailed;
+   PORT_TIMER_WIDTH     churn_ticks_last;
+   PORT_TIMER_WIDTH     churn_ticks_max;
+} app_dbg_t;
+
+app_dbg_t app_dbg;
+
+typedef struct {
+   opentimer_id_t       ids[BENCH_NUM_TIMERS];
+   uint32_t             periods[BENCH_NUM_TIMERS];
+   uint32_t             lastExpired[BENCH_NUM_TIMERS];
+   bool                 hasExpired[BENCH_NUM_TIMERS];
+   uint8_t              nextChurned;
+} app_vars_t;
+
+app_vars_t app_vars;
+
+//=========================== prototypes ======================================
+
+void    cb_bench(opentimer_id_t id);
+void    cb_churn(opentimer_id_t id);
+uint8_t app_findTimer(opentimer_id_t id);
+void    app_startTimer(uint8_t i);
+
+//=========================== main ============================================
+
+/**
+\brief The program starts executing here.
+*/
+int mote_main(void) {
+   uint8_t i;
+
+   // clear local variables
+   memset(&app_vars,0,sizeof(app_vars_t));
+   memset(&app_dbg,0,sizeof(app_dbg_t));
+
+   // initialize board
+   board_init();
+   opentimers_init();
+
+   // start the benchmarked timers
+   for (i=0;i<BENCH_NUM_TIMERS;i++) {
+      app_vars.periods[i] = BENCH_BASE_PERIOD+i*BENCH_PERIOD_STEP;
+      app_startTimer(i);
+   }
+
+   // start the churn timer
+   opentimers_start(
+      BENCH_CHURN_PERIOD,
+      TIMER_PERIODIC,
+      TIME_MS,
+      cb_churn
+   );
+
+   while (1) {
+      board_sleep();
+   }
+}
+
+//=========================== callbacks =======================================
+
+void cb_bench(opentimer_id_t id) {
+   uint32_t         now;
+   PORT_TIMER_WIDTH jitter;
+   uint8_t          i;
+
+   now = opentimers_getValue();
+
+   debugpins_frame_toggle();
+
+   i = app_findTimer(id);
+   if (i==BENCH_NUM_TIMERS) {
+      return;
+   }
+
+   // update debug vals
+   app_dbg.num_expired[i]++;
+   if (app_vars.hasExpired[i]==TRUE) {
+      jitter = (PORT_TIMER_WIDTH)(now-app_vars.lastExpired[i]);
+      if (jitter>app_vars.periods[i]) {
+         jitter -= app_vars.periods[i];
+      } else {
+         jitter  = app_vars.periods[i]-jitter;
+      }
+      if (jitter>app_dbg.max_jitter[i]) {
+         app_dbg.max_jitter[i] = jitter;
+      }
+   }
+   app_vars.lastExpired[i] = now;
+   app_vars.hasExpired[i]  = TRUE;
+}
+
+void cb_churn(opentimer_id_t id) {
+   uint32_t         start;
+   uint8_t          i;
+   uint8_t          n;
+
+   debugpins_slot_set();
+   start = opentimers_getValue();
+
+   // restart a batch of timers, round-robin
+   for (n=0;n<BENCH_CHURN_BATCH;n++) {
+      i = app_vars.nextChurned;
+      app_vars.nextChurned = (app_vars.nextChurned+1)%BENCH_NUM_TIMERS;
+
+      opentimers_stop(app_vars.ids[i]);
+      app_startTimer(i);
+   }
+
+   // update debug vals
+   app_dbg.churn_ticks_last = (PORT_TIMER_WIDTH)(opentimers_getValue()-start);
+   if (app_dbg.churn_ticks_last>app_dbg.churn_ticks_max) {
+      app_dbg.churn_ticks_max = app_dbg.churn_ticks_last;
+   }
+   app_dbg.num_churn++;
+   debugpins_slot_clr();
+
+   // led
+   leds_sync_toggle();
+}
+
+//=========================== private =========================================
+
+uint8_t app_findTimer(opentimer_id_t id) {
+   uint8_t i;
+
+   for (i=0;i<BENCH_NUM_TIMERS;i++) {
+      if (app_vars.ids[i]==id) {
+         break;
+      }
+   }
+   return i;
+}
+
+void app_startTimer(uint8_t i) {
+
+   app_vars.ids[i]        = opentimers_start(
+      app_vars.periods[i],
+      TIMER_PERIODIC,
+      TIME_TICS,
+      cb_bench
+   );
+   app_vars.hasExpired[i] = FALSE;
+
+   if (app_vars.ids[i]==TOO_MANY_TIMERS_ERROR) {
+      app_dbg.num_startFailed++;
+      leds_error_on();
+   }
+}
@@ -0,0 +1,67 @@
+'''
+Time the hot paths of the stack on the host: the queue, schedule and neighbor
+lookups done at every slot, the frequency and ASN computations of the MAC,
+the HDLC CRC and the packet header functions.
+
+They run unchanged on a bare mote of the Python board, with their tables
+filled to the size they are compiled with, and lookups hitting the last
+entry. The result is in nanoseconds per operation on this host; to compare
+with a mote, scale by the ratio of their instructions per second.
+
+With a baseline file, the results are compared with it, and the script fails
+if an operation got slower by more than REGRESSION_RATIO. Without one, the
+results are written to it.
+
+    bench_hotpaths.py [iterations] [baseline.json]
+
+This is what 'scons board=python toolchain=gcc bench' runs.
+'''
+
+import os
+import sys
+import json
+
+if __name__=='__main__':
+    here = sys.path[0]
+    sys.path.insert(0, os.path.join(here, '..','common'))# contains openwsn module
+
+import oos_openwsn
+
+REGRESSION_RATIO    = 1.2
+
+#============================ main ============================================
+
+def main():
+    iterations = int(sys.argv[1]) if len(sys.argv)>1 else 1000000
+    baseline   = sys.argv[2]      if len(sys.argv)>2 else None
+
+    results    = oos_openwsn.runMicrobenchmarks(iterations)
+
+    reference  = {}
+    if baseline and os.path.exists(baseline):
+        with open(baseline) as f:
+            reference = json.load(f)
+
+    numRegressions = 0
+    print '{0:<50} {1:>10} {2:>10}'.format('operation','ns/op','baseline')
+    for (name,nsPerOp) in results:
+        if name in reference:
+            ratio = nsPerOp/reference[name]
+            flag  = ''
+            if ratio>REGRESSION_RATIO:
+                flag            = '  slower'
+                numRegressions += 1
+            print '{0:<50} {1:>10.1f} {2:>9.2f}x{3}'.format(name,nsPerOp,ratio,flag)
+        else:
+            print '{0:<50} {1:>10.1f} {2:>10}'.format(name,nsPerOp,'-')
+
+    if baseline and not reference:
+        with open(baseline,'w') as f:
+            json.dump(dict(results),f,indent=4,sort_keys=True)
+        print 'baseline written to {0}'.format(baseline)
+    if numRegressions:
+        print '{0} operation(s) more than {1}x slower than the baseline'.format(numRegressions,REGRESSION_RATIO)
+        sys.exit(1)
+
+if __name__=="__main__":
+    main()
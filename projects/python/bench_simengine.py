@@ -0,0 +1,390 @@
+'''
+Measure how fast emulated motes run, with and without the native engine.
+
+- 'python' mode: the BSP of each mote is implemented in Python, as when
+  emulated motes are driven by a simulator written in Python: every BSP call
+  is a callback into the interpreter, each mote runs in its own thread, and
+  the engine thread serves the interrupts, resuming the mote after each of
+  them.
+- 'native' mode: the motes are attached to a SimEngine, which emulates their
+  BSP in C.
+
+Both modes use the same timing, radio and serial models, so they execute the
+same code of the stack. The result is in mote-slots per second of wall-clock
+time.
+
+    bench_simengine.py [numMotes] [simulated seconds] [python|native|both]
+'''
+
+import os
+import sys
+import re
+import time
+import heapq
+import random
+import threading
+
+if __name__=='__main__':
+    here = sys.path[0]
+    sys.path.insert(0, os.path.join(here, '..','common'))# contains openwsn module
+
+import oos_openwsn
+
+TICKS_PER_S         = 32768
+SUBTICK_SHIFT       = 10                         # as SIMENGINE_SUBTICK_SHIFT
+SLOT_TICKS          = 491                        # as PORT_TsSlotDuration
+DELAY_TX_TICKS      = 7                          # as PORT_delayTx
+RADIO_BYTE_SUBTICKS = 1074
+UART_BYTE_SUBTICKS  = 2913
+
+SINK_EUI64_END      = [0x5a,0x53]
+
+#============================ get notification IDs ============================
+
+def readNotifIds():
+    here = os.path.dirname(os.path.abspath(__file__))
+    f    = open(os.path.join(here,'..','..','bsp','boards','python','openwsnmodule_obj.h'))
+    ids  = []
+    for line in f.readlines():
+        m = re.search('MOTE_NOTIF_(\w+)',line)
+        if m and m.group(1) not in ids:
+            ids += [m.group(1)]
+    f.close()
+    return ids
+
+notifString = readNotifIds()
+
+#============================ topology ========================================
+
+def eui64(i):
+    if i==0:
+        return [0x14,0x15,0x92,0x00,0x00,0x00]+SINK_EUI64_END
+    return [0x14,0x15,0x92,0x00,0x00,0x00,0x10+(i>>8),i&0xff]
+
+def links(numMotes):
+    '''
+    Motes on a line, each hearing the ones at most 2 hops away.
+    '''
+    for src in range(numMotes):
+        for dst in range(numMotes):
+            if src!=dst and abs(src-dst)<=2:
+                yield (src,dst,1.0 if abs(src-dst)==1 else 0.7,-60-10*abs(src-dst))
+
+#============================ Python BSP ======================================
+
+EVT_RADIOTIMER_OVERFLOW = 0
+EVT_RADIOTIMER_COMPARE  = 1
+EVT_BSP_TIMER           = 2
+EVT_RADIO_TXSTART       = 3
+EVT_RADIO_TXEND         = 4
+EVT_UART_TX             = 5
+
+class PythonMote(object):
+    '''
+    An emulated mote whose BSP calls are served in Python.
+    '''
+
+    def __init__(self,engine,idx,eui64):
+        self.engine           = engine
+        self.idx              = idx
+        self.eui64            = eui64
+        self.gen              = [0]*6
+        # radiotimer
+        self.rtLastOverflow   = 0
+        self.rtPeriod         = 0
+        self.rtCompareArmed   = False
+        self.rtCompareOffset  = 0
+        # bsp_timer
+        self.btReset          = 0
+        self.btLastCompare    = 0
+        # radio
+        self.radioState       = 'off'
+        self.frequency        = 0
+        self.txBuf            = ''
+        self.rxFrom           = None
+        self.rxCollision      = False
+        self.rxFrame          = ('',0,0,0)
+        # uart
+        self.uartIntEnabled   = False
+        self.uartOut          = bytearray()
+        # coroutine
+        self.wake             = threading.Semaphore(0)
+        self.mote             = oos_openwsn.OpenMote()
+        for (i,name) in enumerate(notifString[:-1]):
+            self.mote.set_callback(i,getattr(self,name,self._noop))
+        for name in notifString:
+            if name.startswith('leds_') and name.endswith('_isOn'):
+                self.mote.set_callback(notifString.index(name),lambda: 0)
+
+    def _noop(self,*args):
+        pass
+
+    def nowTick(self):
+        return self.engine.now>>SUBTICK_SHIFT
+
+    def schedule(self,type,tick=None,time=None):
+        if time is None:
+            time = tick<<SUBTICK_SHIFT
+        self.engine.schedule(time,self,type,self.gen[type])
+
+    def cancel(self,type):
+        self.gen[type] += 1
+
+    #=== coroutine
+
+    def boot(self):
+        t        = threading.Thread(target=self.mote.supply_on)
+        t.daemon = True
+        t.start()
+        self.engine.moteAsleep.acquire()
+
+    def resume(self):
+        self.wake.release()
+        self.engine.moteAsleep.acquire()
+
+    #=== board
+
+    def board_sleep(self):
+        self.engine.moteAsleep.release()
+        self.wake.acquire()
+
+    #=== bsp_timer
+
+    def bsp_timer_reset(self):
+        self.btReset       = self.nowTick()
+        self.btLastCompare = self.btReset
+        self.cancel(EVT_BSP_TIMER)
+
+    def bsp_timer_scheduleIn(self,delay):
+        self.btLastCompare += delay
+        self.cancel(EVT_BSP_TIMER)
+        self.schedule(EVT_BSP_TIMER,max(self.btLastCompare,self.nowTick()))
+
+    def bsp_timer_cancel_schedule(self):
+        self.cancel(EVT_BSP_TIMER)
+
+    def bsp_timer_get_currentValue(self):
+        return (self.nowTick()-self.btReset)&0xffff
+
+    #=== eui64
+
+    def eui64_get(self):
+        return list(self.eui64)
+
+    #=== radiotimer
+
+    def radiotimer_start(self,period):
+        self.rtLastOverflow = self.nowTick()
+        self.rtPeriod       = period
+        self.rtCompareArmed = False
+        self.cancel(EVT_RADIOTIMER_COMPARE)
+        self.cancel(EVT_RADIOTIMER_OVERFLOW)
+        self.schedule(EVT_RADIOTIMER_OVERFLOW,self.rtLastOverflow+period)
+    radio_startTimer = radiotimer_start
+
+    def radiotimer_getValue(self):
+        return self.nowTick()-self.rtLastOverflow
+    radio_getTimerValue        = radiotimer_getValue
+    radiotimer_getCapturedTime = radiotimer_getValue
+
+    def radiotimer_setPeriod(self,period):
+        self.rtPeriod = period
+        self.cancel(EVT_RADIOTIMER_OVERFLOW)
+        self.schedule(EVT_RADIOTIMER_OVERFLOW,max(self.rtLastOverflow+period,self.nowTick()))
+    radio_setTimerPeriod = radiotimer_setPeriod
+
+    def radiotimer_getPeriod(self):
+        return self.rtPeriod
+    radio_getTimerPeriod = radiotimer_getPeriod
+
+    def radiotimer_schedule(self,offset):
+        self.rtCompareArmed  = True
+        self.rtCompareOffset = offset
+        self.cancel(EVT_RADIOTIMER_COMPARE)
+        if offset>self.radiotimer_getValue() and offset<self.rtPeriod:
+            self.schedule(EVT_RADIOTIMER_COMPARE,self.rtLastOverflow+offset)
+
+    def radiotimer_cancel(self):
+        self.rtCompareArmed = False
+        self.cancel(EVT_RADIOTIMER_COMPARE)
+
+    #=== radio
+
+    def radio_setFrequency(self,frequency):
+        self.frequency = frequency
+
+    def radio_rfOff(self):
+        if self.radioState=='transmitting':
+            for m in self.engine.motes:
+                if m.rxFrom is self:
+                    m.rxFrom     = None
+                    m.radioState = 'listening'
+        self.cancel(EVT_RADIO_TXSTART)
+        self.cancel(EVT_RADIO_TXEND)
+        self.rxFrom     = None
+        self.radioState = 'off'
+    radio_init  = radio_rfOff
+    radio_reset = radio_rfOff
+
+    def radio_loadPacket(self,packet):
+        # the frame comes as a str, which is immutable and can be kept as is
+        self.txBuf = packet
+
+    def radio_txNow(self):
+        self.radioState = 'transmitting'
+        self.schedule(EVT_RADIO_TXSTART,self.nowTick()+DELAY_TX_TICKS)
+
+    def radio_rxNow(self):
+        self.radioState = 'listening'
+
+    def radio_getReceivedFrame(self):
+        return self.rxFrame
+
+    #=== uart
+
+    def uart_enableInterrupts(self):
+        self.uartIntEnabled = True
+
+    def uart_disableInterrupts(self):
+        self.uartIntEnabled = False
+
+    def uart_writeByte(self,byte):
+        self.uartOut.append(byte)
+        self.schedule(EVT_UART_TX,time=self.engine.now+UART_BYTE_SUBTICKS)
+
+    def uart_writeBufferByLen_FASTSIM(self,buffer):
+        self.uartOut += buffer
+
+    def uart_readByte(self):
+        return 0
+
+class PythonEngine(object):
+    '''
+    Event queue serving the interrupts of PythonMotes.
+    '''
+
+    def __init__(self,numMotes,seed):
+        self.now        = 0
+        self.seq        = 0
+        self.events     = []
+        self.random     = random.Random(seed)
+        self.moteAsleep = threading.Semaphore(0)
+        self.motes      = [PythonMote(self,i,eui64(i)) for i in range(numMotes)]
+        self.links      = {}
+        for (src,dst,pdr,rssi) in links(numMotes):
+            self.links[(src,dst)] = (pdr,rssi)
+        self.numEvents  = 0
+        for m in self.motes:
+            m.boot()
+
+    def schedule(self,time,mote,type,gen):
+        self.seq += 1
+        heapq.heappush(self.events,(time,self.seq,mote,type,gen))
+
+    def run(self,duration):
+        end = self.now+duration
+        while self.events and self.events[0][0]<=end:
+            (time,_,m,type,gen) = heapq.heappop(self.events)
+            if gen!=m.gen[type]:
+                continue
+            self.now = time
+            self.numEvents += 1
+            self.dispatch(m,type)
+        self.now = end
+
+    def dispatch(self,m,type):
+        if   type==EVT_RADIOTIMER_OVERFLOW:
+            m.rtLastOverflow = m.nowTick()
+            m.schedule(EVT_RADIOTIMER_OVERFLOW,m.rtLastOverflow+m.rtPeriod)
+            if m.rtCompareArmed and m.rtCompareOffset<m.rtPeriod:
+                m.cancel(EVT_RADIOTIMER_COMPARE)
+                m.schedule(EVT_RADIOTIMER_COMPARE,m.rtLastOverflow+m.rtCompareOffset)
+            m.mote.radiotimer_isr_overflow()
+            m.resume()
+        elif type==EVT_RADIOTIMER_COMPARE:
+            m.rtCompareArmed = False
+            m.mote.radiotimer_isr_compare()
+            m.resume()
+        elif type==EVT_BSP_TIMER:
+            m.mote.bsp_timer_isr()
+            m.resume()
+        elif type==EVT_RADIO_TXSTART:
+            m.schedule(EVT_RADIO_TXEND,time=self.now+(1+len(m.txBuf))*RADIO_BYTE_SUBTICKS)
+            for r in self.motes:
+                if r is m or (m.idx,r.idx) not in self.links or r.frequency!=m.frequency:
+                    continue
+                if r.radioState=='listening':
+                    r.radioState  = 'receiving'
+                    r.rxFrom      = m
+                    r.rxCollision = False
+                    r.mote.radio_isr_startFrame(r.radiotimer_getValue())
+                    r.resume()
+                elif r.radioState=='receiving':
+                    r.rxCollision = True
+            m.mote.radio_isr_startFrame(m.radiotimer_getValue())
+            m.resume()
+        elif type==EVT_RADIO_TXEND:
+            m.radioState = 'done'
+            for r in self.motes:
+                if r.rxFrom is not m or r.radioState!='receiving':
+                    continue
+                (pdr,rssi)   = self.links[(m.idx,r.idx)]
+                crc          = (not r.rxCollision) and self.random.random()<pdr
+                r.rxFrom     = None
+                r.radioState = 'done'
+                r.rxFrame    = (m.txBuf,rssi,0xff if crc else 0,1 if crc else 0)
+                r.mote.radio_isr_endFrame(r.radiotimer_getValue())
+                r.resume()
+            m.mote.radio_isr_endFrame(m.radiotimer_getValue())
+            m.resume()
+        elif type==EVT_UART_TX:
+            if m.uartIntEnabled:
+                m.mote.uart_isr_tx()
+                m.resume()
+
+#============================ benchmark =======================================
+
+def benchPython(numMotes,duration):
+    engine = PythonEngine(numMotes,seed=1)
+    start  = time.time()
+    engine.run(int(duration*TICKS_PER_S)<<SUBTICK_SHIFT)
+    wall   = time.time()-start
+    return (wall,engine.numEvents)
+
+def benchNative(numMotes,duration):
+    engine = oos_openwsn.SimEngine(1)
+    motes  = []
+    for i in range(numMotes):
+        motes += [oos_openwsn.OpenMote()]
+        engine.addMote(motes[-1],eui64(i))
+    for (src,dst,pdr,rssi) in links(numMotes):
+        engine.setLink(src,dst,pdr,rssi)
+    start  = time.time()
+    engine.run(duration)
+    wall   = time.time()-start
+    return (wall,engine.getStats()['numEvents'])
+
+def main():
+    numMotes = int(sys.argv[1]) if len(sys.argv)>1 else 10
+    duration = float(sys.argv[2]) if len(sys.argv)>2 else 60
+    mode     = sys.argv[3] if len(sys.argv)>3 else 'both'
+
+    numSlots = numMotes*duration*TICKS_PER_S/SLOT_TICKS
+    print '{0} motes, {1}s of network time ({2:.0f} mote-slots)'.format(numMotes,duration,numSlots)
+    for (name,bench) in [('python',benchPython),('native',benchNative)]:
+        if mode not in [name,'both']:
+            continue
+        (wall,numEvents) = bench(numMotes,duration)
+        print '{0:>6}: {1:8.2f}s wall, {2:9} events, {3:12.0f} mote-slots/s'.format(
+            name,
+            wall,
+            numEvents,
+            numSlots/wall,
+        )
+    sys.stdout.flush()
+
+    # the threads of the Python motes never return
+    os._exit(0)
+
+if __name__=="__main__":
+    main()
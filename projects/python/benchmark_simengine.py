@@ -0,0 +1,185 @@
+'''
+Run the benchmark scenarios of the network on the simulator, with uinject
+traffic at several rates, and compare their KPIs with a baseline.
+
+The scenarios are those of SCENARIOS, each run at every period of RATES:
+
+- line          a chain of motes, the deepest network for its size
+- grid          a square grid, several routes to the DAG root
+- random        motes spread at random, each hearing about a dozen others
+- interference  a grid on the SINR medium, next to two WiFi networks, one of
+                them busy a third of the time
+
+Each run gives the KPIs of sweep_simengine.py: end-to-end PDR, overall and
+per source, latency percentiles, radio duty cycle, join time and queue drops.
+They are written as JSON, one entry per scenario and rate.
+
+The engine is deterministic, so a KPI only differs from the baseline if the
+code did. With a baseline file, the KPIs which changed are listed, and the
+script fails if one got worse by more than TOLERANCE. Without one, the
+results are written to it.
+
+    benchmark_simengine.py [results.json] [baseline.json] [duration] [numProcesses]
+'''
+
+import os
+import sys
+import json
+import time
+import multiprocessing
+
+if __name__=='__main__':
+    here = sys.path[0]
+    sys.path.insert(0, os.path.join(here, '..','common'))# contains openwsn module
+
+import oos_openwsn
+import sweep_simengine
+
+TOLERANCE           = 0.05                       # relative
+
+SCENARIOS = {
+    'line': {
+        'numMotes':       10,
+        'topology':       'line',
+    },
+    'grid': {
+        'numMotes':       16,
+        'topology':       'grid',
+    },
+    'random': {
+        'numMotes':       30,
+        'topology':       'random',
+    },
+    'interference': {
+        'numMotes':       16,
+        'topology':       'grid',
+        'medium':         {'sinr': 1},
+        'interferers':    [
+            {'channelMask': oos_openwsn.WIFI1_MASK, 'power': -75, 'period': 0.1, 'onTime': 0.03},
+            {'channelMask': oos_openwsn.WIFI6_MASK, 'power': -85},
+        ],
+    },
+}
+
+RATES               = [2000,1000,500]            # ms between two packets of a source
+
+# KPIs compared with the baseline, and whether higher is better
+KPIS = [
+    ('e2ePdr',           True),
+    ('e2eMinPdr',        True),
+    ('latencyP50',       False),
+    ('latencyP90',       False),
+    ('latencyP99',       False),
+    ('latencyMax',       False),
+    ('macDutyCycle',     False),
+    ('macDutyCycleMax',  False),
+    ('numJoined',        True),
+    ('joinTime',         False),
+    ('joinTimeMax',      False),
+    ('numQueueDropped',  False),
+]
+
+#============================ run =============================================
+
+def benchmarks(duration):
+    '''
+    \returns The names of the benchmarks, and their scenarios.
+    '''
+    names     = []
+    scenarios = []
+    for name in sorted(SCENARIOS.keys()):
+        for period in RATES:
+            scenario = dict(sweep_simengine.DEFAULTS)
+            scenario.update(SCENARIOS[name])
+            scenario['duration']      = duration
+            scenario['uinjectPeriod'] = period
+            names     += ['{0}/{1}ms'.format(name,period)]
+            scenarios += [scenario]
+    return (names,scenarios)
+
+def isWorse(value,reference,higherIsBetter):
+    '''
+    \returns True if value is worse than reference, by more than TOLERANCE.
+    '''
+    # a KPI which could not be measured, e.g. no packet got through
+    if value is None or reference is None:
+        return value is None and reference is not None
+    if higherIsBetter:
+        return value<reference*(1-TOLERANCE)
+    return value>reference*(1+TOLERANCE)
+
+def compare(results,reference):
+    '''
+    Print the KPIs which differ from the baseline.
+
+    \returns The number of them which got worse.
+    '''
+    numRegressions = 0
+    print '{0:<24} {1:<16} {2:>12} {3:>12}'.format('benchmark','KPI','value','baseline')
+    for name in sorted(results.keys()):
+        if name not in reference:
+            print '{0:<24} not in the baseline'.format(name)
+            continue
+        for (kpi,higherIsBetter) in KPIS:
+            value = results[name].get(kpi)
+            ref   = reference[name].get(kpi)
+            if value==ref:
+                continue
+            flag  = ''
+            if isWorse(value,ref,higherIsBetter):
+                flag            = '  worse'
+                numRegressions += 1
+            print '{0:<24} {1:<16} {2:>12} {3:>12}{4}'.format(
+                name,kpi,formatKpi(value),formatKpi(ref),flag,
+            )
+    return numRegressions
+
+def formatKpi(value):
+    if value is None:
+        return '-'
+    if isinstance(value,float):
+        return '{0:.3f}'.format(value)
+    return str(value)
+
+#============================ main ============================================
+
+def main():
+    output       = sys.argv[1]        if len(sys.argv)>1 else 'benchmark.json'
+    baseline     = sys.argv[2]        if len(sys.argv)>2 else None
+    duration     = float(sys.argv[3]) if len(sys.argv)>3 else 300
+    numProcesses = int(sys.argv[4])   if len(sys.argv)>4 else multiprocessing.cpu_count()
+
+    (names,scenarios) = benchmarks(duration)
+    print '{0} benchmarks on {1} processes'.format(len(scenarios),numProcesses)
+    start   = time.time()
+    rows    = sweep_simengine.runSweep(scenarios,numProcesses)
+    results = {}
+    for (name,row) in zip(names,rows):
+        if row['error']:
+            print '{0} failed: {1}'.format(name,row['error'])
+            sys.exit(1)
+        # parameters and results as values, not as they are in a CSV cell
+        results[name] = dict(
+            (k,json.loads(v) if k in ['medium','clock','interferers','e2ePdrPerSource'] and v is not None else v)
+            for (k,v) in row.items()
+        )
+    with open(output,'w') as f:
+        json.dump(results,f,indent=4,sort_keys=True)
+    print 'done in {0:.1f}s, results in {1}'.format(time.time()-start,output)
+
+    reference = {}
+    if baseline and os.path.exists(baseline):
+        with open(baseline) as f:
+            reference = json.load(f)
+    if baseline and not reference:
+        with open(baseline,'w') as f:
+            json.dump(results,f,indent=4,sort_keys=True)
+        print 'baseline written to {0}'.format(baseline)
+    elif reference:
+        numRegressions = compare(results,reference)
+        if numRegressions:
+            print '{0} KPI(s) worse than the baseline by more than {1:.0f}%'.format(numRegressions,100*TOLERANCE)
+            sys.exit(1)
+
+if __name__=="__main__":
+    main()
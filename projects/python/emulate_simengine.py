@@ -0,0 +1,189 @@
+'''
+Emulate a network with its motes spread over several processes.
+
+Each process runs its share of the motes on a native SimEngine, in which the
+motes of the other processes are remote: the frames they send reach it
+through a radio medium in shared memory, delivered by time and channel.
+
+- in lock-step mode, the processes advance together, and the results only
+  depend on the seed and the number of processes, not on how the processes
+  were scheduled.
+- in real-time mode, each process follows the wall clock, as real motes
+  would. Frames which reach a process after they should have started are
+  counted as late.
+
+With as many processes as motes, each mote runs in a process of its own.
+Each process prints its pid when it starts, to attach a debugger or a
+profiler to the mote it runs (gdb -p <pid>); in lock-step mode, the others
+wait for it.
+
+    emulate_simengine.py [numMotes] [duration] [numProcesses] [lockstep|realtime] [topology] [seed]
+'''
+
+import os
+import sys
+import time
+import tempfile
+import traceback
+import multiprocessing
+
+if __name__=='__main__':
+    here = sys.path[0]
+    sys.path.insert(0, os.path.join(here, '..','common'))# contains openwsn module
+
+import oos_openwsn
+import sweep_simengine
+
+TICKS_PER_S         = 32768
+SERIAL_READ_PERIOD  = 10                         # s, before the engine drops serial bytes
+
+#============================ run =============================================
+
+def owner(moteIdx,numProcesses):
+    '''
+    \returns The process which runs mote moteIdx.
+    '''
+    return moteIdx%numProcesses
+
+def runProcess(proc,numProcesses,path,numMotes,duration,topology,seed,results):
+    '''
+    Run the motes of process proc, until duration seconds of network time.
+    '''
+    try:
+        engine = oos_openwsn.SimEngine((seed<<16)+proc)
+        local  = []
+        for i in range(numMotes):
+            if owner(i,numProcesses)==proc:
+                engine.addMote(oos_openwsn.OpenMote(),sweep_simengine.eui64(i),sweep_simengine.randomSeed(seed,i))
+                local += [i]
+            else:
+                engine.addRemoteMote()
+        for (src,dst) in sweep_simengine.neighbors(topology,numMotes):
+            engine.setLink(src,dst,1.0,-60)
+            engine.setLink(dst,src,1.0,-60)
+        engine.attachSharedMedium(path,proc)
+        # in one write, so the lines of the processes don't mix
+        sys.stdout.write('process {0} (pid {1}) runs motes {2}\n'.format(proc,os.getpid(),local))
+        sys.stdout.flush()
+
+        # all processes must run for the same durations
+        serialBytes = dict((i,0) for i in local)
+        start       = time.time()
+        elapsed     = 0.0
+        while elapsed<duration:
+            step     = min(SERIAL_READ_PERIOD,duration-elapsed)
+            engine.run(step)
+            elapsed += step
+            for i in local:
+                serialBytes[i] += len(engine.getSerialOutput(i))
+
+        motes = {}
+        for i in local:
+            stats = engine.getMoteStats(i)
+            motes[i] = {
+                'numTx':          stats['numTx'],
+                'numRx':          stats['numRx'],
+                'numRxCrcError':  stats['numRxCrcError'],
+                'numCollisions':  stats['numCollisions'],
+                'numDeSync':      stats['numDeSync'],
+                'dutyCycle':      float(stats['radioOnTicks'])/(engine.getTime()*TICKS_PER_S),
+                'serialBytes':    serialBytes[i],
+            }
+        results.put((proc,None,time.time()-start,engine.getStats(),motes))
+    except Exception:
+        results.put((proc,traceback.format_exc(),0,{},{}))
+
+def emulate(numMotes,duration,numProcesses,realtime,topology,seed):
+    '''
+    \returns A dict per process and a dict per mote, None if a process failed.
+    '''
+    # /dev/shm keeps the medium in memory
+    directory = '/dev/shm' if os.path.isdir('/dev/shm') else tempfile.gettempdir()
+    path      = os.path.join(directory,'openwsn-medium-{0}'.format(os.getpid()))
+    oos_openwsn.createSharedMedium(path,numProcesses,realtime)
+
+    results   = multiprocessing.Queue()
+    processes = [
+        multiprocessing.Process(
+            target = runProcess,
+            args   = (proc,numProcesses,path,numMotes,duration,topology,seed,results),
+        )
+        for proc in range(numProcesses)
+    ]
+    procStats = {}
+    moteStats = {}
+    failed    = False
+    try:
+        for p in processes:
+            p.start()
+        while len(procStats)<numProcesses:
+            try:
+                (proc,error,wallTime,stats,motes) = results.get(timeout=1)
+            except Exception:
+                # a process which died without reporting would hold the others
+                dead = [proc for (proc,p) in enumerate(processes) if p.exitcode not in [None,0]]
+                if dead:
+                    print 'process {0} died'.format(dead[0])
+                    failed = True
+                    break
+                continue
+            if error:
+                print 'process {0} failed:\n{1}'.format(proc,error)
+                failed = True
+                break
+            stats['wallTime'] = wallTime
+            procStats[proc]   = stats
+            moteStats.update(motes)
+    finally:
+        if failed or len(procStats)<numProcesses:
+            oos_openwsn.abortSharedMedium(path)
+        for p in processes:
+            p.join()
+        os.remove(path)
+    if failed:
+        return None
+    return (procStats,moteStats)
+
+def printResults(procStats,moteStats,numProcesses):
+    print '{0:>5} {1:>5} {2:>7} {3:>7} {4:>9} {5:>10} {6:>7} {7:>9}'.format(
+        'mote','proc','numTx','numRx','crcError','collisions','deSync','dutyCycle',
+    )
+    for i in sorted(moteStats.keys()):
+        s = moteStats[i]
+        print '{0:>5} {1:>5} {2:>7} {3:>7} {4:>9} {5:>10} {6:>7} {7:>8.2f}%'.format(
+            i,owner(i,numProcesses),s['numTx'],s['numRx'],s['numRxCrcError'],
+            s['numCollisions'],s['numDeSync'],100*s['dutyCycle'],
+        )
+    print
+    print '{0:>5} {1:>9} {2:>8} {3:>9} {4:>8} {5:>6} {6:>6} {7:>8}'.format(
+        'proc','events','windows','framesOut','framesIn','late','lost','wall',
+    )
+    for proc in sorted(procStats.keys()):
+        s = procStats[proc]
+        print '{0:>5} {1:>9} {2:>8} {3:>9} {4:>8} {5:>6} {6:>6} {7:>7.1f}s'.format(
+            proc,s['numEvents'],s['numWindows'],s['numFramesOut'],s['numFramesIn'],
+            s['numFramesLate'],s['numFramesLost'],s['wallTime'],
+        )
+
+#============================ main ============================================
+
+def main():
+    numMotes     = int(sys.argv[1])   if len(sys.argv)>1 else 10
+    duration     = float(sys.argv[2]) if len(sys.argv)>2 else 60
+    numProcesses = int(sys.argv[3])   if len(sys.argv)>3 else min(numMotes,multiprocessing.cpu_count())
+    mode         = sys.argv[4]        if len(sys.argv)>4 else 'lockstep'
+    topology     = sys.argv[5]        if len(sys.argv)>5 else 'line'
+    seed         = int(sys.argv[6])   if len(sys.argv)>6 else 1
+    if mode not in ['lockstep','realtime'] or topology not in ['line','grid','full']:
+        print __doc__
+        sys.exit(1)
+    numProcesses = max(1,min(numProcesses,numMotes))
+
+    print '{0} motes in {1} processes, {2}s of network time, {3}'.format(numMotes,numProcesses,duration,mode)
+    result = emulate(numMotes,duration,numProcesses,mode=='realtime',topology,seed)
+    if result is None:
+        sys.exit(1)
+    printResults(result[0],result[1],numProcesses)
+
+if __name__=="__main__":
+    main()
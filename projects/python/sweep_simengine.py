@@ -0,0 +1,460 @@
+'''
+Run a matrix of simulation scenarios on all the cores of this machine.
+
+Each scenario runs in a process of its own, on motes attached to a native
+SimEngine, and the results are merged into a single CSV table, one row per
+scenario, in the order of the matrix.
+
+The matrix is a JSON file:
+
+    {
+        "fixed": {"numMotes": 10, "duration": 300},
+        "sweep": {"seed": [1,2,3], "topology": ["line","grid"]}
+    }
+
+Every combination of the values listed in "sweep" is run, on top of the
+parameters in "fixed". A scenario has the following parameters:
+
+- seed          seed of the engine, from which the seed of openrandom on
+                each mote is also derived
+- numMotes      the first one is the DAG root
+- duration      simulated seconds, once all motes booted
+- bootInterval  simulated seconds between the boot of two motes
+- topology      'line', 'grid', 'full' or 'random', the latter spread
+                uniformly, one mote per spacing squared, neighbors within
+                RANDOM_RANGE spacings
+- pdr, rssi     of the links between neighbors, without the SINR medium
+- spacing       meters between neighbors, with the SINR medium
+- medium        keyword arguments of SimEngine.setMedium()
+- clock         keyword arguments of SimEngine.setClock()
+- interferers   list of keyword arguments of SimEngine.addInterferer()
+- uinjectPeriod ms between two uinject packets of a mote, 0 for the default
+                of the firmware
+- module        directory of the oos_openwsn build to use
+
+Besides the counters of the motes, each row holds the KPIs of the uinject
+traffic, from the event log each mote writes on its serial port:
+
+- e2ePdr, e2eMinPdr   packets received by the DAG root over those generated,
+                      over all sources and for the worst one. e2ePdrPerSource
+                      holds that of each source, by mote index.
+- latencyP50/P90/P99/Max
+                      ms from generation to reception at the DAG root, from
+                      the ASN uinject carries
+- macDutyCycle(Max)   of the radio, as ieee154e_stats measures it, over all
+                      motes and for the busiest one
+- joinTime(Max)       s from the boot of a mote until it is synchronized and
+                      has a rank, JOIN_POLL_PERIOD accurate
+- numJoined           motes which joined
+- numQueueDropped     packets refused as the queue was full
+- numEventsLost       event records the motes could not write; if not 0,
+                      the KPIs above are underestimated
+
+Only packets generated once all motes booted, and DRAIN_TIME before the end,
+count for the PDR and the latency.
+
+Parameters compiled into the firmware, such as the slotframe length or the
+size of the queue, need one build per value, selected through 'module'.
+
+    sweep_simengine.py matrix.json [results.csv] [numProcesses]
+'''
+
+import os
+import sys
+import csv
+import json
+import math
+import time
+import random
+import itertools
+import traceback
+import multiprocessing
+
+here = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0,os.path.join(here,'..','..','logparser'))
+
+import OpenHdlc
+
+DEFAULTS = {
+    'seed':           1,
+    'numMotes':       10,
+    'duration':       60,
+    'bootInterval':   0.5,
+    'topology':       'line',
+    'pdr':            1.0,
+    'rssi':           -60,
+    'spacing':        10.0,
+    'medium':         None,
+    'clock':          None,
+    'interferers':    [],
+    'uinjectPeriod':  0,
+    'module':         os.path.join(here,'..','common'),
+}
+
+TICKS_PER_S         = 32768
+SINK_EUI64_END      = [0x5a,0x53]
+SLOT_S              = 491.0/TICKS_PER_S          # s, duration of a slot
+SERIAL_READ_PERIOD  = 10                         # s, before the engine drops serial bytes
+JOIN_POLL_PERIOD    = 1                          # s, between two checks of the motes having joined
+DRAIN_TIME          = 10                         # s, for the last packets to reach the DAG root
+RANDOM_RANGE        = 2.0                        # spacings, within which motes of a random topology hear each other
+MAXDAGRANK          = 0xffff
+
+# golden image command setting the period of uinject, see openserial.h
+COMMAND_VERSION           = 1
+COMMAND_SET_UINJECTPERIOD = 10
+
+# event log of the motes, see openeventlog.h
+EVENTLOG_VERSION          = 1
+EVENTLOG_FLAG_COMPONENT   = 0x80
+COMPONENT_UINJECT         = 0x24
+ERR_UINJECT_SND           = 0x3d
+ERR_UINJECT_RCV           = 0x3e
+
+#============================ scenarios =======================================
+
+def readMatrix(filename):
+    '''
+    \returns The list of scenarios of the matrix, each a dict of parameters.
+    '''
+    with open(filename) as f:
+        matrix = json.load(f)
+    fixed  = matrix.get('fixed',{})
+    sweep  = matrix.get('sweep',{})
+    for key in fixed.keys()+sweep.keys():
+        if key not in DEFAULTS:
+            raise ValueError('unknown parameter {0}'.format(key))
+
+    keys      = sorted(sweep.keys())
+    scenarios = []
+    for values in itertools.product(*[sweep[k] for k in keys]):
+        scenario = dict(DEFAULTS)
+        scenario.update(fixed)
+        scenario.update(zip(keys,values))
+        if scenario['topology'] not in ['line','grid','full','random']:
+            raise ValueError('unknown topology {0}'.format(scenario['topology']))
+        scenarios += [scenario]
+    return scenarios
+
+def eui64(i):
+    if i==0:
+        return [0x14,0x15,0x92,0x00,0x00,0x00]+SINK_EUI64_END
+    return [0x14,0x15,0x92,0x00,0x00,0x00,0x10+(i>>8),i&0xff]
+
+def randomSeed(seed,i):
+    '''
+    \returns The openrandom seed of mote i, the same for the same seed.
+    '''
+    return random.Random(seed*65536+i).randint(1,0xffff)
+
+def shortID(i):
+    return (eui64(i)[6]<<8) | eui64(i)[7]
+
+def neighbors(topology,numMotes,seed=0):
+    '''
+    \returns The pairs of motes which hear each other, each pair once.
+    '''
+    side = int(math.ceil(math.sqrt(numMotes)))
+    for src in range(numMotes):
+        for dst in range(src+1,numMotes):
+            if topology=='random':
+                (x1,y1) = position(topology,numMotes,1.0,src,seed)
+                (x2,y2) = position(topology,numMotes,1.0,dst,seed)
+                if math.hypot(x2-x1,y2-y1)<=RANDOM_RANGE:
+                    yield (src,dst)
+            elif topology=='full':
+                yield (src,dst)
+            elif topology=='line' and dst-src==1:
+                yield (src,dst)
+            elif topology=='grid' and (
+                    (dst-src==1 and dst%side!=0) or
+                    dst-src==side
+                ):
+                yield (src,dst)
+
+def position(topology,numMotes,spacing,i,seed=0):
+    '''
+    \returns The coordinates of mote i, in meters.
+    '''
+    side = int(math.ceil(math.sqrt(numMotes)))
+    if topology=='random':
+        # not the generator of randomSeed()
+        rng  = random.Random((1<<32)+seed*65536+i)
+        side = math.sqrt(numMotes)*spacing
+        return (rng.uniform(0,side),rng.uniform(0,side))
+    if topology=='line':
+        return (i*spacing,0.0)
+    if topology=='full':
+        # all within spacing of each other
+        spacing = spacing/(side*math.sqrt(2))
+    return ((i%side)*spacing,(i/side)*spacing)
+
+#============================ kpis ============================================
+
+class SerialLog(object):
+    '''
+    The uinject records of the event log of a mote, from the bytes of its
+    serial port, read a chunk at a time.
+    '''
+    def __init__(self):
+        self.hdlc      = OpenHdlc.OpenHdlc()
+        self.pending   = ''
+        self.numBytes  = 0
+        self.numLost   = 0
+        self.sent      = [] # ASN of generation, per packet
+        self.received  = [] # (shortID of the source, ASN of generation, slots to get here), per packet
+
+    def write(self,bytes):
+        self.numBytes += len(bytes)
+        frames         = (self.pending+bytes).split(OpenHdlc.OpenHdlc.HDLC_FLAG)
+        self.pending   = frames.pop()
+        for frame in frames:
+            # most frames are status, not worth the CRC
+            if not frame.startswith('L'):
+                continue
+            try:
+                self.parseEventLog(self.hdlc.dehdlcifyFrame(frame))
+            except ValueError:
+                pass
+
+    def parseEventLog(self,frame):
+        # type (1B), src (2B), version (1B), lost (2B), base ASN (5B), then the records
+        if len(frame)<11 or frame[3]!=EVENTLOG_VERSION:
+            return
+        self.numLost  += frame[4] | (frame[5]<<8)
+        asn            = frame[6] | (frame[7]<<8) | (frame[8]<<16) | (frame[9]<<24) | (frame[10]<<32)
+        component      = None
+        idx            = 11
+        try:
+            while idx<len(frame):
+                code   = frame[idx]
+                idx   += 1
+                if code & EVENTLOG_FLAG_COMPONENT:
+                    code      &= ~EVENTLOG_FLAG_COMPONENT
+                    component  = frame[idx]
+                    idx       += 1
+                (delta,idx) = parseVarint(frame,idx)
+                (arg1,idx)  = parseVarint(frame,idx)
+                (arg2,idx)  = parseVarint(frame,idx)
+                asn   += delta
+                if component!=COMPONENT_UINJECT:
+                    continue
+                if   code==ERR_UINJECT_SND:
+                    self.sent     += [asn]
+                elif code==ERR_UINJECT_RCV:
+                    self.received += [(arg1,asn-arg2,arg2)]
+        except IndexError:
+            pass
+
+def parseVarint(bytes,idx):
+    '''
+    \returns (value, index of the byte following it) of an unsigned LEB128 varint.
+    '''
+    value = 0
+    shift = 0
+    while True:
+        b      = bytes[idx]
+        idx   += 1
+        value |= (b & 0x7f)<<shift
+        shift += 7
+        if not (b & 0x80):
+            return (value,idx)
+
+def percentile(values,p):
+    '''
+    \returns The p-th percentile of values, by nearest rank, None if empty.
+    '''
+    if not values:
+        return None
+    values = sorted(values)
+    return values[max(0,int(math.ceil(p*len(values)/100.0))-1)]
+
+def trafficKpis(logs,fromAsn,toAsn):
+    '''
+    \returns The PDR and latency of the packets generated in [fromAsn,toAsn[,
+        the DAG root being mote 0.
+    '''
+    ids      = dict((shortID(i),i) for i in range(len(logs)))
+    sent     = [sum(1 for asn in log.sent if fromAsn<=asn<toAsn) for log in logs]
+    received = [0]*len(logs)
+    latency  = []
+    for (src,asn,delay) in logs[0].received:
+        if src in ids and fromAsn<=asn<toAsn:
+            received[ids[src]] += 1
+            latency            += [1000*delay*SLOT_S]
+    perSource = [float(received[i])/sent[i] if sent[i] else None for i in range(len(logs))]
+    return {
+        'numGenerated':    sum(sent),
+        'numReceived':     sum(received),
+        'e2ePdr':          float(sum(received))/sum(sent) if sum(sent) else None,
+        'e2ePdrPerSource': json.dumps(perSource),
+        'e2eMinPdr':       min([p for p in perSource if p is not None] or [None]),
+        'latencyP50':      percentile(latency,50),
+        'latencyP90':      percentile(latency,90),
+        'latencyP99':      percentile(latency,99),
+        'latencyMax':      max(latency or [None]),
+    }
+
+#============================ run =============================================
+
+def readMotes(engine,logs,bootTime,joinTime):
+    '''
+    Read the serial port of all motes, and note how long after their boot
+    those not joined yet joined.
+    '''
+    for i in range(len(logs)):
+        logs[i].write(engine.getSerialOutput(i))
+        if joinTime[i] is None:
+            stats = engine.getMoteStats(i)
+            if stats['isSync'] and stats['myDAGrank']<MAXDAGRANK:
+                joinTime[i] = engine.getTime()-bootTime[i]
+
+def runScenario(args):
+    '''
+    Run one scenario, in the process of a worker.
+
+    \returns (index,row) where row holds the parameters and results.
+    '''
+    (index,scenario) = args
+    row = {}
+    try:
+        # each worker only ever runs one scenario, so it imports its own build
+        sys.path.insert(0,os.path.abspath(scenario['module']))
+        import oos_openwsn
+
+        engine = oos_openwsn.SimEngine(scenario['seed'])
+        if scenario['medium']:
+            engine.setMedium(**scenario['medium'])
+        if scenario['clock']:
+            engine.setClock(**scenario['clock'])
+        for interferer in scenario['interferers']:
+            engine.addInterferer(**interferer)
+        sinr = bool(scenario['medium'] and scenario['medium'].get('sinr'))
+
+        hdlc        = OpenHdlc.OpenHdlc()
+        links       = [] if sinr else list(neighbors(scenario['topology'],scenario['numMotes'],scenario['seed']))
+        motes       = []
+        logs        = []
+        bootTime    = []
+        joinTime    = []
+
+        # a mote boots when added, add them one after the other, so motes
+        # don't start in lockstep
+        for i in range(scenario['numMotes']):
+            motes    += [oos_openwsn.OpenMote()]
+            logs     += [SerialLog()]
+            bootTime += [engine.getTime()]
+            joinTime += [None]
+            engine.addMote(motes[-1],eui64(i),randomSeed(scenario['seed'],i))
+            if sinr:
+                (x,y) = position(scenario['topology'],scenario['numMotes'],scenario['spacing'],i,scenario['seed'])
+                engine.setPosition(i,x,y)
+            # links to the motes already added
+            for (src,dst) in links:
+                if max(src,dst)==i:
+                    engine.setLink(src,dst,scenario['pdr'],scenario['rssi'])
+                    engine.setLink(dst,src,scenario['pdr'],scenario['rssi'])
+            if scenario['uinjectPeriod']:
+                period = scenario['uinjectPeriod']
+                engine.serialInput(i,''.join(chr(b) for b in hdlc.hdlcify([
+                    ord('G'),COMMAND_VERSION,0,COMMAND_SET_UINJECTPERIOD,2,period&0xff,period>>8,
+                ])))
+            engine.run(scenario['bootInterval'])
+            readMotes(engine,logs,bootTime,joinTime)
+        fromAsn = int(engine.getTime()/SLOT_S)
+
+        start   = time.time()
+        elapsed = 0.0
+        while elapsed<scenario['duration']:
+            # more often until all joined, to time it
+            period   = JOIN_POLL_PERIOD if None in joinTime else SERIAL_READ_PERIOD
+            step     = min(period,scenario['duration']-elapsed)
+            engine.run(step)
+            elapsed += step
+            readMotes(engine,logs,bootTime,joinTime)
+        row['wallTime']  = time.time()-start
+        row['numEvents'] = engine.getStats()['numEvents']
+
+        stats = [engine.getMoteStats(i) for i in range(scenario['numMotes'])]
+        for key in [
+                'numTx','numRx','numRxCrcError','numCollisions','numResets',
+                'numTimeCorrections','numLargeTimeCorrections','numDeSync',
+            ]:
+            row[key] = sum(s[key] for s in stats)
+        row['meanAbsTimeCorrection'] = float(sum(s['sumAbsTimeCorrection'] for s in stats))/max(row['numTimeCorrections'],1)
+        row['dutyCycle']    = float(sum(s['radioOnTicks'] for s in stats))/(len(stats)*engine.getTime()*TICKS_PER_S)
+        row['serialBytes']  = sum(log.numBytes for log in logs)
+
+        row.update(trafficKpis(logs,fromAsn,int((engine.getTime()-DRAIN_TIME)/SLOT_S)))
+        macDutyCycle = [float(s['numTicsOn'])/s['numTicsTotal'] for s in stats if s['numTicsTotal']]
+        row['macDutyCycle']    = sum(macDutyCycle)/len(macDutyCycle) if macDutyCycle else None
+        row['macDutyCycleMax'] = max(macDutyCycle or [None])
+        joined = [t for t in joinTime[1:] if t is not None]
+        row['numJoined']       = len(joined)
+        row['joinTime']        = sum(joined)/len(joined) if joined else None
+        row['joinTimeMax']     = max(joined or [None])
+        row['numQueueDropped'] = sum(s['numQueueDropped'] for s in stats)
+        row['numEventsLost']   = sum(log.numLost for log in logs)
+        row['error']        = ''
+    except Exception:
+        row['error'] = traceback.format_exc().strip().splitlines()[-1]
+
+    for (key,value) in scenario.items():
+        row[key] = json.dumps(value) if isinstance(value,(dict,list)) else value
+    return (index,row)
+
+def runSweep(scenarios,numProcesses):
+    '''
+    \returns The rows of all scenarios, in their order.
+    '''
+    # a fresh process per scenario, so no state leaks from one to the next
+    pool = multiprocessing.Pool(numProcesses,maxtasksperchild=1)
+    rows = [None]*len(scenarios)
+    try:
+        for (index,row) in pool.imap_unordered(runScenario,enumerate(scenarios)):
+            rows[index] = row
+            print '[{0}/{1}] scenario {2} {3}'.format(
+                sum(1 for r in rows if r is not None),
+                len(scenarios),
+                index,
+                'failed: '+row['error'] if row['error'] else 'done in {0:.1f}s'.format(row['wallTime']),
+            )
+            sys.stdout.flush()
+        pool.close()
+    except KeyboardInterrupt:
+        pool.terminate()
+        raise
+    finally:
+        pool.join()
+    return rows
+
+def writeTable(rows,filename):
+    params  = sorted(DEFAULTS.keys())
+    results = sorted(set(k for r in rows for k in r.keys())-set(params)-set(['error']))
+    with open(filename,'wb') as f:
+        writer = csv.DictWriter(f,['scenario']+params+results+['error'])
+        writer.writeheader()
+        for (index,row) in enumerate(rows):
+            row = dict(row)
+            row['scenario'] = index
+            writer.writerow(row)
+
+#============================ main ============================================
+
+def main():
+    if len(sys.argv)<2:
+        print __doc__
+        sys.exit(1)
+    matrix       = sys.argv[1]
+    output       = sys.argv[2] if len(sys.argv)>2 else os.path.splitext(matrix)[0]+'.csv'
+    numProcesses = int(sys.argv[3]) if len(sys.argv)>3 else multiprocessing.cpu_count()
+
+    scenarios = readMatrix(matrix)
+    print '{0} scenarios on {1} processes'.format(len(scenarios),numProcesses)
+    start     = time.time()
+    rows      = runSweep(scenarios,numProcesses)
+    writeTable(rows,output)
+    print 'done in {0:.1f}s, results in {1}'.format(time.time()-start,output)
+
+if __name__=="__main__":
+    main()
@@ -0,0 +1,115 @@
+'''
+Check that a restored SimEngine snapshot continues exactly as the simulation
+it was taken from.
+
+A line of motes over a lossy medium, with clock drift and an interferer, is
+run until traffic flows, snapshotted, then run further. The snapshot is then
+restored into new motes, in this process and in a fresh one (where the module
+is loaded elsewhere), and run for as long. The statistics and serial output
+of every mote must match, the exit code is 1 if they don't.
+
+Built with TASK_PROFILING, the STATUS_TASKS notifications carry the addresses
+of the task callbacks, which depend on where the module is loaded, so the
+serial output of a restore in a new process differs.
+
+    test_snapshot.py [numMotes] [warm-up seconds] [seconds after snapshot]
+'''
+
+import os
+import sys
+import hashlib
+import tempfile
+import subprocess
+
+if __name__=='__main__':
+    here = sys.path[0]
+    sys.path.insert(0, os.path.join(here, '..','common'))# contains openwsn module
+
+import oos_openwsn
+
+SPACING_M           = 15.0
+
+#============================ helpers =========================================
+
+def eui64(i):
+    if i==0:
+        return [0x14,0x15,0x92,0x00,0x00,0x00,0x5a,0x53]
+    return [0x14,0x15,0x92,0x00,0x00,0x00,0x10,i]
+
+def build(numMotes):
+    engine = oos_openwsn.SimEngine(5)
+    engine.setClock(drift=20, walk=1, walkMax=10, jitter=0.00003)
+    engine.setMedium(sinr=True, coherence=0.5)
+    engine.addInterferer(channelMask=oos_openwsn.WIFI6_MASK, power=-70, period=0.1, onTime=0.03)
+    for i in range(numMotes):
+        engine.addMote(oos_openwsn.OpenMote(), eui64(i), i+1)
+        engine.setPosition(i, i*SPACING_M, 0)
+        engine.run(0.5)
+    return engine
+
+def state(engine, numMotes):
+    lines = [repr(engine.getStats()), '%.6f'%engine.getTime()]
+    for i in range(numMotes):
+        lines += [
+            repr(sorted(engine.getMoteStats(i).items())),
+            hashlib.md5(engine.getSerialOutput(i)).hexdigest(),
+        ]
+    return '\n'.join(lines)
+
+def restored(path, numMotes, duration):
+    engine = oos_openwsn.SimEngine()
+    engine.restore(path)
+    engine.run(duration)
+    return state(engine, numMotes)
+
+#============================ main ============================================
+
+def main():
+    numMotes = int(sys.argv[1])   if len(sys.argv)>1 else 6
+    warmUp   = float(sys.argv[2]) if len(sys.argv)>2 else 20
+    duration = float(sys.argv[3]) if len(sys.argv)>3 else 30
+
+    fd, path = tempfile.mkstemp(suffix='.snap')
+    os.close(fd)
+    try:
+        engine = build(numMotes)
+        engine.run(warmUp)
+        engine.snapshot(path)
+        engine.run(duration)
+        expected = state(engine, numMotes)
+
+        child    = subprocess.Popen(
+            [
+                sys.executable, os.path.abspath(__file__),
+                '--restore', path, str(numMotes), str(duration),
+            ],
+            stdout = subprocess.PIPE,
+        )
+        output   = child.communicate()[0].rstrip('\n')
+        if child.returncode!=0:
+            output = 'exit code {0}'.format(child.returncode)
+        results  = {
+            'new process':  output,
+            'same process': restored(path, numMotes, duration),
+        }
+    finally:
+        os.remove(path)
+
+    ok = True
+    for (name,result) in sorted(results.items()):
+        if result!=expected:
+            ok = False
+            print 'FAIL restored in {0}'.format(name)
+            for (e,r) in zip(expected.split('\n'),result.split('\n')):
+                if e!=r:
+                    print '  expected {0}'.format(e)
+                    print '  got      {0}'.format(r)
+        else:
+            print 'OK   restored in {0}'.format(name)
+    return 0 if ok else 1
+
+if __name__=='__main__':
+    if len(sys.argv)>1 and sys.argv[1]=='--restore':
+        print restored(sys.argv[2], int(sys.argv[3]), float(sys.argv[4]))
+        sys.exit(0)
+    sys.exit(main())